@@ -17,12 +17,19 @@
 
 /*************************************************************************************************/
 /* Macros ----------------------- -------------------------------------------------------------- */
+#ifdef LSS_TRACE
+#define TRACE(huart, servoID, phase, begin, cmd)    trace_event(huart, servoID, phase, begin, cmd)
+#else
+#define TRACE(huart, servoID, phase, begin, cmd)    ((void)(cmd))
+#endif
+
 #define CHECK_COMM_STATUS(lss, Query, ReturnValue)                                                \
     do                                                                                            \
     {                                                                                             \
+        TRACE(lss->huart, lss->servoID, LSS_Trace_Transaction, true, Query);                      \
         if (!generic_write(lss, Query))                                                           \
         {                                                                                         \
-            lss->lastCommStatus = LSS_CommStatus_WriteNoBus;                                      \
+            TRACE(lss->huart, lss->servoID, LSS_Trace_Transaction, false, Query);                 \
             return ReturnValue;                                                                   \
         }                                                                                         \
     } while (0)
@@ -30,9 +37,10 @@
 #define CHECK_COMM_STATUS_TYPE(lss, Query, ReturnValue, Type)                                     \
     do                                                                                            \
     {                                                                                             \
+        TRACE(lss->huart, lss->servoID, LSS_Trace_Transaction, true, Query);                      \
         if (!generic_write_val(lss, Query, Type))                                                 \
         {                                                                                         \
-            lss->lastCommStatus = LSS_CommStatus_WriteNoBus;                                      \
+            TRACE(lss->huart, lss->servoID, LSS_Trace_Transaction, false, Query);                 \
             return ReturnValue;                                                                   \
         }                                                                                         \
     } while (0)
@@ -51,6 +59,7 @@
 #define LSS_FIRST_POSITION_DISABLED     ("DIS")
 #define LSS_MAX_TOTAL_COMMAND_LENGTH    (30 + 1)   // ex: #999XXXX-2147483648\r; Adding 1 for end string char (\0)
                                                 // ex: #999XX000000000000000000\r;
+#define LSS_MAX_REPLY_LENGTH            (1 + 3 + 4 + 24 + 1)    // *, ID, identifier, value, \r
 
 //> Servo constants
 #define LSS_ID_DEFAULT              (0)
@@ -63,6 +72,63 @@
 #define LSS_MODEL_ST1               "LSS-ST1"
 #define LSS_MODEL_HS1               "LSS-HS1"
 
+//> Multi-servo wait
+#define LSS_WAIT_LEAD_TIME          (10)    // in ms, first poll happens this early before predicted arrival
+#define LSS_WAIT_BACKOFF_MIN        (5)     // in ms
+#define LSS_WAIT_BACKOFF_MAX        (80)    // in ms
+#define LSS_WAIT_MAX_COMM_ERRORS    (3)
+
+//> Multi-servo reset
+#define LSS_RESET_SILENT_TIME       (800)   // in ms, servos never answer this early after a reset
+#define LSS_RESET_PROBE_INTERVAL    (20)    // in ms
+#define LSS_RESET_PROBE_TIMEOUT     (5)     // in ms, per reply
+#define LSS_RESET_PROBE_SLOTS       (4)     // servos are probed in this many groups, spread over the interval
+
+//> State estimation
+#define LSS_ESTIMATE_MAX_GAP        (500)   // in ms, older position pairs don't give a usable velocity
+
+//> Health (circuit breaker)
+#ifndef LSS_HEALTH_THRESHOLD
+#define LSS_HEALTH_THRESHOLD        (3)     // consecutive failures before a servo is down, 0 to never skip
+#endif
+#define LSS_HEALTH_PROBE_MIN        (50)    // in ms, first probe after going down
+#define LSS_HEALTH_PROBE_MAX        (2000)  // in ms
+
+//> Wait strategies, ports may provide their own sleep and reception pump
+#define LSS_WAIT_POLL_INTERVAL      (1)     // in ms, longest wait between two scans for pipelined replies
+#ifndef LSS_WAIT_DEFAULT
+#define LSS_WAIT_DEFAULT            LSS_WaitBusy
+#endif
+#ifndef LSS_PORT_SLEEP
+#define LSS_PORT_SLEEP(huart, timeout)  ((void)(huart), (void)(timeout), __WFI())
+#endif
+#ifndef LSS_PORT_RX_PUMP
+#define LSS_PORT_RX_PUMP(huart)         ((void)(huart))
+#endif
+
+//> Tracing
+#define LSS_TRACE_MAGIC             ("LSST")
+#define LSS_TRACE_VERSION           (2)
+#define LSS_TRACE_HEADER_SIZE       (16)
+#define LSS_TRACE_EVENT_SIZE        (13)
+#define LSS_TRACE_GROUP_ID          (255)   // ID used for events covering several servos
+#define LSS_TRACE_NO_BUS            (255)   // bus of events that aren't on a bus (cycle marks)
+
+//> High-resolution timestamps (reply stamps, bus tracing), ports may provide their own
+#ifndef LSS_PORT_TIMESTAMP
+#if defined(__CORTEX_M) && (__CORTEX_M >= 3U) && (__CORTEX_M != 23U)
+#define LSS_PORT_TIMESTAMP()        (DWT->CYCCNT)
+#define LSS_PORT_TIMESTAMP_INIT()   (CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk,                 \
+                                     DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk)
+#define LSS_PORT_CLOCK              (SystemCoreClock)
+#else
+// Cortex-M0, M0+ and M23 have no DWT cycle counter, stamps fall back to the HAL tick
+#define LSS_PORT_TIMESTAMP()        (HAL_GetTick())
+#define LSS_PORT_TIMESTAMP_INIT()   ((void)0)
+#define LSS_PORT_CLOCK              (1000)
+#endif
+#endif
+
 //> Commands - actions
 #define LSS_ACTION_RESET                    ("RESET")
 #define LSS_ACTION_LIMP                     ("L")
@@ -145,18 +211,179 @@
 #define LSS_CONFIG_BLINKING_LED                 ("CLB")
 
 
+/*************************************************************************************************/
+/* Private types & tables ---------------------------------------------------------------------- */
+typedef struct
+{
+    const char* cmd;
+    bool        typed;  // query takes a LSS_QueryType parameter
+} LSS_QueryInfo;
+
+static const LSS_QueryInfo queryInfo[LSS_Query_Last] = {
+    [LSS_Query_Status]                  = {LSS_QUERY_STATUS,                    false},
+    [LSS_Query_OriginOffset]            = {LSS_QUERY_ORIGIN_OFFSET,             true },
+    [LSS_Query_AngularRange]            = {LSS_QUERY_ANGULAR_RANGE,             true },
+    [LSS_Query_PositionPulse]           = {LSS_QUERY_POSITION_PULSE,            false},
+    [LSS_Query_Position]                = {LSS_QUERY_POSITION,                  false},
+    [LSS_Query_Speed]                   = {LSS_QUERY_SPEED,                     false},
+    [LSS_Query_SpeedRpm]                = {LSS_QUERY_SPEED_RPM,                 false},
+    [LSS_Query_SpeedPulse]              = {LSS_QUERY_SPEED_PULSE,               false},
+    [LSS_Query_MaxSpeed]                = {LSS_QUERY_MAX_SPEED,                 true },
+    [LSS_Query_MaxSpeedRpm]             = {LSS_QUERY_MAX_SPEED_RPM,             true },
+    [LSS_Query_ColorLed]                = {LSS_QUERY_COLOR_LED,                 true },
+    [LSS_Query_Gyre]                    = {LSS_QUERY_GYRE,                      true },
+    [LSS_Query_Voltage]                 = {LSS_QUERY_VOLTAGE,                   false},
+    [LSS_Query_Temperature]             = {LSS_QUERY_TEMPERATURE,               false},
+    [LSS_Query_Current]                 = {LSS_QUERY_CURRENT,                   false},
+    [LSS_Query_Analog]                  = {LSS_QUERY_ANALOG,                    false},
+    [LSS_Query_FirmwareVersion]         = {LSS_QUERY_FIRMWARE_VERSION,          false},
+    [LSS_Query_AngularStiffness]        = {LSS_QUERY_ANGULAR_STIFFNESS,         true },
+    [LSS_Query_AngularHoldingStiffness] = {LSS_QUERY_ANGULAR_HOLDING_STIFFNESS, true },
+    [LSS_Query_AngularAcceleration]     = {LSS_QUERY_ANGULAR_ACCELERATION,      true },
+    [LSS_Query_AngularDeceleration]     = {LSS_QUERY_ANGULAR_DECELERATION,      true },
+    [LSS_Query_MotionControl]           = {LSS_QUERY_ENABLE_MOTION_CONTROL,     false},
+    [LSS_Query_FilterPositionCount]     = {LSS_QUERY_FILTER_POSITION_COUNT,     true },
+    [LSS_Query_BlinkingLed]             = {LSS_QUERY_BLINKING_LED,              false},
+};
+
+typedef struct
+{
+    LSS_ProfileField field;
+    LSS_QueryCommand query;
+    const char*      sessionAction;
+    const char*      configAction;
+} LSS_ProfileInfo;
+
+static const LSS_ProfileInfo profileInfo[] = {
+    {LSS_Profile_OriginOffset,            LSS_Query_OriginOffset,            LSS_ACTION_ORIGIN_OFFSET,             LSS_CONFIG_ORIGIN_OFFSET},
+    {LSS_Profile_AngularRange,            LSS_Query_AngularRange,            LSS_ACTION_ANGULAR_RANGE,             LSS_CONFIG_ANGULAR_RANGE},
+    {LSS_Profile_MaxSpeed,                LSS_Query_MaxSpeed,                LSS_ACTION_MAX_SPEED,                 LSS_CONFIG_MAX_SPEED},
+    {LSS_Profile_ColorLed,                LSS_Query_ColorLed,                LSS_ACTION_COLOR_LED,                 LSS_CONFIG_COLOR_LED},
+    {LSS_Profile_Gyre,                    LSS_Query_Gyre,                    LSS_ACTION_GYRE_DIRECTION,            LSS_CONFIG_GYRE_DIRECTION},
+    {LSS_Profile_AngularStiffness,        LSS_Query_AngularStiffness,        LSS_ACTION_ANGULAR_STIFFNESS,         LSS_CONFIG_ANGULAR_STIFFNESS},
+    {LSS_Profile_AngularHoldingStiffness, LSS_Query_AngularHoldingStiffness, LSS_ACTION_ANGULAR_HOLDING_STIFFNESS, LSS_CONFIG_ANGULAR_HOLDING_STIFFNESS},
+    {LSS_Profile_AngularAcceleration,     LSS_Query_AngularAcceleration,     LSS_ACTION_ANGULAR_ACCELERATION,      LSS_CONFIG_ANGULAR_ACCELERATION},
+    {LSS_Profile_AngularDeceleration,     LSS_Query_AngularDeceleration,     LSS_ACTION_ANGULAR_DECELERATION,      LSS_CONFIG_ANGULAR_DECELERATION},
+    {LSS_Profile_FilterPositionCount,     LSS_Query_FilterPositionCount,     LSS_FILTER_POSITION_COUNT,            LSS_CONFIG_FILTER_POSITION_CURRENT},
+};
+#define LSS_PROFILE_FIELD_COUNT     (sizeof(profileInfo) / sizeof(profileInfo[0]))
+
+//> One bus worth of frames in flight, all lanes of a round are driven at the same time
+typedef struct
+{
+    UART_HandleTypeDef* huart;
+    uint32_t            timeout;
+    uint8_t             batch[LSS_PIPELINE_DEPTH];  // indexes in the caller's servo array
+    uint8_t             count;
+    uint8_t             depth;      // servos per round, 1 on half-duplex buses when replies are expected
+    uint8_t             pending;
+    uint16_t            scan;
+    uint16_t            txLength;
+    uint16_t            echo;       // bytes of our own burst still expected on RX (LSS_Duplex_Echo)
+    uint16_t            stampAt;    // rxBuffer offset of the reply stamp belongs to
+    uint32_t            stamp;      // earliest time that reply's first byte can have arrived
+    uint32_t            tick;       // same, as a HAL tick
+    uint32_t            lastReply;  // HAL tick of the last reply collected (or of the end of the burst)
+    uint8_t             txBuffer[LSS_PIPELINE_DEPTH * LSS_MAX_TOTAL_COMMAND_LENGTH];
+    uint8_t             rxBuffer[LSS_PIPELINE_DEPTH * LSS_MAX_REPLY_LENGTH];
+} LSS_Lane;
+
+static LSS_Lane lanes[LSS_MAX_BUSES];
+
+typedef struct {
+    UART_HandleTypeDef* huart;
+    LSS_DuplexMode      duplex;
+    bool                encoder;
+    uint8_t             servoCount;     // servos on the bus, 0 if unknown (no broadcast)
+    bool                receiving;      // rxBuffer armed by send_frame (LSS_Duplex_Echo)
+    uint16_t            rxRead;         // next byte of rxBuffer to read
+    uint8_t             rxBuffer[LSS_MAX_TOTAL_COMMAND_LENGTH + LSS_MAX_REPLY_LENGTH];  // echo, then reply
+} LSS_BusConfig;
+
+static LSS_BusConfig    busConfigs[LSS_MAX_BUSES];
+static LSS_EncoderStats encoderStats;
+
+static const LSS_WaitStrategy* waitStrategy = &LSS_WAIT_DEFAULT;
+
+static LSS_ReplyHook replyHooks[LSS_MAX_REPLY_HOOKS];
+static void*         replyHookContexts[LSS_MAX_REPLY_HOOKS];
+static uint8_t       replyHookCount;
+
+static LSS_HealthHook healthHook;
+static void*          healthHookContext;
+
+#ifdef LSS_TRACE
+static LSS_TraceEvent traceRing[LSS_TRACE_SIZE];
+static uint32_t       traceCount;   // total number of events recorded, the ring keeps the last LSS_TRACE_SIZE
+#endif
+
+
 /*************************************************************************************************/
 /* Private functions declarations -------------------------------------------------------------- */
 static bool     set_session_config     (LSS* lss, LSS_SetType setType, int16_t value,
                                         const char* sessionAction, const char* configAction);
 
-static int16_t  timed_read             (LSS* lss);
+static void     record_target          (LSS* lss, int32_t position, uint16_t time);
+static uint32_t predict_arrival        (LSS* lss);
+static void     observe_position       (LSS* lss, int32_t position, uint32_t tick);
+static void     observe_speed          (LSS* lss, int32_t speed, uint32_t tick);
+static void     cache_query_value      (LSS* lss, LSS_QueryCommand query, LSS_QueryType queryType,
+                                        const LSS_Result* result);
+static int32_t  profile_value          (const LSS_Profile* profile, LSS_ProfileField field);
+
+static void     forget_session         (LSS* lss);
+
+static bool     health_skip            (const LSS* lss);
+static bool     health_allows          (LSS* lss);
+static void     health_update          (LSS* lss, LSS_LastCommStatus status);
+
+static bool     write_group            (LSS* servos[], uint8_t n, const char* cmd, const int16_t values[]);
+static uint8_t  gather_lanes           (LSS* servos[], uint8_t n, bool handled[], bool replies);
+static bool     transmit_lanes         (uint8_t laneCount, const char* cmd);
+static uint32_t burst_timeout          (const LSS_Lane* lane);
+static bool     check_echo             (LSS_Lane* lane);
+
+static LSS_BusConfig* bus_config      (UART_HandleTypeDef* huart, bool create);
+static LSS_DuplexMode duplex_mode      (UART_HandleTypeDef* huart);
+static HAL_StatusTypeDef transmit_frame(UART_HandleTypeDef* huart, const uint8_t* frame, uint16_t length,
+                                        uint32_t timeout);
+static void     stop_reception         (UART_HandleTypeDef* huart);
+
+static void     wait_bytes             (UART_HandleTypeDef* huart, uint32_t timeout);
+static void     sleep_for              (uint32_t duration);
+static void     wait_busy              (void* context, UART_HandleTypeDef* huart, uint32_t timeout);
+static void     wait_yield             (void* context, UART_HandleTypeDef* huart, uint32_t timeout);
+static void     wait_sleep             (void* context, UART_HandleTypeDef* huart, uint32_t timeout);
+static bool     pipeline_lanes         (LSS* servos[], uint8_t laneCount,
+                                        LSS_QueryCommand query, LSS_QueryType queryType,
+                                        LSS_Result results[]);
+static void     collect_replies        (LSS* servos[], LSS_Lane* lane, const char* cmd,
+                                        LSS_Result results[]);
+static int16_t  parse_reply            (const uint8_t* frame, uint16_t length, const char* cmd,
+                                        uint16_t* valueStart);
+
+static int16_t  timed_read             (const LSS* lss, LSS_LastCommStatus* status);
+static HAL_StatusTypeDef receive_waiting(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size,
+                                         uint32_t timeout);
+static HAL_StatusTypeDef wait_reception(UART_HandleTypeDef* huart, uint32_t timeout);
+static bool     wait_received          (UART_HandleTypeDef* huart, uint16_t count, uint32_t timeout);
 static void     set_read_timeouts      (LSS* lss, uint32_t startResponseTimeout,
                                         uint32_t msgCharTimeout);
 
-static void     init_bus               (LSS* lss, UART_HandleTypeDef* huart, uint32_t baud);
+static void     init_bus               (UART_HandleTypeDef* huart, uint32_t baud);
 static void     close_bus              (LSS* lss);
 
+static LSS_LastCommStatus send_frame   (const LSS* lss, const char* cmd, uint8_t* frame, uint16_t length);
+static bool     write_frame            (LSS* lss, const char* cmd, uint8_t* frame, uint16_t length);
+static uint16_t build_query            (uint8_t* buffer, uint8_t servoID,
+                                        LSS_QueryCommand query, LSS_QueryType queryType);
+static bool     write_move             (LSS* lss, const char* cmd, int16_t value, bool timed, int16_t tValue);
+static uint16_t encode_move            (uint8_t* buffer, const LSS* lss, int32_t position, int16_t tValue);
+static uint16_t format_move            (uint8_t* buffer, uint8_t servoID, const char* cmd, int32_t value,
+                                        int16_t tValue);
+static bool     at_target              (const LSS* lss);
+static bool     covers_bus             (const LSS_BusConfig* bus, LSS* servos[], const LSS_Lane* lane);
+static void     count_encoded          (uint16_t written, uint16_t sent);
 static bool     generic_write          (LSS* lss, const char* cmd);
 static bool     generic_write_val      (LSS* lss, const char* cmd, int16_t value);
 static bool     generic_write_val_param(LSS* lss, const char* cmd, int16_t value,
@@ -164,6 +391,17 @@ static bool     generic_write_val_param(LSS* lss, const char* cmd, int16_t value
 
 static uint16_t generic_read_s16       (LSS* lss, const char* cmd);
 static char*    generic_read_str       (LSS* lss, const char* cmd);
+static LSS_LastCommStatus receive_reply(const LSS* lss, const char* cmd, char* value, uint16_t size,
+                                        uint32_t* timestamp, uint32_t* stamp);
+static LSS_LastCommStatus read_reply   (const LSS* lss, const char* cmd, char* value, uint16_t size,
+                                        uint32_t* timestamp, uint32_t* stamp);
+static void     report_reply           (uint8_t servoID, const char* cmd, const char* value,
+                                        uint32_t timestamp);
+
+#ifdef LSS_TRACE
+static void     trace_event            (UART_HandleTypeDef* huart, uint8_t servoID, LSS_TracePhase phase,
+                                        bool begin, const char* cmd);
+#endif
 
 
 /*********************************************************************************************/
@@ -174,12 +412,50 @@ static char*    generic_read_str       (LSS* lss, const char* cmd);
 void LSS_init(LSS* lss, uint8_t id, UART_HandleTypeDef* huart, uint32_t baud)
 {
     assert_param(id > LSS_ID_MIN && id < LSS_ID_MAX);
-    
-    /* Init id */
-    lss->servoID = id;
 
-    /* Init bus */
-    init_bus(lss, huart, baud);
+    LSS_init_handle(lss, id, huart, LSS_TIMEOUT);
+    init_bus(huart, baud);
+}
+
+/* Same as LSS_init for a UART that is already initialized, ex: shared with other servos or set up by
+ * the C++ layer's Bus. timeout is the reply timeout, in ms. */
+void LSS_init_handle(LSS* lss, uint8_t id, UART_HandleTypeDef* huart, uint32_t timeout)
+{
+    assert_param(id <= LSS_BROADCAST_ID);
+
+    /* Init id and bus */
+    lss->servoID        = id;
+    lss->huart          = huart;
+    lss->msgCharTimeout = timeout;
+
+    /* Init motion bookkeeping */
+    lss->targetValid       = false;
+    lss->targetPosition    = 0;
+    lss->targetTime        = 0;
+    lss->targetTick        = 0;
+    lss->lastPosition      = 0;
+    lss->lastPositionValid = false;
+    lss->maxSpeed          = 0;
+    lss->lastReplyTick     = 0;
+    lss->lastReplyStamp    = 0;
+
+    /* Init state estimation */
+    lss->lastPositionTick   = 0;
+    lss->lastSpeed          = 0;
+    lss->lastSpeedTick      = 0;
+    lss->lastSpeedValid     = false;
+    lss->predictionError    = 0;
+    lss->predictionErrorSum = 0;
+    lss->predictionCount    = 0;
+
+    /* Init health */
+    lss->failures      = 0;
+    lss->down          = false;
+    lss->probeTick     = 0;
+    lss->probeInterval = 0;
+
+    /* Init the cycle counter replies are stamped with (if the core has one) */
+    LSS_PORT_TIMESTAMP_INIT();
 }
 
 
@@ -187,13 +463,16 @@ void LSS_init(LSS* lss, uint8_t id, UART_HandleTypeDef* huart, uint32_t baud)
 /* Actions */
 
 // Note: no waiting is done here. LSS will take a bit more than a second to reset/start responding to commands.
+// See LSS_reset_group to reset several servos and wait until they respond.
 bool reset(LSS* lss)
 {
+    forget_session(lss);
     return generic_write(lss, LSS_ACTION_RESET);
 }
 
 bool limp(LSS* lss)
 {
+    lss->targetValid = false;
     return generic_write(lss, LSS_ACTION_LIMP);
 }
 
@@ -206,42 +485,81 @@ bool hold(LSS* lss)
 // Make LSS move to specified position in 1/10°
 bool move(LSS* lss, int16_t value)
 {
-    return generic_write_val(lss, LSS_ACTION_MOVE, value);
+    if (!write_move(lss, LSS_ACTION_MOVE, value, false, 0))
+    {
+        return false;
+    }
+
+    record_target(lss, value, 0);
+    return true;
 }
 
 // Make LSS move to specified position in 1/10° with T parameter
 bool move_t(LSS* lss, int16_t value, int16_t tValue)
 {
-    return generic_write_val_param(lss, LSS_ACTION_MOVE, value, LSS_ACTION_PARAMETER_TIME, tValue);
+    if (!write_move(lss, LSS_ACTION_MOVE, value, true, tValue))
+    {
+        return false;
+    }
+
+    record_target(lss, value, tValue > 0 ? tValue : 0);
+    return true;
 }
 
 // Make LSS move to specified position in 1/10° with CH parameter
 bool move_ch(LSS* lss, int16_t value, int16_t chValue)
 {
-    return generic_write_val_param(lss, LSS_ACTION_MOVE, value, LSS_ACTION_PARAMETER_CURRENT_HOLD, chValue);
+    if (!generic_write_val_param(lss, LSS_ACTION_MOVE, value, LSS_ACTION_PARAMETER_CURRENT_HOLD, chValue))
+    {
+        return false;
+    }
+
+    record_target(lss, value, 0);
+    return true;
 }
 
 // Perform relative move by specified amount of 1/10°
 bool move_relative(LSS* lss, int16_t value)
 {
-    return generic_write_val(lss, LSS_ACTION_MOVE_RELATIVE, value);
+    if (!write_move(lss, LSS_ACTION_MOVE_RELATIVE, value, false, 0))
+    {
+        return false;
+    }
+
+    // Relative moves can only be tracked if we know where the servo started from
+    if (lss->targetValid)
+    {
+        record_target(lss, lss->targetPosition + value, 0);
+    }
+    return true;
 }
 
 // Perform relative move by specified amount of 1/10° with T parameter
 bool move_relative_t(LSS* lss, int16_t value, int16_t tValue)
 {
-    return generic_write_val_param(lss, LSS_ACTION_MOVE_RELATIVE, value, LSS_ACTION_PARAMETER_TIME, tValue);
+    if (!write_move(lss, LSS_ACTION_MOVE_RELATIVE, value, true, tValue))
+    {
+        return false;
+    }
+
+    if (lss->targetValid)
+    {
+        record_target(lss, lss->targetPosition + value, tValue > 0 ? tValue : 0);
+    }
+    return true;
 }
 
 // Make LSS rotate at set speed in (1/10°)/s
 bool wheel(LSS* lss, int16_t value)
 {
+    lss->targetValid = false;
     return generic_write_val(lss, LSS_ACTION_WHEEL, value);
 }
 
 // Make LSS rotate at set speed in RPM
 bool wheel_rpm(LSS* lss, int8_t value)
 {
+    lss->targetValid = false;
     return generic_write_val(lss, LSS_ACTION_WHEEL_RPM, value);
 }
 
@@ -289,6 +607,7 @@ int32_t get_position(LSS* lss)
     // Check for disabled first position
     if (str_to_int(valueStr, &valuePos))
     {
+        observe_position(lss, valuePos, lss->lastReplyTick);
         return valuePos;
     }
     else
@@ -305,8 +624,8 @@ int16_t get_first_position(LSS* lss)
     // Read response from servo (as string)
     char* valueStr = generic_read_str(lss, LSS_QUERY_FIRST_POSITION);
 
-    // Check for disabled first position
-    if (strcmp(valueStr, LSS_FIRST_POSITION_DISABLED) == 0)
+    // Check for disabled first position (or no reply)
+    if (valueStr == NULL || strcmp(valueStr, LSS_FIRST_POSITION_DISABLED) == 0)
     {
         // First position is not defined - invalid
         return 0;
@@ -349,7 +668,13 @@ bool get_is_first_position_enabled(LSS* lss)
 int16_t get_speed(LSS* lss)
 {
     CHECK_COMM_STATUS(lss, LSS_QUERY_SPEED, 0);
-    return (int16_t) generic_read_s16(lss, LSS_QUERY_SPEED);
+    int16_t speed = (int16_t) generic_read_s16(lss, LSS_QUERY_SPEED);
+
+    if (lss->lastCommStatus == LSS_CommStatus_ReadSuccess)
+    {
+        observe_speed(lss, speed, lss->lastReplyTick);
+    }
+    return speed;
 }
 
 int8_t get_speed_rpm(LSS* lss)
@@ -367,7 +692,14 @@ int8_t get_speed_pulse(LSS* lss)
 uint16_t get_max_speed(LSS* lss, LSS_QueryType queryType)
 {
     CHECK_COMM_STATUS_TYPE(lss, LSS_QUERY_MAX_SPEED, 0, queryType);
-    return generic_read_s16(lss, LSS_QUERY_MAX_SPEED);
+    uint16_t value = generic_read_s16(lss, LSS_QUERY_MAX_SPEED);
+
+    // Keep the session value around to predict move durations
+    if (queryType == LSS_QuerySession && lss->lastCommStatus == LSS_CommStatus_ReadSuccess)
+    {
+        lss->maxSpeed = value;
+    }
+    return value;
 }
 
 int8_t get_max_speed_rpm(LSS* lss, LSS_QueryType queryType)
@@ -425,7 +757,11 @@ LSS_Model get_model(LSS* lss)
 
     char* valueStr = generic_read_str(lss, LSS_QUERY_MODEL_STRING);
 
-    if (strcmp(valueStr, LSS_MODEL_HT1) == 0)
+    if (valueStr == NULL)
+    {
+        return LSS_ModelUnknown;
+    }
+    else if (strcmp(valueStr, LSS_MODEL_HT1) == 0)
     {
         return LSS_ModelHighTorque;
     }
@@ -512,12 +848,31 @@ bool set_angular_range(LSS* lss, uint16_t value, LSS_SetType setType)
 
 bool set_max_speed(LSS* lss, uint16_t value, LSS_SetType setType)
 {
-    return set_session_config(lss, setType, value, LSS_ACTION_MAX_SPEED, LSS_CONFIG_MAX_SPEED);
+    if (!set_session_config(lss, setType, value, LSS_ACTION_MAX_SPEED, LSS_CONFIG_MAX_SPEED))
+    {
+        return false;
+    }
+
+    if (setType == LSS_SetSession)
+    {
+        lss->maxSpeed = value;
+    }
+    return true;
 }
 
 bool set_max_speed_rpm(LSS* lss, int8_t value, LSS_SetType setType)
 {
-    return set_session_config(lss, setType, value, LSS_ACTION_MAX_SPEED_RPM, LSS_CONFIG_MAX_SPEED_RPM);
+    if (!set_session_config(lss, setType, value, LSS_ACTION_MAX_SPEED_RPM, LSS_CONFIG_MAX_SPEED_RPM))
+    {
+        return false;
+    }
+
+    // 1 RPM = 360°/min = 60 (1/10°)/s
+    if (setType == LSS_SetSession && value > 0)
+    {
+        lss->maxSpeed = (uint16_t)value * 60;
+    }
+    return true;
 }
 
 bool set_color_led(LSS* lss, LSS_LED_Color value, LSS_SetType setType)
@@ -581,250 +936,1699 @@ bool set_blinking_led(LSS* lss, uint8_t value)
 }
 
 
-/*************************************************************************************************/
-/* Private functions definitions --------------------------------------------------------------- */
+/* ---------------- */
+/* State estimation */
 
-static bool set_session_config (LSS* lss, LSS_SetType setType, int16_t value,
-                                const char* sessionAction, const char* configAction)
+/* Predict position (1/10°) and velocity ((1/10°)/s, may be NULL) at a HAL tick, without bus traffic.
+ * Starts from the last position sample, then follows the last move: linearly over its T parameter,
+ * or at max speed (cached by get_max_speed/set_max_speed, else the last speed) until the target.
+ * Without a move in progress (never commanded, wheel, limp), the last speed is extrapolated.
+ * Each new position sample is compared to its prediction, see predictionError in the LSS structure.
+ * Returns false until a first position sample was read. */
+bool LSS_estimate(const LSS* lss, uint32_t tick, int32_t* position, int32_t* velocity)
 {
-    if (setType == LSS_SetSession)
+    if (!lss->lastPositionValid)
     {
-        return generic_write_val(lss, sessionAction, value);
+        return false;
     }
-    else if (setType == LSS_SetConfig)
+
+    int32_t start    = lss->lastPosition;
+    int32_t speed    = lss->lastSpeedValid ? lss->lastSpeed : 0;
+    int32_t estimate = start;
+    int32_t rate     = speed;
+
+    if (!lss->targetValid)
     {
-        return generic_write_val(lss, configAction, value);
+        int32_t elapsed = (int32_t)(tick - lss->lastPositionTick);
+        estimate        = start + (int32_t)((int64_t)speed * elapsed / 1000);
     }
     else
     {
-        return false;
+        // The move goes on from the last sample, or from the command if it came later
+        uint32_t from     = ((int32_t)(lss->targetTick - lss->lastPositionTick) > 0) ? lss->targetTick
+                                                                                      : lss->lastPositionTick;
+        int32_t  elapsed  = (int32_t)(tick - from);
+        int32_t  distance = lss->targetPosition - start;
+        elapsed           = (elapsed < 0) ? 0 : elapsed;
+
+        if (lss->targetTime > 0)
+        {
+            int32_t remaining = (int32_t)(lss->targetTick + lss->targetTime - from);
+            if (elapsed >= remaining)
+            {
+                estimate = lss->targetPosition;
+                rate     = 0;
+            }
+            else
+            {
+                estimate = start + (int32_t)((int64_t)distance * elapsed / remaining);
+                rate     = (int32_t)((int64_t)distance * 1000 / remaining);
+            }
+        }
+        else
+        {
+            int32_t travelSpeed = (lss->maxSpeed > 0) ? lss->maxSpeed : ((speed < 0) ? -speed : speed);
+            int32_t travel      = (int32_t)((int64_t)travelSpeed * elapsed / 1000);
+            int32_t sign        = (distance < 0) ? -1 : 1;
+            if (travel >= distance * sign)
+            {
+                estimate = lss->targetPosition;
+                rate     = 0;
+            }
+            else
+            {
+                estimate = start + sign * travel;
+                rate     = sign * travelSpeed;
+            }
+        }
     }
-}
-
-static int16_t timed_read(LSS* lss)
-{
-	uint8_t val[2] = {0};
 
-	HAL_StatusTypeDef status = HAL_UART_Receive(lss->huart, val, 2, lss->msgCharTimeout);
-	if (status == HAL_OK)
-	{
-	    // endianness might be wrong
-	    int16_t returnVal = val[0];
-	    returnVal       <<= 8;
-	    returnVal        |= val[1];
-		return returnVal;
-	}
-	else if (status == HAL_TIMEOUT || status == HAL_BUSY)
-	{
-		lss->lastCommStatus = LSS_CommStatus_ReadTimeout;
-		return -1;
-	}
-	else
-	{
-		lss->lastCommStatus = LSS_CommStatus_ReadNoBus;
-		return -1;
-	}
+    *position = estimate;
+    if (velocity != NULL)
+    {
+        *velocity = rate;
+    }
+    return true;
 }
 
-
-static void set_read_timeouts(LSS* lss, uint32_t startResponseTimeout, uint32_t msgCharTimeout)
+/* Feed a sample obtained with the result API (LSS_query, LSS_query_results) to the estimator.
+ * Only position and speed queries are used, failed results are ignored. */
+void LSS_estimate_sample(LSS* lss, LSS_QueryCommand query, const LSS_Result* result)
 {
-    lss->msgCharTimeout = msgCharTimeout;
+    if (result->status == LSS_CommStatus_ReadSuccess &&
+        (query == LSS_Query_Position || query == LSS_Query_Speed))
+    {
+        cache_query_value(lss, query, LSS_QuerySession, result);
+    }
 }
 
-static void init_bus(LSS* lss, UART_HandleTypeDef* huart, uint32_t baud)
+// High-resolution time, in LSS_timestamp_clock() ticks per second. Wraps around (~30 s at 144 MHz).
+uint32_t LSS_timestamp(void)
 {
-	lss->huart           = huart;
-	huart->Init.BaudRate = baud;
-	lss->msgCharTimeout  = LSS_TIMEOUT;
-
-	if (HAL_UART_Init(huart) != HAL_OK)
-	{
-		error_handler();
-	}
+    return LSS_PORT_TIMESTAMP();
 }
 
-// Close the bus (stream), free pins and null reference
-static void close_bus(LSS* lss)
+uint32_t LSS_timestamp_clock(void)
 {
-	if (HAL_UART_DeInit(lss->huart) != HAL_OK)
-	{
-		error_handler();
-	}
+    return LSS_PORT_CLOCK;
 }
 
-
-/* ------- */
-/* Writing */
-
-/* Build & write a LSS command to the bus using the provided ID (no value)
- * Max size for cmd = (LSS_MAX_TOTAL_COMMAND_LENGTH - 1) */
-static bool generic_write(LSS* lss, const char* cmd)
+/* Bring readings taken one after the other (ex: two LSS_query_results sweeps) to a single instant.
+ * Each servo's value is interpolated, or extrapolated, between its previous and current results at
+ * stamp (an LSS_timestamp() value). When only the current result is valid, its value is held; servos
+ * without a valid result are left untouched in aligned, so it keeps what the caller had there.
+ * Stamps are compared modulo 2^32: keep the span between readings and stamp under half the wrap.
+ * Returns true if every servo had both readings. */
+bool LSS_align_results(const LSS_Result previous[], const LSS_Result current[], uint8_t n,
+                       uint32_t stamp, int32_t aligned[])
 {
-	uint8_t command[LSS_MAX_TOTAL_COMMAND_LENGTH] = {'\0'};
+    bool complete = true;
 
-	uint16_t len = snprintf((char*)command, LSS_MAX_TOTAL_COMMAND_LENGTH,
-							"%s%d%s%c",
-							LSS_COMMAND_START,
-							lss->servoID,
-							cmd,
-							LSS_COMMAND_END);
+    for (uint8_t i = 0; i < n; i++)
+    {
+        const LSS_Result* now  = &current[i];
+        const LSS_Result* then = &previous[i];
 
-	if (HAL_UART_Transmit(lss->huart, command, len, lss->msgCharTimeout) == HAL_OK)
-	{
-		lss->lastCommStatus = LSS_CommStatus_WriteSuccess;
-		return true;
-	}
-	else
-	{
-		lss->lastCommStatus = LSS_CommStatus_WriteNoBus;
-		return false;
-	}
-}
+        if (now->status != LSS_CommStatus_ReadSuccess)
+        {
+            complete = false;
+            continue;
+        }
 
-/* Build & write a LSS command to the bus using the provided ID and value
- * Max size for cmd = (LSS_MAX_TOTAL_COMMAND_LENGTH - 1) */
-static bool generic_write_val(LSS* lss, const char* cmd, int16_t value)
-{
-    uint8_t command[LSS_MAX_TOTAL_COMMAND_LENGTH] = {'\0'};
+        int32_t span = (int32_t)(now->stamp - then->stamp);
+        if (then->status != LSS_CommStatus_ReadSuccess || span <= 0)
+        {
+            aligned[i] = now->value;
+            complete   = false;
+            continue;
+        }
 
-	uint16_t len = snprintf((char*)command, LSS_MAX_TOTAL_COMMAND_LENGTH,
-							"%s%d%s%d%c",
-							LSS_COMMAND_START,
-							lss->servoID,
-							cmd,
-							value,
-							LSS_COMMAND_END);
+        int64_t elapsed = (int32_t)(stamp - now->stamp);
+        aligned[i]      = now->value + (int32_t)((int64_t)(now->value - then->value) * elapsed / span);
+    }
 
-	if (HAL_UART_Transmit(lss->huart, command, len, lss->msgCharTimeout) == HAL_OK)
-	{
-		lss->lastCommStatus = LSS_CommStatus_WriteSuccess;
-		return true;
-	}
-	else
-	{
-		lss->lastCommStatus = LSS_CommStatus_WriteNoBus;
-		return false;
-	}
+    return complete;
 }
 
-// Build & write a LSS command to the bus using the provided ID and value
-// Max size for cmd = (LSS_MAX_TOTAL_COMMAND_LENGTH - 1)
-static bool generic_write_val_param(LSS* lss, const char* cmd, int16_t value,
-                                    const char* parameter, int16_t parameter_value)
-{
-    uint8_t command[LSS_MAX_TOTAL_COMMAND_LENGTH] = {'\0'};
 
-	uint16_t len = snprintf((char*)command, LSS_MAX_TOTAL_COMMAND_LENGTH,
-							"%s%d%s%d%s%d%c",
-							LSS_COMMAND_START,
-							lss->servoID,
-							cmd,
-							value,
-							parameter,
-							parameter_value,
-							LSS_COMMAND_END);
+/* ------------ */
+/* Multi-servos */
 
-	if (HAL_UART_Transmit(lss->huart, command, len, lss->msgCharTimeout) == HAL_OK)
-	{
-		lss->lastCommStatus = LSS_CommStatus_WriteSuccess;
-		return true;
-	}
-	else
-	{
-		lss->lastCommStatus = LSS_CommStatus_WriteNoBus;
-		return false;
-	}
-}
+/* Wait until every servo in the group is within tolerance (in 1/10°) of its last commanded position,
+ * or until deadline (in ms from now) has elapsed.
+ * Arrival time is predicted from the commanded T parameter, or from the cached max speed and the
+ * last known position. The bus stays silent until shortly before that time; each servo is then polled
+ * with an exponentially growing interval. Per-servo outcomes are written to results.
+ * Returns true if every servo reached its target. */
+bool LSS_wait_reached(LSS* servos[], uint8_t n, uint16_t tolerance, uint32_t deadline,
+                      LSS_WaitResult results[])
+{
+    assert_param(n <= LSS_GROUP_MAX_SIZE);
 
+    uint32_t nextPoll  [LSS_GROUP_MAX_SIZE];
+    uint16_t backoff   [LSS_GROUP_MAX_SIZE];
+    uint8_t  commErrors[LSS_GROUP_MAX_SIZE];
 
-/* ------- */
-/* Reading */
+    uint32_t start   = HAL_GetTick();
+    uint8_t  pending = 0;
 
-static char* generic_read_str(LSS* lss, const char* cmd)
-{
-    // Read from bus until first character; exit if not found before timeout
-    uint8_t response = 0;
-    do
+    for (uint8_t i = 0; i < n; i++)
     {
-        uint32_t timeout = HAL_GetTick() + lss->msgCharTimeout;
-        if (HAL_UART_Receive(lss->huart, &response, 1, timeout) != HAL_OK)
+        if (!servos[i]->targetValid)
         {
-            error_handler();
-            return NULL;
+            // Nothing was commanded, consider the servo settled
+            results[i] = LSS_Wait_Reached;
+            continue;
         }
 
-    } while (response != LSS_COMMAND_REPLY_START[0]);
-
+        results[i]    = LSS_Wait_Pending;
+        nextPoll[i]   = predict_arrival(servos[i]);
+        backoff[i]    = LSS_WAIT_BACKOFF_MIN;
+        commErrors[i] = 0;
+        pending++;
+    }
 
-    // Ok we have the * now now lets get the servo ID from the message.
-    uint16_t readID = 0;
-    for (uint16_t i = 0; i < sizeof("255") - 1; i++)     // i < 3
+    uint32_t now = HAL_GetTick();
+    while (pending > 0 && (now - start) < deadline)
     {
-        int16_t c = timed_read(lss);
-        if (c == -1)
+        // Sleep until the earliest servo is due
+        uint32_t wait = deadline - (now - start);
+        for (uint8_t i = 0; i < n; i++)
         {
-            if (readID == lss->servoID)
+            if (results[i] != LSS_Wait_Pending)
+            {
+                continue;
+            }
+
+            int32_t due = (int32_t)(nextPoll[i] - now);
+            if (due <= 0)
             {
+                wait = 0;
                 break;
             }
-            else
+            else if ((uint32_t)due < wait)
             {
-                lss->lastCommStatus = LSS_CommStatus_ReadTimeout;
-                return NULL;
+                wait = due;
             }
         }
-        if (c < '0' || c > '9') // not a number character
+
+        if (wait > 0)
         {
-            lss->lastCommStatus = LSS_CommStatus_ReadWrongID;
-            return NULL;
+            sleep_for(wait);
+            now = HAL_GetTick();
+            continue;
         }
 
-        readID = readID * 10 + c - '0';
+        // Poll every servo that is due
+        for (uint8_t i = 0; i < n; i++)
+        {
+            if (results[i] != LSS_Wait_Pending || (int32_t)(nextPoll[i] - now) > 0)
+            {
+                continue;
+            }
+
+            LSS*    lss      = servos[i];
+            int32_t position = get_position(lss);
+
+            if (lss->lastCommStatus != LSS_CommStatus_ReadSuccess)
+            {
+                if (++commErrors[i] >= LSS_WAIT_MAX_COMM_ERRORS)
+                {
+                    results[i] = LSS_Wait_CommError;
+                    pending--;
+                    continue;
+                }
+            }
+            else
+            {
+                int32_t error = position - lss->targetPosition;
+                if (error <= tolerance && error >= -(int32_t)tolerance)
+                {
+                    results[i] = LSS_Wait_Reached;
+                    pending--;
+                    continue;
+                }
+            }
+
+            nextPoll[i] = HAL_GetTick() + backoff[i];
+            backoff[i]  = (backoff[i] * 2 > LSS_WAIT_BACKOFF_MAX) ? LSS_WAIT_BACKOFF_MAX : backoff[i] * 2;
+        }
+
+        now = HAL_GetTick();
     }
 
-    // Now lets validate the right CMD
-    uint8_t readCMD[LSS_MAX_TOTAL_COMMAND_LENGTH] = {0};
-    uint16_t len = strlen(cmd) + 1;
-    if (HAL_UART_Receive(lss->huart, readCMD, len, lss->msgCharTimeout * (len + 1)) != HAL_OK)
+    bool allReached = true;
+    for (uint8_t i = 0; i < n; i++)
     {
-        lss->lastCommStatus = LSS_CommStatus_ReadTimeout;
-        return NULL;
+        if (results[i] == LSS_Wait_Pending)
+        {
+            results[i] = LSS_Wait_Timeout;
+        }
+        allReached &= (results[i] == LSS_Wait_Reached);
     }
-    if (strncmp(cmd, (const char*)readCMD, len) != 0)
+
+    return allReached;
+}
+
+/* Query a single servo. The value comes back with its status and the time the reply started,
+ * nothing is written to the LSS structure apart from the servo's health. */
+LSS_Result LSS_query(LSS* lss, LSS_QueryCommand query, LSS_QueryType queryType)
+{
+    assert_param(query < LSS_Query_Last);
+
+    uint8_t  frame[LSS_MAX_TOTAL_COMMAND_LENGTH];
+    uint16_t length = build_query(frame, lss->servoID, query, queryType);
+
+    return LSS_query_frame(lss, queryInfo[query].cmd, frame, length);
+}
+
+/* Send a complete frame (#, ID, command, \r) built by the caller, no formatting is done. */
+bool LSS_send_frame(LSS* lss, const uint8_t* frame, uint16_t length)
+{
+    return write_frame(lss, "", (uint8_t*)frame, length);
+}
+
+/* Keep the motion bookkeeping (LSS_wait_reached, encoder) in sync with frames sent with LSS_send_frame:
+ * LSS_track_target after a move to position (in 1/10°, time in ms or 0), LSS_clear_target after a
+ * command that leaves the servo without a target (limp, wheel...). */
+void LSS_track_target(LSS* lss, int32_t position, uint16_t time)
+{
+    record_target(lss, position, time);
+}
+
+void LSS_clear_target(LSS* lss)
+{
+    lss->targetValid = false;
+}
+
+/* Send a complete query frame built by the caller and read the reply to cmd.
+ * Like every query, it goes through the servo's health: LSS_CommStatus_ServoDown without touching the
+ * bus while it's down and no probe is due. */
+LSS_Result LSS_query_frame(LSS* lss, const char* cmd, const uint8_t* frame, uint16_t length)
+{
+    LSS_Result result = {0, LSS_CommStatus_Idle, 0, 0};
+    if (!health_allows(lss))
     {
-        lss->lastCommStatus = LSS_CommStatus_ReadWrongIdentifier;
-        return NULL;
+        result.status = LSS_CommStatus_ServoDown;
+        return result;
     }
 
-    for (int i = 0; i < LSS_MAX_TOTAL_COMMAND_LENGTH - 1; i++)
+    TRACE(lss->huart, lss->servoID, LSS_Trace_Transaction, true, cmd);
+    result.status = send_frame(lss, cmd, (uint8_t*)frame, length);
+    if (result.status == LSS_CommStatus_WriteSuccess)
     {
-        int16_t c = timed_read(lss);
-        if (c == -1)
+        char value[LSS_MAX_REPLY_LENGTH];
+
+        TRACE(lss->huart, lss->servoID, LSS_Trace_Turnaround, true, cmd);
+        result.status = receive_reply(lss, cmd, value, sizeof(value), &result.timestamp, &result.stamp);
+        if (result.status == LSS_CommStatus_ReadSuccess && !str_to_int(value, &result.value))
         {
-            lss->lastCommStatus = LSS_CommStatus_ReadTimeout;
-            return NULL;
+            result.value  = 0;
+            result.status = LSS_CommStatus_ReadWrongFormat;
         }
-        else if (c == LSS_COMMAND_END)
+    }
+    TRACE(lss->huart, lss->servoID, LSS_Trace_Transaction, false, cmd);
+    health_update(lss, result.status);
+
+    return result;
+}
+
+/* Send the same query to every servo and collect the replies.
+ * Queries to servos sharing a bus are sent back to back (up to LSS_PIPELINE_DEPTH at a time) while
+ * replies are received in the background, so the bus never sits idle waiting on a single servo.
+ * Servos on different buses are queried at the same time.
+ * Each reply gets the servo's timeout (msgCharTimeout) from the previous one, so a bus waits longer the
+ * more replies it expects, but a silent servo costs a single timeout.
+ * Requires the UART interrupts to be enabled.
+ * Each servo's result (value, status, timestamp) is written to results[], the LSS structures are
+ * left untouched apart from their health, so failed servos can be retried on their own.
+ * Servos that are down get LSS_CommStatus_ServoDown without being queried, unless a probe is due.
+ * Not reentrant: the frames in flight are kept in the library's lane storage, shared by every group
+ * function (LSS_move_group, LSS_wheel_group, LSS_query_pipelined...), so group calls must not overlap,
+ * ex: from two RTOS tasks or an interrupt. servos[] isn't const since their health is updated.
+ * Returns true if every servo replied. */
+bool LSS_query_results(LSS* servos[], uint8_t n, LSS_QueryCommand query, LSS_QueryType queryType,
+                       LSS_Result results[])
+{
+    assert_param(n <= LSS_GROUP_MAX_SIZE);
+    assert_param(query < LSS_Query_Last);
+
+    bool handled[LSS_GROUP_MAX_SIZE] = {false};
+    bool skipped[LSS_GROUP_MAX_SIZE] = {false};
+    bool success = true;
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        if (health_skip(servos[i]))
         {
-            lss->values[i]      = '\0';
-            lss->lastCommStatus = LSS_CommStatus_ReadSuccess;
-            return lss->values;
+            handled[i] = skipped[i] = true;
+            results[i] = (LSS_Result){0, LSS_CommStatus_ServoDown, 0, 0};
+            success    = false;
         }
-        else
+    }
+
+    uint8_t laneCount = 0;
+    while ((laneCount = gather_lanes(servos, n, handled, true)) > 0)
+    {
+        success &= pipeline_lanes(servos, laneCount, query, queryType, results);
+    }
+
+    // The query doubles as the probe of down servos
+    for (uint8_t i = 0; i < n; i++)
+    {
+        if (!skipped[i])
         {
-            lss->values[i] = (char)c;
+            health_update(servos[i], results[i].status);
         }
     }
 
-    lss->lastCommStatus = LSS_CommStatus_ReadWrongFormat;
-    return NULL;
+    return success;
 }
 
-
-static uint16_t generic_read_s16(LSS* lss, const char* cmd)
+/* Same as LSS_query_results, with values written to values[] and per-servo status left in each
+ * servo's lastCommStatus, like the single-servo getters. */
+bool LSS_query_pipelined(LSS* servos[], uint8_t n, LSS_QueryCommand query, LSS_QueryType queryType,
+                         int32_t values[])
 {
-    // Let the string function do all of the main parsing work.
+    LSS_Result results[LSS_GROUP_MAX_SIZE];
+    bool       success = LSS_query_results(servos, n, query, queryType, results);
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        values[i]                 = results[i].value;
+        servos[i]->lastCommStatus = results[i].status;
+        if (results[i].status == LSS_CommStatus_ReadSuccess)
+        {
+            cache_query_value(servos[i], query, queryType, &results[i]);
+        }
+    }
+
+    return success;
+}
+
+/* Bring every servo in line with a profile.
+ * Each field of the profile is read back from the whole bus with a pipelined query, and only the
+ * servos whose value differs get written. Written fields are then verified with one more pipelined
+ * query. Fields still differing after verification are reported per servo in mismatches (may be NULL).
+ * Returns true if every servo matches the profile. */
+bool LSS_apply_profile(LSS* servos[], uint8_t n, const LSS_Profile* profile, uint16_t mismatches[])
+{
+    assert_param(n <= LSS_GROUP_MAX_SIZE);
+
+    uint16_t      written[LSS_GROUP_MAX_SIZE] = {0};
+    int32_t       values [LSS_GROUP_MAX_SIZE];
+    LSS_QueryType queryType = (profile->setType == LSS_SetConfig) ? LSS_QueryConfig : LSS_QuerySession;
+
+    // Read back & write only what differs
+    for (uint8_t f = 0; f < LSS_PROFILE_FIELD_COUNT; f++)
+    {
+        const LSS_ProfileInfo* info = &profileInfo[f];
+        if (!(profile->fields & info->field))
+        {
+            continue;
+        }
+
+        int32_t desired = profile_value(profile, info->field);
+        LSS_query_pipelined(servos, n, info->query, queryType, values);
+
+        for (uint8_t i = 0; i < n; i++)
+        {
+            if (servos[i]->lastCommStatus != LSS_CommStatus_ReadSuccess || values[i] != desired)
+            {
+                set_session_config(servos[i], profile->setType, desired, info->sessionAction, info->configAction);
+                written[i] |= info->field;
+            }
+        }
+    }
+
+    // Verify, only on the servos that were written
+    bool success = true;
+    for (uint8_t f = 0; f < LSS_PROFILE_FIELD_COUNT; f++)
+    {
+        const LSS_ProfileInfo* info = &profileInfo[f];
+
+        LSS*    subset[LSS_GROUP_MAX_SIZE];
+        uint8_t index [LSS_GROUP_MAX_SIZE];
+        uint8_t count = 0;
+        for (uint8_t i = 0; i < n; i++)
+        {
+            if (written[i] & info->field)
+            {
+                subset[count] = servos[i];
+                index [count] = i;
+                count++;
+            }
+        }
+        if (count == 0)
+        {
+            continue;
+        }
+
+        int32_t desired = profile_value(profile, info->field);
+        LSS_query_pipelined(subset, count, info->query, queryType, values);
+
+        for (uint8_t j = 0; j < count; j++)
+        {
+            if (subset[j]->lastCommStatus == LSS_CommStatus_ReadSuccess && values[j] == desired)
+            {
+                written[index[j]] &= ~info->field;
+            }
+            else
+            {
+                success = false;
+            }
+        }
+    }
+
+    if (mismatches != NULL)
+    {
+        memcpy(mismatches, written, n * sizeof(uint16_t));
+    }
+    return success;
+}
+
+/* Move every servo to its position (in 1/10°), with an optional T parameter (0 for none).
+ * Frames for servos sharing a bus are sent in one burst, all buses are driven at the same time.
+ * Returns true if every frame was sent. */
+bool LSS_move_group(LSS* servos[], uint8_t n, const int16_t positions[], int16_t tValue)
+{
+    assert_param(n <= LSS_GROUP_MAX_SIZE);
+
+    bool handled[LSS_GROUP_MAX_SIZE] = {false};
+    bool success = true;
+
+    uint8_t laneCount = 0;
+    while ((laneCount = gather_lanes(servos, n, handled, false)) > 0)
+    {
+        for (uint8_t l = 0; l < laneCount; l++)
+        {
+            LSS_Lane*            lane    = &lanes[l];
+            const LSS_BusConfig* bus     = bus_config(lane->huart, false);
+            bool                 encoded = (bus != NULL && bus->encoder);
+
+            // Every servo of the bus going to the same place: a single broadcast frame does it
+            bool broadcast = encoded && covers_bus(bus, servos, lane);
+            for (uint8_t j = 1; broadcast && j < lane->count; j++)
+            {
+                broadcast = (positions[lane->batch[j]] == positions[lane->batch[0]]);
+            }
+
+            uint16_t written = 0;
+            for (uint8_t j = 0; j < lane->count; j++)
+            {
+                uint8_t  i      = lane->batch[j];
+                uint8_t* buffer = &lane->txBuffer[lane->txLength];
+                if (broadcast)
+                {
+                    written += format_move(NULL, servos[i]->servoID, LSS_ACTION_MOVE, positions[i], tValue);
+                }
+                else if (encoded)
+                {
+                    uint16_t length = encode_move(buffer, servos[i], positions[i], tValue);
+                    count_encoded(format_move(NULL, servos[i]->servoID, LSS_ACTION_MOVE, positions[i], tValue),
+                                  length);
+                    lane->txLength += length;
+                }
+                else
+                {
+                    lane->txLength += format_move(buffer, servos[i]->servoID, LSS_ACTION_MOVE, positions[i], tValue);
+                }
+            }
+
+            if (broadcast)
+            {
+                lane->txLength = format_move(lane->txBuffer, LSS_BROADCAST_ID, LSS_ACTION_MOVE,
+                                             positions[lane->batch[0]], tValue);
+                count_encoded(written, lane->txLength);
+                encoderStats.broadcasts++;
+            }
+        }
+
+        success &= transmit_lanes(laneCount, LSS_ACTION_MOVE);
+
+        for (uint8_t l = 0; l < laneCount; l++)
+        {
+            LSS_Lane* lane = &lanes[l];
+            for (uint8_t j = 0; j < lane->count; j++)
+            {
+                LSS* lss = servos[lane->batch[j]];
+                if (lane->pending == 0)
+                {
+                    lss->lastCommStatus = LSS_CommStatus_WriteSuccess;
+                    record_target(lss, positions[lane->batch[j]], tValue > 0 ? tValue : 0);
+                }
+                else
+                {
+                    lss->lastCommStatus = LSS_CommStatus_WriteNoBus;
+                }
+            }
+        }
+    }
+
+    return success;
+}
+
+
+/* Make every servo rotate at its speed (in (1/10°)/s), in one burst per bus, all buses at the same time.
+ * Returns true if every frame was sent. */
+bool LSS_wheel_group(LSS* servos[], uint8_t n, const int16_t speeds[])
+{
+    assert_param(n <= LSS_GROUP_MAX_SIZE);
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        servos[i]->targetValid = false;
+    }
+    return write_group(servos, n, LSS_ACTION_WHEEL, speeds);
+}
+
+// Same as LSS_wheel_group, with speeds in RPM
+bool LSS_wheel_rpm_group(LSS* servos[], uint8_t n, const int8_t rpm[])
+{
+    assert_param(n <= LSS_GROUP_MAX_SIZE);
+
+    int16_t values[LSS_GROUP_MAX_SIZE];
+    for (uint8_t i = 0; i < n; i++)
+    {
+        servos[i]->targetValid = false;
+        values[i]              = rpm[i];
+    }
+    return write_group(servos, n, LSS_ACTION_WHEEL_RPM, values);
+}
+
+
+/* Reset every servo at once and wait for them to come back.
+ * Servos are left alone for LSS_RESET_SILENT_TIME, then the ones that haven't answered yet are probed
+ * with a short status query every LSS_RESET_PROBE_INTERVAL. The probes are staggered: the servos are
+ * split in LSS_RESET_PROBE_SLOTS groups probed one after the other over the interval, so bursts stay
+ * short and readyTime is finer. Each servo is marked ready as soon as it answers; readyTime (may be
+ * NULL) receives the time it took, in ms.
+ * Returns true once every servo is ready, or false if deadline (in ms from now) elapsed first. */
+bool LSS_reset_group(LSS* servos[], uint8_t n, uint32_t deadline, bool ready[], uint32_t readyTime[])
+{
+    assert_param(n <= LSS_GROUP_MAX_SIZE);
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        ready[i] = false;
+        forget_session(servos[i]);
+    }
+
+    uint32_t start = HAL_GetTick();
+    write_group(servos, n, LSS_ACTION_RESET, NULL);
+
+    if (deadline > LSS_RESET_SILENT_TIME)
+    {
+        sleep_for(LSS_RESET_SILENT_TIME);
+    }
+
+    uint8_t pending = n;
+    uint8_t slot    = 0;
+    while (pending > 0 && (HAL_GetTick() - start) < deadline)
+    {
+        uint32_t probeStart = HAL_GetTick();
+
+        // Probe this slot's servos still booting, with a short timeout so silent servos cost little
+        LSS*     probed  [LSS_GROUP_MAX_SIZE];
+        uint8_t  index   [LSS_GROUP_MAX_SIZE];
+        uint32_t timeouts[LSS_GROUP_MAX_SIZE];
+        int32_t  values  [LSS_GROUP_MAX_SIZE];
+        uint8_t  count = 0;
+        for (uint8_t i = 0; i < n; i++)
+        {
+            if (!ready[i] && i % LSS_RESET_PROBE_SLOTS == slot)
+            {
+                probed  [count]           = servos[i];
+                index   [count]           = i;
+                timeouts[count]           = servos[i]->msgCharTimeout;
+                servos[i]->msgCharTimeout = LSS_RESET_PROBE_TIMEOUT;
+                servos[i]->probeTick      = probeStart;    // probe servos that were down too
+                count++;
+            }
+        }
+
+        slot = (slot + 1) % LSS_RESET_PROBE_SLOTS;
+        if (count > 0)
+        {
+            LSS_query_pipelined(probed, count, LSS_Query_Status, LSS_QuerySession, values);
+        }
+
+        for (uint8_t j = 0; j < count; j++)
+        {
+            probed[j]->msgCharTimeout = timeouts[j];
+            probed[j]->failures       = 0;     // booting servos are silent, that's not a failure
+            probed[j]->probeInterval  = LSS_HEALTH_PROBE_MIN;
+            if (probed[j]->lastCommStatus == LSS_CommStatus_ReadSuccess)
+            {
+                ready[index[j]] = true;
+                if (readyTime != NULL)
+                {
+                    readyTime[index[j]] = HAL_GetTick() - start;
+                }
+                pending--;
+            }
+        }
+
+        uint32_t elapsed = HAL_GetTick() - probeStart;
+        if (pending > 0 && elapsed < LSS_RESET_PROBE_INTERVAL / LSS_RESET_PROBE_SLOTS)
+        {
+            sleep_for(LSS_RESET_PROBE_INTERVAL / LSS_RESET_PROBE_SLOTS - elapsed);
+        }
+    }
+
+    return pending == 0;
+}
+
+
+/* --------- */
+/* Multi-bus */
+void LSS_multibus_init(LSS_MultiBus* bus, UART_HandleTypeDef* huarts[], uint8_t busCount)
+{
+    assert_param(busCount > 0 && busCount <= LSS_MAX_BUSES);
+
+    bus->busCount = busCount;
+    for (uint8_t b = 0; b < busCount; b++)
+    {
+        bus->huarts[b] = huarts[b];
+        bus->load[b]   = 0;
+    }
+}
+
+/* Spread servos over the buses so that the expected load of every bus is as even as possible.
+ * weights[] is the expected load of each servo (poll rate, bytes per cycle...); NULL balances servo count.
+ * The heaviest servos are placed first, each on the least loaded bus. Each servo's huart is updated,
+ * the servos must be wired according to the resulting assignment. Every call starts from empty buses,
+ * load[] then holds the load of this assignment. */
+void LSS_multibus_assign(LSS_MultiBus* bus, LSS* servos[], uint8_t n, const uint16_t weights[])
+{
+    assert_param(n <= LSS_GROUP_MAX_SIZE);
+
+    for (uint8_t b = 0; b < bus->busCount; b++)
+    {
+        bus->load[b] = 0;
+    }
+
+    // Sort servo indexes by decreasing weight
+    uint8_t order[LSS_GROUP_MAX_SIZE];
+    for (uint8_t i = 0; i < n; i++)
+    {
+        uint16_t weight = (weights != NULL) ? weights[i] : 1;
+        uint8_t  j      = i;
+        while (j > 0 && weights != NULL && weights[order[j - 1]] < weight)
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    for (uint8_t k = 0; k < n; k++)
+    {
+        uint8_t i     = order[k];
+        uint8_t light = 0;
+        for (uint8_t b = 1; b < bus->busCount; b++)
+        {
+            if (bus->load[b] < bus->load[light])
+            {
+                light = b;
+            }
+        }
+
+        servos[i]->huart   = bus->huarts[light];
+        bus->load[light]  += (weights != NULL) ? weights[i] : 1;
+    }
+}
+
+/* Declare how a bus is wired (LSS_Duplex_Full until set):
+ *  - LSS_Duplex_Echo: our own bytes come back on RX. They are received in interrupt mode and checked
+ *    against what was sent, then skipped; the same reception goes on with the reply, so it's read right
+ *    after them without waiting for a timeout. It stays armed until the next frame on the bus, or the
+ *    reply is read. A mismatch means a collision: the frame fails with LSS_CommStatus_WriteUnknown.
+ *  - LSS_Duplex_Switched: STM32 single-wire mode (HAL_HalfDuplex_Init). The receiver is turned off
+ *    just before each frame and back on as soon as its last byte is out.
+ * Either way, queries to servos on that bus are no longer pipelined: a reply can't share the wire with
+ * the next query. Requires the UART interrupts to be enabled. */
+void LSS_set_duplex(UART_HandleTypeDef* huart, LSS_DuplexMode mode)
+{
+    LSS_BusConfig* bus = bus_config(huart, true);
+    assert_param(bus != NULL);     // more than LSS_MAX_BUSES buses
+    if (bus != NULL)
+    {
+        bus->duplex = mode;
+    }
+}
+
+
+/* ------- */
+/* Encoder */
+
+/* Send moves on this bus in their shortest equivalent form:
+ *  - D and MD are swapped when the other one is shorter, if the servo was read back exactly at its
+ *    last target (both forms then lead to the same place);
+ *  - a T parameter of 0 or less, which the servo ignores, is dropped;
+ *  - a group move sending every servo of the bus to the same position, or a group command sent to
+ *    every servo of the bus, becomes a single broadcast frame. servoCount is the number of servos
+ *    wired to the bus (up to LSS_PIPELINE_DEPTH), 0 if unknown: without it, nothing is broadcast.
+ * LSS_encoder_stats tells how many bytes were saved. */
+void LSS_set_encoder(UART_HandleTypeDef* huart, bool enable, uint8_t servoCount)
+{
+    LSS_BusConfig* bus = bus_config(huart, true);
+    assert_param(bus != NULL);     // more than LSS_MAX_BUSES buses
+    if (bus != NULL)
+    {
+        bus->encoder    = enable;
+        bus->servoCount = servoCount;
+    }
+}
+
+void LSS_encoder_stats(LSS_EncoderStats* stats, bool reset)
+{
+    *stats = encoderStats;
+    if (reset)
+    {
+        memset(&encoderStats, 0, sizeof(encoderStats));
+    }
+}
+
+
+/* ------- */
+/* Waiting */
+const LSS_WaitStrategy LSS_WaitBusy  = {wait_busy,  NULL, NULL};
+const LSS_WaitStrategy LSS_WaitYield = {wait_yield, NULL, NULL};
+const LSS_WaitStrategy LSS_WaitSleep = {wait_sleep, NULL, NULL};
+
+/* Select how the library waits for bytes and between polls, for every bus.
+ * With any strategy but LSS_WaitBusy, replies are received in interrupt mode: the UART interrupt must be
+ * enabled. Pipelined replies go to a buffer that only completes when full, so they are checked at least
+ * every LSS_WAIT_POLL_INTERVAL ms whether a notification came or not. */
+void LSS_set_wait_strategy(const LSS_WaitStrategy* strategy)
+{
+    assert_param(strategy != NULL && strategy->wait != NULL);
+    waitStrategy = strategy;
+}
+
+// Wake up a waiting strategy (semaphore, task notification...), safe from interrupts
+void LSS_notify_from_isr(void)
+{
+    if (waitStrategy->notify != NULL)
+    {
+        waitStrategy->notify(waitStrategy->context);
+    }
+}
+
+__weak void LSS_yield(void)
+{
+}
+
+
+/* ------- */
+/* Replies */
+
+/* Observe every numeric reply read by the library, see LSS_ReplyHook.
+ * Hooks run in the reading task while pipelined replies are still arriving, in the order they were
+ * added: keep them short. Register them before using the bus, ex: LSS_Shm and LSS_Telemetry side by
+ * side with LSS_add_reply_hook. LSS_set_reply_hook replaces them all with a single one (none if NULL). */
+void LSS_set_reply_hook(LSS_ReplyHook hook, void* context)
+{
+    replyHookCount = 0;
+    if (hook != NULL)
+    {
+        LSS_add_reply_hook(hook, context);
+    }
+}
+
+bool LSS_add_reply_hook(LSS_ReplyHook hook, void* context)
+{
+    for (uint8_t i = 0; i < replyHookCount; i++)
+    {
+        if (replyHooks[i] == hook && replyHookContexts[i] == context)
+        {
+            // Already registered
+            return true;
+        }
+    }
+    if (replyHookCount >= LSS_MAX_REPLY_HOOKS)
+    {
+        return false;
+    }
+
+    replyHooks[replyHookCount]        = hook;
+    replyHookContexts[replyHookCount] = context;
+    replyHookCount++;
+    return true;
+}
+
+void LSS_remove_reply_hook(LSS_ReplyHook hook, void* context)
+{
+    for (uint8_t i = 0; i < replyHookCount; i++)
+    {
+        if (replyHooks[i] == hook && replyHookContexts[i] == context)
+        {
+            // Keep the others in order
+            for (uint8_t j = i + 1; j < replyHookCount; j++)
+            {
+                replyHooks[j - 1]        = replyHooks[j];
+                replyHookContexts[j - 1] = replyHookContexts[j];
+            }
+            replyHookCount--;
+            return;
+        }
+    }
+}
+
+
+/* ------ */
+/* Health */
+
+/* After LSS_HEALTH_THRESHOLD consecutive timeouts (ReadTimeout, WriteNoBus), a servo is marked down:
+ * its commands and queries fail at once with LSS_CommStatus_ServoDown instead of waiting out the
+ * timeout. It is probed with a status query LSS_HEALTH_PROBE_MIN ms later, then at twice the interval
+ * after every failed probe (up to LSS_HEALTH_PROBE_MAX ms), the command that triggers the probe
+ * goes through once the servo answers.
+ * hook is called from the probing task on both transitions. */
+void LSS_set_health_hook(LSS_HealthHook hook, void* context)
+{
+    healthHook        = hook;
+    healthHookContext = context;
+}
+
+
+#ifdef LSS_TRACE
+/* ------- */
+/* Tracing */
+
+// Clear the trace and start the cycle counter used to timestamp events
+void LSS_trace_enable(void)
+{
+    LSS_PORT_TIMESTAMP_INIT();
+    traceCount = 0;
+}
+
+// Mark the start of a control cycle, used to compute bus utilization per cycle
+void LSS_trace_cycle(void)
+{
+    trace_event(NULL, LSS_TRACE_GROUP_ID, LSS_Trace_Cycle, true, "");
+}
+
+/* Serialize the recorded events, oldest first, for the host converter (tools/lss_trace_to_chrome.py).
+ * Format (little endian): "LSST", version (u8), reserved (u8, u16), clock in Hz (u32), event count (u32),
+ * then per event: timestamp in cycles (u32), servo ID (u8), phase (u8, bit 7 set on end), bus (u8),
+ * tag (6 chars).
+ * Returns the number of bytes written, events that don't fit in buffer are dropped. */
+uint32_t LSS_trace_export(uint8_t* buffer, uint32_t size)
+{
+    if (size < LSS_TRACE_HEADER_SIZE)
+    {
+        return 0;
+    }
+
+    uint32_t stored = (traceCount < LSS_TRACE_SIZE) ? traceCount : LSS_TRACE_SIZE;
+    uint32_t fits   = (size - LSS_TRACE_HEADER_SIZE) / LSS_TRACE_EVENT_SIZE;
+    uint32_t count  = (stored < fits) ? stored : fits;
+    uint32_t first  = traceCount - stored;
+
+    memcpy(buffer, LSS_TRACE_MAGIC, 4);
+    buffer[4] = LSS_TRACE_VERSION;
+    buffer[5] = 0;
+    buffer[6] = 0;
+    buffer[7] = 0;
+    uint32_t clock = LSS_PORT_CLOCK;
+    memcpy(&buffer[8],  &clock,           4);
+    memcpy(&buffer[12], &count,           4);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const LSS_TraceEvent* event = &traceRing[(first + i) % LSS_TRACE_SIZE];
+        uint8_t*              out   = &buffer[LSS_TRACE_HEADER_SIZE + i * LSS_TRACE_EVENT_SIZE];
+
+        memcpy(&out[0], &event->timestamp, 4);
+        out[4] = event->servoID;
+        out[5] = event->phase | (event->begin ? 0 : 0x80);
+        out[6] = event->bus;
+        memcpy(&out[7], event->tag, 6);
+    }
+
+    return LSS_TRACE_HEADER_SIZE + count * LSS_TRACE_EVENT_SIZE;
+}
+#endif
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+
+static bool set_session_config (LSS* lss, LSS_SetType setType, int16_t value,
+                                const char* sessionAction, const char* configAction)
+{
+    if (setType == LSS_SetSession)
+    {
+        return generic_write_val(lss, sessionAction, value);
+    }
+    else if (setType == LSS_SetConfig)
+    {
+        return generic_write_val(lss, configAction, value);
+    }
+    else
+    {
+        return false;
+    }
+}
+
+static void record_target(LSS* lss, int32_t position, uint16_t time)
+{
+    lss->targetValid    = true;
+    lss->targetPosition = position;
+    lss->targetTime     = time;
+    lss->targetTick     = HAL_GetTick();
+}
+
+// Returns the HAL tick at which the servo is expected to be done with its last move
+static uint32_t predict_arrival(LSS* lss)
+{
+    uint32_t duration = 0;
+
+    if (lss->targetTime > 0)
+    {
+        duration = lss->targetTime;
+    }
+    else if (lss->maxSpeed > 0 && lss->lastPositionValid)
+    {
+        int32_t distance = lss->targetPosition - lss->lastPosition;
+        if (distance < 0)
+        {
+            distance = -distance;
+        }
+        duration = ((uint32_t)distance * 1000) / lss->maxSpeed;
+    }
+
+    // Without enough information, polling starts right away
+    if (duration <= LSS_WAIT_LEAD_TIME)
+    {
+        return lss->targetTick;
+    }
+    return lss->targetTick + duration - LSS_WAIT_LEAD_TIME;
+}
+
+#ifdef LSS_TRACE
+// The bus is the index of the UART's entry in busConfigs, so spans on different buses can overlap
+static void trace_event(UART_HandleTypeDef* huart, uint8_t servoID, LSS_TracePhase phase, bool begin,
+                        const char* cmd)
+{
+    LSS_TraceEvent*      event = &traceRing[traceCount % LSS_TRACE_SIZE];
+    const LSS_BusConfig* bus   = (huart != NULL) ? bus_config(huart, true) : NULL;
+
+    event->timestamp = LSS_PORT_TIMESTAMP();
+    event->servoID   = servoID;
+    event->bus       = (bus != NULL) ? (uint8_t)(bus - busConfigs) : LSS_TRACE_NO_BUS;
+    event->phase     = phase;
+    event->begin     = begin;
+    strncpy(event->tag, cmd, sizeof(event->tag));
+
+    traceCount++;
+}
+#endif
+
+// Session values are lost when the servo resets
+static void forget_session(LSS* lss)
+{
+    lss->targetValid       = false;
+    lss->lastPositionValid = false;
+    lss->lastSpeedValid    = false;
+    lss->maxSpeed          = 0;
+}
+
+
+/* ------ */
+/* Health */
+
+// True if the servo is down and not due for a probe yet
+static bool health_skip(const LSS* lss)
+{
+    return lss->down && (int32_t)(HAL_GetTick() - lss->probeTick) < 0;
+}
+
+// False if the servo is down, probing it first when a probe is due
+static bool health_allows(LSS* lss)
+{
+    if (!lss->down)
+    {
+        return true;
+    }
+    if (health_skip(lss))
+    {
+        return false;
+    }
+
+    uint8_t  frame[LSS_MAX_TOTAL_COMMAND_LENGTH];
+    char     value[LSS_MAX_REPLY_LENGTH];
+    uint16_t length = build_query(frame, lss->servoID, LSS_Query_Status, LSS_QuerySession);
+
+    TRACE(lss->huart, lss->servoID, LSS_Trace_Transaction, true, LSS_QUERY_STATUS);
+    LSS_LastCommStatus status = send_frame(lss, LSS_QUERY_STATUS, frame, length);
+    if (status == LSS_CommStatus_WriteSuccess)
+    {
+        TRACE(lss->huart, lss->servoID, LSS_Trace_Turnaround, true, LSS_QUERY_STATUS);
+        status = receive_reply(lss, LSS_QUERY_STATUS, value, sizeof(value), NULL, NULL);
+    }
+    TRACE(lss->huart, lss->servoID, LSS_Trace_Transaction, false, LSS_QUERY_STATUS);
+
+    health_update(lss, status);
+    return !lss->down;
+}
+
+// Count consecutive timeouts, mark the servo down or back up and schedule the next probe
+static void health_update(LSS* lss, LSS_LastCommStatus status)
+{
+    if (status == LSS_CommStatus_ReadSuccess)
+    {
+        lss->failures = 0;
+        if (lss->down)
+        {
+            lss->down = false;
+            if (healthHook != NULL)
+            {
+                healthHook(healthHookContext, lss, true);
+            }
+        }
+    }
+    else if (status == LSS_CommStatus_ReadTimeout || status == LSS_CommStatus_WriteNoBus)
+    {
+        if (lss->down)
+        {
+            lss->probeInterval = (lss->probeInterval * 2 > LSS_HEALTH_PROBE_MAX) ? LSS_HEALTH_PROBE_MAX
+                                                                                 : lss->probeInterval * 2;
+            lss->probeTick     = HAL_GetTick() + lss->probeInterval;
+        }
+        else if (LSS_HEALTH_THRESHOLD > 0 && ++lss->failures >= LSS_HEALTH_THRESHOLD)
+        {
+            lss->down          = true;
+            lss->probeInterval = LSS_HEALTH_PROBE_MIN;
+            lss->probeTick     = HAL_GetTick() + LSS_HEALTH_PROBE_MIN;
+            if (healthHook != NULL)
+            {
+                healthHook(healthHookContext, lss, false);
+            }
+        }
+    }
+}
+
+// Mirror the side effects of the single-servo getters for values obtained in bulk
+static void cache_query_value(LSS* lss, LSS_QueryCommand query, LSS_QueryType queryType,
+                              const LSS_Result* result)
+{
+    if (query == LSS_Query_Position)
+    {
+        observe_position(lss, result->value, result->timestamp);
+    }
+    else if (query == LSS_Query_Speed)
+    {
+        observe_speed(lss, result->value, result->timestamp);
+    }
+    else if (query == LSS_Query_MaxSpeed && queryType == LSS_QuerySession)
+    {
+        lss->maxSpeed = result->value;
+    }
+}
+
+// New position sample: score the prediction made for it, then make it the reference
+static void observe_position(LSS* lss, int32_t position, uint32_t tick)
+{
+    int32_t predicted = 0;
+    if (LSS_estimate(lss, tick, &predicted, NULL))
+    {
+        lss->predictionError     = position - predicted;
+        lss->predictionErrorSum += (lss->predictionError < 0) ? -lss->predictionError : lss->predictionError;
+        lss->predictionCount++;
+    }
+
+    // Without a speed sample since the previous position, derive the velocity from both positions
+    int32_t gap = (int32_t)(tick - lss->lastPositionTick);
+    if (lss->lastPositionValid && gap > 0 && gap <= LSS_ESTIMATE_MAX_GAP &&
+        (!lss->lastSpeedValid || (int32_t)(lss->lastSpeedTick - lss->lastPositionTick) <= 0))
+    {
+        lss->lastSpeed      = (int32_t)(((int64_t)position - lss->lastPosition) * 1000 / gap);
+        lss->lastSpeedTick  = tick;
+        lss->lastSpeedValid = true;
+    }
+
+    lss->lastPosition      = position;
+    lss->lastPositionTick  = tick;
+    lss->lastPositionValid = true;
+}
+
+static void observe_speed(LSS* lss, int32_t speed, uint32_t tick)
+{
+    lss->lastSpeed      = speed;
+    lss->lastSpeedTick  = tick;
+    lss->lastSpeedValid = true;
+}
+
+static int32_t profile_value(const LSS_Profile* profile, LSS_ProfileField field)
+{
+    switch (field)
+    {
+        case LSS_Profile_OriginOffset:            return profile->originOffset;
+        case LSS_Profile_AngularRange:            return profile->angularRange;
+        case LSS_Profile_MaxSpeed:                return profile->maxSpeed;
+        case LSS_Profile_ColorLed:                return profile->colorLed;
+        case LSS_Profile_Gyre:                    return profile->gyre;
+        case LSS_Profile_AngularStiffness:        return profile->angularStiffness;
+        case LSS_Profile_AngularHoldingStiffness: return profile->angularHoldingStiffness;
+        case LSS_Profile_AngularAcceleration:     return profile->angularAcceleration;
+        case LSS_Profile_AngularDeceleration:     return profile->angularDeceleration;
+        case LSS_Profile_FilterPositionCount:     return profile->filterPositionCount;
+        default:                                  return 0;
+    }
+}
+
+// Read a single character from the bus, returns -1 on timeout or bus error (reason left in status)
+static int16_t timed_read(const LSS* lss, LSS_LastCommStatus* status)
+{
+	uint8_t val = 0;
+
+	// The reply follows the echo in the reception send_frame armed
+	LSS_BusConfig* bus = bus_config(lss->huart, false);
+	if (bus != NULL && bus->receiving)
+	{
+		if (bus->rxRead >= sizeof(bus->rxBuffer) ||
+		    !wait_received(lss->huart, bus->rxRead + 1, lss->msgCharTimeout))
+		{
+			*status = LSS_CommStatus_ReadTimeout;
+			return -1;
+		}
+		return bus->rxBuffer[bus->rxRead++];
+	}
+
+	HAL_StatusTypeDef halStatus;
+	if (waitStrategy == &LSS_WaitBusy)
+	{
+		halStatus = HAL_UART_Receive(lss->huart, &val, 1, lss->msgCharTimeout);
+	}
+	else
+	{
+		halStatus = receive_waiting(lss->huart, &val, 1, lss->msgCharTimeout);
+	}
+
+	if (halStatus == HAL_OK)
+	{
+		return val;
+	}
+	else if (halStatus == HAL_TIMEOUT || halStatus == HAL_BUSY)
+	{
+		*status = LSS_CommStatus_ReadTimeout;
+		return -1;
+	}
+	else
+	{
+		*status = LSS_CommStatus_ReadNoBus;
+		return -1;
+	}
+}
+
+
+// Interrupt-driven HAL_UART_Receive, waiting through the wait strategy instead of spinning
+static HAL_StatusTypeDef receive_waiting(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size,
+                                         uint32_t timeout)
+{
+    HAL_StatusTypeDef halStatus = HAL_UART_Receive_IT(huart, data, size);
+    if (halStatus != HAL_OK)
+    {
+        return halStatus;
+    }
+
+    return wait_reception(huart, timeout);
+}
+
+// Wait for a reception started with HAL_UART_Receive_IT to complete, it's aborted on timeout
+static HAL_StatusTypeDef wait_reception(UART_HandleTypeDef* huart, uint32_t timeout)
+{
+    uint32_t start = HAL_GetTick();
+    while (true)
+    {
+        LSS_PORT_RX_PUMP(huart);
+        if (huart->RxState == HAL_UART_STATE_READY)
+        {
+            return HAL_OK;
+        }
+
+        uint32_t elapsed = HAL_GetTick() - start;
+        if (elapsed >= timeout)
+        {
+            HAL_UART_AbortReceive_IT(huart);
+            return HAL_TIMEOUT;
+        }
+        wait_bytes(huart, timeout - elapsed);
+    }
+}
+
+// Wait for count bytes of a reception started with HAL_UART_Receive_IT, false on timeout (it's left running)
+static bool wait_received(UART_HandleTypeDef* huart, uint16_t count, uint32_t timeout)
+{
+    uint32_t start = HAL_GetTick();
+    while (true)
+    {
+        LSS_PORT_RX_PUMP(huart);
+        if ((uint16_t)(huart->RxXferSize - huart->RxXferCount) >= count)
+        {
+            return true;
+        }
+
+        uint32_t elapsed = HAL_GetTick() - start;
+        if (elapsed >= timeout)
+        {
+            return false;
+        }
+        wait_bytes(huart, timeout - elapsed);
+    }
+}
+
+static void set_read_timeouts(LSS* lss, uint32_t startResponseTimeout, uint32_t msgCharTimeout)
+{
+    lss->msgCharTimeout = msgCharTimeout;
+}
+
+static void init_bus(UART_HandleTypeDef* huart, uint32_t baud)
+{
+	huart->Init.BaudRate = baud;
+
+	if (HAL_UART_Init(huart) != HAL_OK)
+	{
+		error_handler();
+	}
+}
+
+// Close the bus (stream), free pins and null reference
+static void close_bus(LSS* lss)
+{
+	if (HAL_UART_DeInit(lss->huart) != HAL_OK)
+	{
+		error_handler();
+	}
+}
+
+
+/* ------- */
+/* Writing */
+
+/* Send a built frame, every single-servo command goes through here.
+ * On an echoing bus, one reception covers the echo and the reply after it: the echo is checked once
+ * the frame is out and the reception is left running, so no reply byte arrives while nothing is
+ * receiving. receive_reply reads the reply from it, the next frame on the bus stops it. */
+static LSS_LastCommStatus send_frame(const LSS* lss, const char* cmd, uint8_t* frame, uint16_t length)
+{
+    LSS_BusConfig* bus    = bus_config(lss->huart, false);
+    bool           echoed = (bus != NULL && bus->duplex == LSS_Duplex_Echo);
+    if (echoed)
+    {
+        assert_param(length <= LSS_MAX_TOTAL_COMMAND_LENGTH);
+        stop_reception(lss->huart);
+        if (HAL_UART_Receive_IT(lss->huart, bus->rxBuffer, sizeof(bus->rxBuffer)) != HAL_OK)
+        {
+            return LSS_CommStatus_WriteNoBus;
+        }
+        bus->receiving = true;
+        bus->rxRead    = length;
+    }
+
+    TRACE(lss->huart, lss->servoID, LSS_Trace_Tx, true, cmd);
+    HAL_StatusTypeDef status = transmit_frame(lss->huart, frame, length, lss->msgCharTimeout);
+    TRACE(lss->huart, lss->servoID, LSS_Trace_Tx, false, cmd);
+
+    if (status != HAL_OK)
+    {
+        stop_reception(lss->huart);
+        return LSS_CommStatus_WriteNoBus;
+    }
+    if (echoed && (!wait_received(lss->huart, length, lss->msgCharTimeout) ||
+                   memcmp(bus->rxBuffer, frame, length) != 0))
+    {
+        stop_reception(lss->huart);
+        return LSS_CommStatus_WriteUnknown;
+    }
+
+    return LSS_CommStatus_WriteSuccess;
+}
+
+// Blocking transmit, turning a switched single-wire bus around on each side of the frame
+static HAL_StatusTypeDef transmit_frame(UART_HandleTypeDef* huart, const uint8_t* frame, uint16_t length,
+                                        uint32_t timeout)
+{
+    if (duplex_mode(huart) != LSS_Duplex_Switched)
+    {
+        return HAL_UART_Transmit(huart, (uint8_t*)frame, length, timeout);
+    }
+
+    HAL_HalfDuplex_EnableTransmitter(huart);
+    HAL_StatusTypeDef status = HAL_UART_Transmit(huart, (uint8_t*)frame, length, timeout);
+    HAL_HalfDuplex_EnableReceiver(huart);
+    return status;
+}
+
+// Abort the reception send_frame left armed on an echoing bus, if any
+static void stop_reception(UART_HandleTypeDef* huart)
+{
+    LSS_BusConfig* bus = bus_config(huart, false);
+    if (bus != NULL && bus->receiving)
+    {
+        HAL_UART_AbortReceive_IT(huart);
+        bus->receiving = false;
+    }
+}
+
+// Settings of a bus, NULL if it has none (and create is false or every entry is taken)
+static LSS_BusConfig* bus_config(UART_HandleTypeDef* huart, bool create)
+{
+    for (uint8_t b = 0; b < LSS_MAX_BUSES; b++)
+    {
+        if (busConfigs[b].huart == huart)
+        {
+            return &busConfigs[b];
+        }
+        if (busConfigs[b].huart == NULL)
+        {
+            if (create)
+            {
+                busConfigs[b].huart = huart;
+                return &busConfigs[b];
+            }
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+static LSS_DuplexMode duplex_mode(UART_HandleTypeDef* huart)
+{
+    const LSS_BusConfig* bus = bus_config(huart, false);
+    return (bus != NULL) ? bus->duplex : LSS_Duplex_Full;
+}
+
+static bool write_frame(LSS* lss, const char* cmd, uint8_t* frame, uint16_t length)
+{
+    if (!health_allows(lss))
+    {
+        lss->lastCommStatus = LSS_CommStatus_ServoDown;
+        return false;
+    }
+
+    lss->lastCommStatus = send_frame(lss, cmd, frame, length);
+    health_update(lss, lss->lastCommStatus);
+    return lss->lastCommStatus == LSS_CommStatus_WriteSuccess;
+}
+
+// Build a query frame, with the query type parameter when the query takes one
+static uint16_t build_query(uint8_t* buffer, uint8_t servoID, LSS_QueryCommand query, LSS_QueryType queryType)
+{
+    if (queryInfo[query].typed)
+    {
+        return snprintf((char*)buffer, LSS_MAX_TOTAL_COMMAND_LENGTH,
+                        "%s%d%s%d%c",
+                        LSS_COMMAND_START, servoID, queryInfo[query].cmd, queryType, LSS_COMMAND_END);
+    }
+    else
+    {
+        return snprintf((char*)buffer, LSS_MAX_TOTAL_COMMAND_LENGTH,
+                        "%s%d%s%c",
+                        LSS_COMMAND_START, servoID, queryInfo[query].cmd, LSS_COMMAND_END);
+    }
+}
+
+/* Write a move (D or MD, with a T parameter if timed), through the encoder if the bus has it.
+ * A relative move can only become absolute, and the other way around, when the servo is known to be
+ * at its last target. */
+static bool write_move(LSS* lss, const char* cmd, int16_t value, bool timed, int16_t tValue)
+{
+    const LSS_BusConfig* bus = bus_config(lss->huart, false);
+    if (bus == NULL || !bus->encoder)
+    {
+        return timed ? generic_write_val_param(lss, cmd, value, LSS_ACTION_PARAMETER_TIME, tValue)
+                     : generic_write_val(lss, cmd, value);
+    }
+
+    uint8_t  frame[LSS_MAX_TOTAL_COMMAND_LENGTH];
+    uint16_t written = format_move(NULL, lss->servoID, cmd, value, 0) +
+                       (timed ? snprintf(NULL, 0, "%s%d", LSS_ACTION_PARAMETER_TIME, tValue) : 0);
+    uint16_t length  = 0;
+
+    bool relative = (strcmp(cmd, LSS_ACTION_MOVE_RELATIVE) == 0);
+    if (relative && !at_target(lss))
+    {
+        length = format_move(frame, lss->servoID, cmd, value, timed ? tValue : 0);
+    }
+    else
+    {
+        length = encode_move(frame, lss, relative ? lss->targetPosition + value : value, timed ? tValue : 0);
+    }
+
+    count_encoded(written, length);
+    return write_frame(lss, cmd, frame, length);
+}
+
+// Shortest frame moving the servo to an absolute position, returns its length
+static uint16_t encode_move(uint8_t* buffer, const LSS* lss, int32_t position, int16_t tValue)
+{
+    uint16_t length = format_move(buffer, lss->servoID, LSS_ACTION_MOVE, position, tValue);
+    if (at_target(lss) &&
+        format_move(NULL, lss->servoID, LSS_ACTION_MOVE_RELATIVE, position - lss->targetPosition, tValue) < length)
+    {
+        length = format_move(buffer, lss->servoID, LSS_ACTION_MOVE_RELATIVE, position - lss->targetPosition, tValue);
+    }
+    return length;
+}
+
+/* Format a move frame, with the T parameter only if tValue > 0.
+ * buffer may be NULL to get the length only. */
+static uint16_t format_move(uint8_t* buffer, uint8_t servoID, const char* cmd, int32_t value, int16_t tValue)
+{
+    uint16_t size = (buffer != NULL) ? LSS_MAX_TOTAL_COMMAND_LENGTH : 0;
+    if (tValue > 0)
+    {
+        return snprintf((char*)buffer, size, "%s%d%s%d%s%d%c",
+                        LSS_COMMAND_START, servoID, cmd, (int)value, LSS_ACTION_PARAMETER_TIME, tValue, LSS_COMMAND_END);
+    }
+    return snprintf((char*)buffer, size, "%s%d%s%d%c", LSS_COMMAND_START, servoID, cmd, (int)value, LSS_COMMAND_END);
+}
+
+// True if the servo was last read back exactly at its target, after that target was sent
+static bool at_target(const LSS* lss)
+{
+    return lss->targetValid && lss->lastPositionValid && lss->lastPosition == lss->targetPosition &&
+           (int32_t)(lss->lastPositionTick - lss->targetTick) >= 0;
+}
+
+// True if the lane holds every servo of the bus, so a broadcast reaches exactly them
+static bool covers_bus(const LSS_BusConfig* bus, LSS* servos[], const LSS_Lane* lane)
+{
+    if (bus->servoCount == 0 || lane->count != bus->servoCount)
+    {
+        return false;
+    }
+    for (uint8_t j = 0; j < lane->count; j++)
+    {
+        for (uint8_t k = j + 1; k < lane->count; k++)
+        {
+            if (servos[lane->batch[j]]->servoID == servos[lane->batch[k]]->servoID)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void count_encoded(uint16_t written, uint16_t sent)
+{
+    encoderStats.frames++;
+    encoderStats.bytes += sent;
+    encoderStats.saved += written - sent;
+}
+
+/* Build & write a LSS command to the bus using the provided ID (no value)
+ * Max size for cmd = (LSS_MAX_TOTAL_COMMAND_LENGTH - 1) */
+static bool generic_write(LSS* lss, const char* cmd)
+{
+	uint8_t command[LSS_MAX_TOTAL_COMMAND_LENGTH] = {'\0'};
+
+	uint16_t len = snprintf((char*)command, LSS_MAX_TOTAL_COMMAND_LENGTH,
+							"%s%d%s%c",
+							LSS_COMMAND_START,
+							lss->servoID,
+							cmd,
+							LSS_COMMAND_END);
+
+	return write_frame(lss, cmd, command, len);
+}
+
+/* Build & write a LSS command to the bus using the provided ID and value
+ * Max size for cmd = (LSS_MAX_TOTAL_COMMAND_LENGTH - 1) */
+static bool generic_write_val(LSS* lss, const char* cmd, int16_t value)
+{
+    uint8_t command[LSS_MAX_TOTAL_COMMAND_LENGTH] = {'\0'};
+
+	uint16_t len = snprintf((char*)command, LSS_MAX_TOTAL_COMMAND_LENGTH,
+							"%s%d%s%d%c",
+							LSS_COMMAND_START,
+							lss->servoID,
+							cmd,
+							value,
+							LSS_COMMAND_END);
+
+	return write_frame(lss, cmd, command, len);
+}
+
+// Build & write a LSS command to the bus using the provided ID and value
+// Max size for cmd = (LSS_MAX_TOTAL_COMMAND_LENGTH - 1)
+static bool generic_write_val_param(LSS* lss, const char* cmd, int16_t value,
+                                    const char* parameter, int16_t parameter_value)
+{
+    uint8_t command[LSS_MAX_TOTAL_COMMAND_LENGTH] = {'\0'};
+
+	uint16_t len = snprintf((char*)command, LSS_MAX_TOTAL_COMMAND_LENGTH,
+							"%s%d%s%d%s%d%c",
+							LSS_COMMAND_START,
+							lss->servoID,
+							cmd,
+							value,
+							parameter,
+							parameter_value,
+							LSS_COMMAND_END);
+
+	return write_frame(lss, cmd, command, len);
+}
+
+
+/* ------- */
+/* Reading */
+
+static char* generic_read_str(LSS* lss, const char* cmd)
+{
+    TRACE(lss->huart, lss->servoID, LSS_Trace_Turnaround, true, cmd);
+    lss->lastCommStatus = receive_reply(lss, cmd, lss->values, sizeof(lss->values), &lss->lastReplyTick,
+                                        &lss->lastReplyStamp);
+    TRACE(lss->huart, lss->servoID, LSS_Trace_Transaction, false, cmd);
+    health_update(lss, lss->lastCommStatus);
+
+    return (lss->lastCommStatus == LSS_CommStatus_ReadSuccess) ? lss->values : NULL;
+}
+
+/* Read the reply to cmd from the bus, its value is stored as a string in value.
+ * timestamp and stamp (may be NULL) receive the HAL tick and LSS_timestamp() at which the reply started. */
+static LSS_LastCommStatus receive_reply(const LSS* lss, const char* cmd, char* value, uint16_t size,
+                                        uint32_t* timestamp, uint32_t* stamp)
+{
+    LSS_LastCommStatus status = read_reply(lss, cmd, value, size, timestamp, stamp);
+    stop_reception(lss->huart);
+    return status;
+}
+
+static LSS_LastCommStatus read_reply(const LSS* lss, const char* cmd, char* value, uint16_t size,
+                                     uint32_t* timestamp, uint32_t* stamp)
+{
+    LSS_LastCommStatus status = LSS_CommStatus_ReadUnknown;
+
+    // Read from bus until first character; exit if not found before timeout
+    int16_t c = 0;
+    do
+    {
+        c = timed_read(lss, &status);
+        if (c == -1)
+        {
+            return status;
+        }
+
+    } while (c != LSS_COMMAND_REPLY_START[0]);
+
+    uint32_t arrival = LSS_PORT_TIMESTAMP();
+    uint32_t start   = HAL_GetTick();
+    if (timestamp != NULL)
+    {
+        *timestamp = start;
+    }
+    if (stamp != NULL)
+    {
+        *stamp = arrival;
+    }
+    TRACE(lss->huart, lss->servoID, LSS_Trace_Turnaround, false, cmd);
+    TRACE(lss->huart, lss->servoID, LSS_Trace_Rx,         true,  cmd);
+
+
+    // Ok we have the * now now lets get the servo ID from the message.
+    // The first non-digit character is the start of the command identifier.
+    uint16_t readID = 0;
+    uint16_t digits = 0;
+    c = timed_read(lss, &status);
+    while (c != -1 && is_09((char)c) && digits < sizeof("255") - 1)     // digits < 3
+    {
+        readID = readID * 10 + c - '0';
+        digits++;
+        c = timed_read(lss, &status);
+    }
+    if (c == -1)
+    {
+        return status;
+    }
+    if (digits == 0 || readID != lss->servoID)
+    {
+        return LSS_CommStatus_ReadWrongID;
+    }
+
+    // Now lets validate the right CMD
+    uint16_t len = strlen(cmd);
+    for (uint16_t i = 0; i < len; i++)
+    {
+        if (i > 0)
+        {
+            c = timed_read(lss, &status);
+            if (c == -1)
+            {
+                return status;
+            }
+        }
+        if (c != cmd[i])
+        {
+            return LSS_CommStatus_ReadWrongIdentifier;
+        }
+    }
+
+    for (uint16_t i = 0; i < size; i++)
+    {
+        c = timed_read(lss, &status);
+        if (c == -1)
+        {
+            return status;
+        }
+        else if (c == LSS_COMMAND_END)
+        {
+            value[i] = '\0';
+            TRACE(lss->huart, lss->servoID, LSS_Trace_Rx, false, cmd);
+            report_reply(lss->servoID, cmd, value, start);
+            return LSS_CommStatus_ReadSuccess;
+        }
+        else
+        {
+            value[i] = (char)c;
+        }
+    }
+
+    return LSS_CommStatus_ReadWrongFormat;
+}
+
+
+// Give a successful reply to the reply hooks, if it's numeric
+static void report_reply(uint8_t servoID, const char* cmd, const char* value, uint32_t timestamp)
+{
+    int32_t number = 0;
+    if (replyHookCount > 0 && str_to_int((char*)value, &number))
+    {
+        for (uint8_t i = 0; i < replyHookCount; i++)
+        {
+            replyHooks[i](replyHookContexts[i], servoID, cmd, number, timestamp);
+        }
+    }
+}
+
+static uint16_t generic_read_s16(LSS* lss, const char* cmd)
+{
+    // Let the string function do all of the main parsing work.
     char *valueStr = generic_read_str(lss, cmd);
     if (valueStr == NULL)
     {
@@ -842,3 +2646,512 @@ static uint16_t generic_read_s16(LSS* lss, const char* cmd)
         return value;
     }
 } 
+
+
+/* ------- */
+/* Waiting */
+static void wait_bytes(UART_HandleTypeDef* huart, uint32_t timeout)
+{
+    waitStrategy->wait(waitStrategy->context, huart, timeout);
+}
+
+// HAL_Delay going through the wait strategy
+static void sleep_for(uint32_t duration)
+{
+    uint32_t start   = HAL_GetTick();
+    uint32_t elapsed = 0;
+    while ((elapsed = HAL_GetTick() - start) < duration)
+    {
+        wait_bytes(NULL, duration - elapsed);
+    }
+}
+
+static void wait_busy(void* context, UART_HandleTypeDef* huart, uint32_t timeout)
+{
+    (void)context;
+    (void)huart;
+    (void)timeout;
+}
+
+static void wait_yield(void* context, UART_HandleTypeDef* huart, uint32_t timeout)
+{
+    (void)context;
+    (void)huart;
+    (void)timeout;
+    LSS_yield();
+}
+
+// Woken by the next interrupt (UART, SysTick...), callers check their condition again
+static void wait_sleep(void* context, UART_HandleTypeDef* huart, uint32_t timeout)
+{
+    (void)context;
+    LSS_PORT_SLEEP(huart, timeout);
+}
+
+
+/* ---------- */
+/* Pipelining */
+
+// Send a command to every servo, with its value (values may be NULL for none), all buses at the same time
+static bool write_group(LSS* servos[], uint8_t n, const char* cmd, const int16_t values[])
+{
+    bool handled[LSS_GROUP_MAX_SIZE] = {false};
+    bool success = true;
+
+    uint8_t laneCount = 0;
+    while ((laneCount = gather_lanes(servos, n, handled, false)) > 0)
+    {
+        for (uint8_t l = 0; l < laneCount; l++)
+        {
+            LSS_Lane* lane = &lanes[l];
+            for (uint8_t j = 0; j < lane->count; j++)
+            {
+                uint8_t* buffer = &lane->txBuffer[lane->txLength];
+                uint8_t  id     = servos[lane->batch[j]]->servoID;
+                lane->txLength += (values != NULL)
+                                ? format_move(buffer, id, cmd, values[lane->batch[j]], 0)
+                                : snprintf((char*)buffer, LSS_MAX_TOTAL_COMMAND_LENGTH, "%s%d%s%c",
+                                           LSS_COMMAND_START, id, cmd, LSS_COMMAND_END);
+            }
+
+            // Every servo of the bus getting the same value: a single broadcast frame does it
+            const LSS_BusConfig* bus       = bus_config(lane->huart, false);
+            bool                 broadcast = (bus != NULL && bus->encoder && covers_bus(bus, servos, lane));
+            for (uint8_t j = 1; broadcast && values != NULL && j < lane->count; j++)
+            {
+                broadcast = (values[lane->batch[j]] == values[lane->batch[0]]);
+            }
+
+            if (broadcast)
+            {
+                uint16_t written = lane->txLength;
+                lane->txLength   = (values != NULL)
+                                 ? format_move(lane->txBuffer, LSS_BROADCAST_ID, cmd, values[lane->batch[0]], 0)
+                                 : snprintf((char*)lane->txBuffer, LSS_MAX_TOTAL_COMMAND_LENGTH, "%s%d%s%c",
+                                            LSS_COMMAND_START, LSS_BROADCAST_ID, cmd, LSS_COMMAND_END);
+                count_encoded(written, lane->txLength);
+                encoderStats.broadcasts++;
+            }
+        }
+
+        success &= transmit_lanes(laneCount, cmd);
+
+        for (uint8_t l = 0; l < laneCount; l++)
+        {
+            for (uint8_t j = 0; j < lanes[l].count; j++)
+            {
+                servos[lanes[l].batch[j]]->lastCommStatus = (lanes[l].pending == 0) ? LSS_CommStatus_WriteSuccess
+                                                                                     : LSS_CommStatus_WriteNoBus;
+            }
+        }
+    }
+
+    return success;
+}
+
+/* Fill the lanes for the next round: up to LSS_PIPELINE_DEPTH servos per bus, up to LSS_MAX_BUSES buses.
+ * On a half-duplex bus, a reply can't share the wire with the next query: when replies are expected,
+ * those buses take one servo per round.
+ * Servos that don't fit are left for a later round. Returns the number of lanes used. */
+static uint8_t gather_lanes(LSS* servos[], uint8_t n, bool handled[], bool replies)
+{
+    uint8_t laneCount = 0;
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        if (handled[i])
+        {
+            continue;
+        }
+
+        LSS_Lane* lane = NULL;
+        for (uint8_t l = 0; l < laneCount; l++)
+        {
+            if (lanes[l].huart == servos[i]->huart)
+            {
+                lane = &lanes[l];
+                break;
+            }
+        }
+
+        if (lane == NULL)
+        {
+            if (laneCount == LSS_MAX_BUSES)
+            {
+                continue;
+            }
+
+            lane           = &lanes[laneCount++];
+            lane->huart    = servos[i]->huart;
+            lane->timeout  = servos[i]->msgCharTimeout;
+            lane->count    = 0;
+            lane->pending  = 0;
+            lane->scan     = 0;
+            lane->txLength = 0;
+            lane->echo     = 0;
+            lane->stampAt  = UINT16_MAX;
+            lane->depth    = (replies && duplex_mode(lane->huart) != LSS_Duplex_Full) ? 1 : LSS_PIPELINE_DEPTH;
+        }
+
+        if (lane->count < lane->depth)
+        {
+            lane->batch[lane->count++] = i;
+            handled[i]                 = true;
+        }
+    }
+
+    return laneCount;
+}
+
+/* Send the frames of every lane at the same time and wait for all of them to be out.
+ * On LSS_Duplex_Echo buses, the echo of a burst nobody is receiving (writes only) is read back and
+ * checked here, pipelined queries check it with the replies. On LSS_Duplex_Switched buses, the
+ * receiver is turned off for the burst and back on as soon as its last byte is out.
+ * Lanes that failed are left with pending = count, successful ones with pending = 0. */
+static bool transmit_lanes(uint8_t laneCount, const char* cmd)
+{
+    bool success = true;
+    bool echoOnly[LSS_MAX_BUSES] = {false};
+    bool switched[LSS_MAX_BUSES] = {false};
+
+    for (uint8_t l = 0; l < laneCount; l++)
+    {
+        LSS_Lane*      lane = &lanes[l];
+        LSS_DuplexMode mode = duplex_mode(lane->huart);
+        lane->pending       = lane->count;
+
+        stop_reception(lane->huart);
+        if (mode == LSS_Duplex_Echo && lane->huart->RxState == HAL_UART_STATE_READY &&
+            HAL_UART_Receive_IT(lane->huart, lane->rxBuffer, lane->txLength) == HAL_OK)
+        {
+            lane->echo  = lane->txLength;
+            echoOnly[l] = true;
+        }
+
+        TRACE(lane->huart, LSS_TRACE_GROUP_ID, LSS_Trace_Tx, true, cmd);
+
+        if (mode == LSS_Duplex_Switched)
+        {
+            HAL_HalfDuplex_EnableTransmitter(lane->huart);
+            switched[l] = true;
+        }
+        if (HAL_UART_Transmit_IT(lane->huart, lane->txBuffer, lane->txLength) == HAL_OK)
+        {
+            lane->pending = 0;
+        }
+        else
+        {
+            success = false;
+        }
+    }
+
+    /* Serve every bus until all bursts are out. While a switched bus is transmitting, poll without
+     * waiting: its reply may start a turnaround after the last byte, the receiver must be on by then. */
+    uint32_t start = HAL_GetTick();
+    UART_HandleTypeDef* waiting = lanes[0].huart;
+    while (waiting != NULL)
+    {
+        bool poll = false;
+        waiting   = NULL;
+        for (uint8_t l = 0; l < laneCount; l++)
+        {
+            LSS_Lane* lane = &lanes[l];
+            if (lane->pending == 0 && lane->huart->gState != HAL_UART_STATE_READY)
+            {
+                if (HAL_GetTick() - start < burst_timeout(lane))
+                {
+                    waiting = (waiting != NULL) ? waiting : lane->huart;
+                    poll   |= switched[l];
+                    continue;
+                }
+                HAL_UART_AbortTransmit(lane->huart);
+                lane->pending = lane->count;
+                success       = false;
+            }
+
+            if (switched[l])
+            {
+                HAL_HalfDuplex_EnableReceiver(lane->huart);
+                switched[l] = false;
+            }
+        }
+
+        if (waiting != NULL && !poll)
+        {
+            wait_bytes(waiting, LSS_WAIT_POLL_INTERVAL);
+        }
+    }
+
+    for (uint8_t l = 0; l < laneCount; l++)
+    {
+        LSS_Lane* lane = &lanes[l];
+        if (echoOnly[l])
+        {
+            if (lane->pending == 0 &&
+                (wait_reception(lane->huart, burst_timeout(lane)) != HAL_OK || !check_echo(lane)))
+            {
+                lane->pending = lane->count;
+                success       = false;
+            }
+            HAL_UART_AbortReceive_IT(lane->huart);
+        }
+
+        TRACE(lane->huart, LSS_TRACE_GROUP_ID, LSS_Trace_Tx, false, cmd);
+    }
+
+    return success;
+}
+
+// Time allowed to send a lane's burst: the servos' timeout on top of its wire time, in ms
+static uint32_t burst_timeout(const LSS_Lane* lane)
+{
+    uint32_t baud = lane->huart->Init.BaudRate;
+    return lane->timeout + ((baud > 0) ? (lane->txLength * 10000u + baud - 1) / baud : 0);
+}
+
+/* Compare the start of the reception to the burst that was sent, then skip it.
+ * A mismatch means something else was driving the wire (collision). */
+static bool check_echo(LSS_Lane* lane)
+{
+    bool match = (memcmp(lane->rxBuffer, lane->txBuffer, lane->echo) == 0);
+    lane->scan = lane->echo;
+    lane->echo = 0;
+    return match;
+}
+
+// Send one query to each servo of every lane and match the replies as they arrive
+static bool pipeline_lanes(LSS* servos[], uint8_t laneCount,
+                           LSS_QueryCommand query, LSS_QueryType queryType, LSS_Result results[])
+{
+    const char* cmd = queryInfo[query].cmd;
+
+    for (uint8_t l = 0; l < laneCount; l++)
+    {
+        LSS_Lane* lane = &lanes[l];
+        for (uint8_t j = 0; j < lane->count; j++)
+        {
+            lane->txLength += build_query(&lane->txBuffer[lane->txLength], servos[lane->batch[j]]->servoID,
+                                          query, queryType);
+
+            results[lane->batch[j]] = (LSS_Result){0, LSS_CommStatus_ReadTimeout, 0, 0};
+        }
+
+        // Start receiving before the burst goes out, so no reply is lost while still transmitting
+        stop_reception(lane->huart);
+        if (HAL_UART_Receive_IT(lane->huart, lane->rxBuffer, sizeof(lane->rxBuffer)) != HAL_OK)
+        {
+            for (uint8_t j = 0; j < lane->count; j++)
+            {
+                results[lane->batch[j]].status = LSS_CommStatus_ReadNoBus;
+            }
+            lane->txLength = 0;
+        }
+        else if (duplex_mode(lane->huart) == LSS_Duplex_Echo)
+        {
+            lane->echo = lane->txLength;
+        }
+    }
+
+    transmit_lanes(laneCount, cmd);
+
+    for (uint8_t l = 0; l < laneCount; l++)
+    {
+        LSS_Lane* lane = &lanes[l];
+        if (lane->txLength == 0)
+        {
+            // Reception could not be started
+            lane->pending = 0;
+        }
+        else if (lane->pending > 0)
+        {
+            HAL_UART_AbortReceive_IT(lane->huart);
+            for (uint8_t j = 0; j < lane->count; j++)
+            {
+                results[lane->batch[j]].status = LSS_CommStatus_WriteNoBus;
+            }
+            lane->pending = 0;
+        }
+        else
+        {
+            lane->pending = lane->count;
+        }
+    }
+
+    // Serve every bus until all replies are in or the bus timed out waiting for the next one
+    for (uint8_t l = 0; l < laneCount; l++)
+    {
+        lanes[l].lastReply = HAL_GetTick();
+    }
+
+    UART_HandleTypeDef* waiting = lanes[0].huart;
+    while (waiting != NULL)
+    {
+        waiting = NULL;
+        for (uint8_t l = 0; l < laneCount; l++)
+        {
+            LSS_Lane* lane = &lanes[l];
+            if (lane->pending == 0)
+            {
+                continue;
+            }
+
+            uint8_t pending = lane->pending;
+            collect_replies(servos, lane, cmd, results);
+            if (lane->pending < pending)
+            {
+                lane->lastReply = HAL_GetTick();
+            }
+            if (lane->pending > 0 && (HAL_GetTick() - lane->lastReply) < lane->timeout && waiting == NULL)
+            {
+                waiting = lane->huart;
+            }
+        }
+
+        if (waiting != NULL)
+        {
+            wait_bytes(waiting, LSS_WAIT_POLL_INTERVAL);
+        }
+    }
+
+    bool success = true;
+    for (uint8_t l = 0; l < laneCount; l++)
+    {
+        LSS_Lane* lane = &lanes[l];
+        if (lane->txLength > 0)
+        {
+            HAL_UART_AbortReceive_IT(lane->huart);
+        }
+        for (uint8_t j = 0; j < lane->count; j++)
+        {
+            success &= (results[lane->batch[j]].status == LSS_CommStatus_ReadSuccess);
+        }
+    }
+
+    return success;
+}
+
+// Extract every complete reply received so far on a lane
+static void collect_replies(LSS* servos[], LSS_Lane* lane, const char* cmd, LSS_Result results[])
+{
+    LSS_PORT_RX_PUMP(lane->huart);
+    uint16_t received  = lane->huart->RxXferSize - lane->huart->RxXferCount;
+    uint32_t now       = LSS_PORT_TIMESTAMP();
+    uint32_t tick      = HAL_GetTick();
+    uint32_t byteTicks = (uint32_t)((uint64_t)LSS_PORT_CLOCK * 10 / lane->huart->Init.BaudRate);
+
+    // Our own queries come back first on an echoing bus
+    if (lane->echo > 0)
+    {
+        if (received < lane->echo)
+        {
+            return;
+        }
+        if (!check_echo(lane))
+        {
+            for (uint8_t j = 0; j < lane->count; j++)
+            {
+                results[lane->batch[j]].status = LSS_CommStatus_WriteUnknown;
+            }
+            lane->pending = 0;
+            return;
+        }
+    }
+
+    while (true)
+    {
+        while (lane->scan < received && lane->rxBuffer[lane->scan] != LSS_COMMAND_REPLY_START[0])
+        {
+            lane->scan++;
+        }
+
+        /* Replies are only looked at every so often: back-date the first byte by one byte time per byte
+         * received after it, keeping the earliest estimate across polls. */
+        if (lane->scan < received)
+        {
+            uint32_t arrival = now - (uint32_t)(received - 1 - lane->scan) * byteTicks;
+            if (lane->stampAt != lane->scan || (int32_t)(arrival - lane->stamp) < 0)
+            {
+                lane->stampAt = lane->scan;
+                lane->stamp   = arrival;
+                lane->tick    = tick - (uint32_t)((uint64_t)(now - arrival) * 1000 / LSS_PORT_CLOCK);
+            }
+        }
+
+        uint16_t end = lane->scan;
+        while (end < received && lane->rxBuffer[end] != LSS_COMMAND_END)
+        {
+            end++;
+        }
+        if (end >= received)
+        {
+            return;
+        }
+
+        uint16_t valueStart = 0;
+        int16_t  id         = parse_reply(&lane->rxBuffer[lane->scan], end - lane->scan, cmd, &valueStart);
+
+        for (uint8_t j = 0; id >= 0 && j < lane->count; j++)
+        {
+            LSS_Result* result = &results[lane->batch[j]];
+            if (servos[lane->batch[j]]->servoID != id || result->status != LSS_CommStatus_ReadTimeout)
+            {
+                continue;
+            }
+
+            char     value[LSS_MAX_REPLY_LENGTH];
+            uint16_t length = end - lane->scan - valueStart;
+            if (length >= sizeof(value))
+            {
+                length = sizeof(value) - 1;
+            }
+            memcpy(value, &lane->rxBuffer[lane->scan + valueStart], length);
+            value[length] = '\0';
+
+            TRACE(lane->huart, id, LSS_Trace_Rx, false, cmd);
+
+            result->timestamp = lane->tick;
+            result->stamp     = lane->stamp;
+            if (str_to_int(value, &result->value))
+            {
+                result->status = LSS_CommStatus_ReadSuccess;
+                report_reply(id, cmd, value, result->timestamp);
+            }
+            else
+            {
+                result->value  = 0;
+                result->status = LSS_CommStatus_ReadWrongFormat;
+            }
+            lane->pending--;
+            break;
+        }
+
+        lane->scan = end + 1;
+    }
+}
+
+/* Parse a reply frame (from * up to, but excluding, \r) to the expected command.
+ * Returns the servo ID, or -1 if the frame isn't a reply to cmd. */
+static int16_t parse_reply(const uint8_t* frame, uint16_t length, const char* cmd, uint16_t* valueStart)
+{
+    uint16_t i  = 1;    // skip *
+    int16_t  id = 0;
+
+    while (i < length && i <= sizeof("255") - 1 && is_09(frame[i]))
+    {
+        id = id * 10 + frame[i] - '0';
+        i++;
+    }
+    if (i == 1)
+    {
+        return -1;
+    }
+
+    uint16_t cmdLength = strlen(cmd);
+    if (length - i < cmdLength || strncmp((const char*)&frame[i], cmd, cmdLength) != 0)
+    {
+        return -1;
+    }
+
+    *valueStart = i + cmdLength;
+    return id;
+}
@@ -20,7 +20,28 @@
 #include <stdint.h>
 #include <string.h>
 
+#ifdef LSS_PLATFORM_LINUX
+#include "LSS_Linux.h"
+#else
 #include "usart.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define LSS_GROUP_MAX_SIZE      (32)    // maximum number of servos handled by a multi-servo call
+#define LSS_PIPELINE_DEPTH      (8)     // maximum number of queries in flight on one bus
+#define LSS_MAX_BUSES           (4)     // maximum number of UARTs driven at the same time
+#define LSS_MAX_REPLY_HOOKS     (4)     // maximum number of reply hooks registered at the same time
+
+// Define LSS_TRACE in the build to record bus activity (see LSS_trace_enable)
+#ifndef LSS_TRACE_SIZE
+#define LSS_TRACE_SIZE          (256)   // number of events kept in the trace ring
+#endif
 
 
 /*************************************************************************************************/
@@ -37,7 +58,8 @@ typedef enum
     LSS_CommStatus_ReadUnknown,
     LSS_CommStatus_WriteSuccess,
     LSS_CommStatus_WriteNoBus,
-    LSS_CommStatus_WriteUnknown
+    LSS_CommStatus_WriteUnknown,
+    LSS_CommStatus_ServoDown        // nothing sent, the servo stopped answering (see LSS_set_health_hook)
 } LSS_LastCommStatus;
 
 typedef enum
@@ -117,6 +139,78 @@ typedef enum
     LSS_LED_White   = 7
 }LSS_LED_Color;
 
+//> Query commands usable in multi-servo (pipelined) calls
+typedef enum
+{
+    LSS_Query_Status,
+    LSS_Query_OriginOffset,
+    LSS_Query_AngularRange,
+    LSS_Query_PositionPulse,
+    LSS_Query_Position,
+    LSS_Query_Speed,
+    LSS_Query_SpeedRpm,
+    LSS_Query_SpeedPulse,
+    LSS_Query_MaxSpeed,
+    LSS_Query_MaxSpeedRpm,
+    LSS_Query_ColorLed,
+    LSS_Query_Gyre,
+    LSS_Query_Voltage,
+    LSS_Query_Temperature,
+    LSS_Query_Current,
+    LSS_Query_Analog,
+    LSS_Query_FirmwareVersion,
+    LSS_Query_AngularStiffness,
+    LSS_Query_AngularHoldingStiffness,
+    LSS_Query_AngularAcceleration,
+    LSS_Query_AngularDeceleration,
+    LSS_Query_MotionControl,
+    LSS_Query_FilterPositionCount,
+    LSS_Query_BlinkingLed,
+    LSS_Query_Last
+}LSS_QueryCommand;
+
+//> Fields of a configuration profile, combined as a bitmask
+typedef enum
+{
+    LSS_Profile_OriginOffset            = 1 << 0,
+    LSS_Profile_AngularRange            = 1 << 1,
+    LSS_Profile_MaxSpeed                = 1 << 2,
+    LSS_Profile_ColorLed                = 1 << 3,
+    LSS_Profile_Gyre                    = 1 << 4,
+    LSS_Profile_AngularStiffness        = 1 << 5,
+    LSS_Profile_AngularHoldingStiffness = 1 << 6,
+    LSS_Profile_AngularAcceleration     = 1 << 7,
+    LSS_Profile_AngularDeceleration     = 1 << 8,
+    LSS_Profile_FilterPositionCount     = 1 << 9
+}LSS_ProfileField;
+
+//> Bus phases recorded when tracing
+typedef enum
+{
+    LSS_Trace_Transaction,  // query sent until its reply is parsed (or failed)
+    LSS_Trace_Tx,           // frame(s) leaving the UART
+    LSS_Trace_Turnaround,   // waiting for the servo to start replying
+    LSS_Trace_Rx,           // reply being received
+    LSS_Trace_Cycle         // start of a control cycle, marked by the application
+}LSS_TracePhase;
+
+//> Per-servo outcome of a multi-servo wait
+typedef enum
+{
+    LSS_Wait_Pending,
+    LSS_Wait_Reached,
+    LSS_Wait_Timeout,
+    LSS_Wait_CommError
+}LSS_WaitResult;
+
+//> How a bus is wired, see LSS_set_duplex
+typedef enum
+{
+    LSS_Duplex_Full,        // separate TX and RX lines (default)
+    LSS_Duplex_Echo,        // TX and RX on the same wire, our own bytes come back on RX
+    LSS_Duplex_Switched     // single-wire UART (HAL_HalfDuplex_Init), receiver off while transmitting
+}LSS_DuplexMode;
+
 
 /*************************************************************************************************/
 /* Inline functions declarattions -------------------------------------------------------------- */
@@ -142,15 +236,116 @@ typedef struct {
     UART_HandleTypeDef* huart;
     
     char values[24];
+
+    // Motion bookkeeping, used to predict when a move will be done without polling the bus
+    bool     targetValid;
+    int32_t  targetPosition;    // last commanded position, in 1/10°
+    uint16_t targetTime;        // T parameter of the last move, in ms (0 if none)
+    uint32_t targetTick;        // HAL tick at which the last move was sent
+    int32_t  lastPosition;      // last position read back, in 1/10°
+    bool     lastPositionValid;
+    uint16_t maxSpeed;          // cached max speed, in (1/10°)/s (0 if unknown)
+    uint32_t lastReplyTick;     // HAL tick at which the last reply started
+    uint32_t lastReplyStamp;    // LSS_timestamp() when the last reply's first byte arrived
+
+    // State estimation (LSS_estimate), from the last samples and the last move
+    uint32_t lastPositionTick;      // HAL tick of lastPosition
+    int32_t  lastSpeed;             // last speed read back or derived from positions, in (1/10°)/s
+    uint32_t lastSpeedTick;
+    bool     lastSpeedValid;
+    int32_t  predictionError;       // last position sample minus its prediction, in 1/10°
+    uint32_t predictionErrorSum;    // sum of |predictionError|, divide by predictionCount for the mean
+    uint32_t predictionCount;
+
+    // Health (circuit breaker), a servo that stops answering is skipped until it answers a probe again
+    uint8_t  failures;              // consecutive ReadTimeout / WriteNoBus
+    bool     down;
+    uint32_t probeTick;             // HAL tick of the next probe while down
+    uint16_t probeInterval;         // in ms, doubles after every failed probe
 } LSS;
 
 
+//> Settings applied in bulk by LSS_apply_profile, only fields set in the mask are touched
+typedef struct {
+    uint16_t    fields;     // LSS_ProfileField bitmask
+    LSS_SetType setType;
+
+    int16_t        originOffset;
+    uint16_t       angularRange;
+    uint16_t       maxSpeed;
+    LSS_LED_Color  colorLed;
+    LSS_ConfigGyre gyre;
+    int8_t         angularStiffness;
+    int8_t         angularHoldingStiffness;
+    int16_t        angularAcceleration;
+    int16_t        angularDeceleration;
+    int16_t        filterPositionCount;
+} LSS_Profile;
+
+
+//> Value returned by a query along with how it went
+typedef struct {
+    int32_t            value;
+    LSS_LastCommStatus status;
+    uint32_t           timestamp;   // HAL tick at which the reply started
+    uint32_t           stamp;       // LSS_timestamp() when the reply's first byte arrived
+} LSS_Result;
+
+//> Traced bus event
+typedef struct {
+    uint32_t timestamp;     // LSS_timestamp()
+    uint8_t  servoID;
+    uint8_t  phase;         // LSS_TracePhase
+    bool     begin;
+    uint8_t  bus;           // index of the UART among the buses the library knows, 255 for none
+    char     tag[6];        // command identifier, not null-terminated when 6 characters long
+} LSS_TraceEvent;
+
+//> Servos spread over several UARTs
+typedef struct {
+    UART_HandleTypeDef* huarts[LSS_MAX_BUSES];
+    uint8_t             busCount;
+    uint32_t            load[LSS_MAX_BUSES];    // expected load assigned to each bus
+} LSS_MultiBus;
+
+//> Wire bytes saved by the encoder (LSS_set_encoder), over every bus
+typedef struct {
+    uint32_t frames;        // frames that went through the encoder, a broadcast counts as one
+    uint32_t bytes;         // bytes sent for them
+    uint32_t saved;         // bytes saved compared to the frames as the caller wrote them
+    uint32_t broadcasts;    // group frames merged into a broadcast
+} LSS_EncoderStats;
+
+/*> How the library waits for bytes (replies, end of transmission) and between polls.
+ *  wait returns once bytes may have arrived on huart (NULL: plain delay) or after timeout ms, it may
+ *  return early: callers check their own condition and deadline again.
+ *  notify (may be NULL) is called by LSS_notify_from_isr.
+ *  Ex: FreeRTOS task notification
+ *      static void rtos_wait  (void* task, UART_HandleTypeDef* huart, uint32_t timeout) { ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout)); }
+ *      static void rtos_notify(void* task) { vTaskNotifyGiveFromISR(task, NULL); }
+ *      static LSS_WaitStrategy rtos = {rtos_wait, rtos_notify, NULL};   // context = servo task handle */
+typedef struct {
+    void  (*wait)  (void* context, UART_HandleTypeDef* huart, uint32_t timeout);
+    void  (*notify)(void* context);
+    void*   context;
+} LSS_WaitStrategy;
+
+/*> Called with every numeric reply read successfully (single and pipelined reads), ex: to log telemetry.
+ *  cmd is the reply's command ("QD", "QC"...), timestamp the HAL tick at which the reply started. */
+typedef void (*LSS_ReplyHook)(void* context, uint8_t servoID, const char* cmd, int32_t value,
+                              uint32_t timestamp);
+
+//> Called when a servo goes down (up = false) and when it answers again (up = true)
+typedef void (*LSS_HealthHook)(void* context, LSS* lss, bool up);
+
+
 /*************************************************************************************************/
 /* Public functions declarations --------------------------------------------------------------- */
 
 /* ----------- */
 /* Constructor */
 void LSS_init(LSS* lss, uint8_t id, UART_HandleTypeDef* huart, uint32_t baud);
+void LSS_init_handle(LSS* lss, uint8_t id, UART_HandleTypeDef* huart, uint32_t timeout);
 
 
 /* ------- */
@@ -227,6 +422,95 @@ bool set_blinking_led             (LSS* lss, uint8_t value);
 bool set_motion_control_enabled   (LSS* lss, bool    value);
 
 
+/* ------------------------ */
+/* Queries (result-carrying) */
+LSS_Result LSS_query(LSS* lss, LSS_QueryCommand query, LSS_QueryType queryType);
+
+
+/* ---------------------------------------- */
+/* Prebuilt frames (ex: built at compile time) */
+bool       LSS_send_frame (LSS* lss, const uint8_t* frame, uint16_t length);
+LSS_Result LSS_query_frame(LSS* lss, const char* cmd, const uint8_t* frame, uint16_t length);
+void       LSS_track_target(LSS* lss, int32_t position, uint16_t time);
+void       LSS_clear_target(LSS* lss);
+
+
+/* ---------------- */
+/* State estimation */
+bool LSS_estimate       (const LSS* lss, uint32_t tick, int32_t* position, int32_t* velocity);
+void LSS_estimate_sample(LSS* lss, LSS_QueryCommand query, const LSS_Result* result);
+
+uint32_t LSS_timestamp      (void);     // DWT cycles on target (ms without DWT), µs on Linux
+uint32_t LSS_timestamp_clock(void);     // LSS_timestamp ticks per second
+bool     LSS_align_results  (const LSS_Result previous[], const LSS_Result current[], uint8_t n,
+                             uint32_t stamp, int32_t aligned[]);
+
+
+/* ------------ */
+/* Multi-servos */
+// Not reentrant: group functions share the library's lane storage, one call at a time (see LSS.c)
+bool LSS_wait_reached(LSS* servos[], uint8_t n, uint16_t tolerance, uint32_t deadline,
+                      LSS_WaitResult results[]);
+
+bool LSS_query_pipelined(LSS* servos[], uint8_t n, LSS_QueryCommand query, LSS_QueryType queryType,
+                         int32_t values[]);
+bool LSS_query_results  (LSS* servos[], uint8_t n, LSS_QueryCommand query, LSS_QueryType queryType,
+                         LSS_Result results[]);
+bool LSS_apply_profile  (LSS* servos[], uint8_t n, const LSS_Profile* profile, uint16_t mismatches[]);
+bool LSS_move_group     (LSS* servos[], uint8_t n, const int16_t positions[], int16_t tValue);
+bool LSS_wheel_group    (LSS* servos[], uint8_t n, const int16_t speeds[]);
+bool LSS_wheel_rpm_group(LSS* servos[], uint8_t n, const int8_t rpm[]);
+bool LSS_reset_group    (LSS* servos[], uint8_t n, uint32_t deadline, bool ready[], uint32_t readyTime[]);
+
+
+/* --------- */
+/* Multi-bus */
+void LSS_multibus_init  (LSS_MultiBus* bus, UART_HandleTypeDef* huarts[], uint8_t busCount);
+void LSS_multibus_assign(LSS_MultiBus* bus, LSS* servos[], uint8_t n, const uint16_t weights[]);
+void LSS_set_duplex     (UART_HandleTypeDef* huart, LSS_DuplexMode mode);
+
+
+/* ------- */
+/* Encoder */
+void LSS_set_encoder  (UART_HandleTypeDef* huart, bool enable, uint8_t servoCount);
+void LSS_encoder_stats(LSS_EncoderStats* stats, bool reset);
+
+
+/* ------- */
+/* Waiting */
+extern const LSS_WaitStrategy LSS_WaitBusy;     // spin, blocking HAL receive (default on target)
+extern const LSS_WaitStrategy LSS_WaitYield;    // give the CPU to other tasks with LSS_yield
+extern const LSS_WaitStrategy LSS_WaitSleep;    // WFI until the next interrupt (default on Linux: poll)
+#ifdef LSS_PLATFORM_LINUX
+extern const LSS_WaitStrategy LSS_WaitCondition;    // condition variable, signaled by LSS_linux_start_rx_thread
+#endif
+
+void LSS_set_wait_strategy(const LSS_WaitStrategy* strategy);
+void LSS_notify_from_isr  (void);   // call from HAL_UART_RxCpltCallback and HAL_UART_TxCpltCallback
+void LSS_yield            (void);   // weak, ex: osThreadYield() with an RTOS
+
+
+/* ------- */
+/* Replies */
+void LSS_set_reply_hook   (LSS_ReplyHook hook, void* context);  // replaces every hook, hook may be NULL
+bool LSS_add_reply_hook   (LSS_ReplyHook hook, void* context);  // false if LSS_MAX_REPLY_HOOKS are registered
+void LSS_remove_reply_hook(LSS_ReplyHook hook, void* context);
+
+
+/* ------ */
+/* Health */
+void LSS_set_health_hook(LSS_HealthHook hook, void* context);   // hook may be NULL
+
+
+#ifdef LSS_TRACE
+/* ------- */
+/* Tracing */
+void     LSS_trace_enable(void);
+void     LSS_trace_cycle (void);
+uint32_t LSS_trace_export(uint8_t* buffer, uint32_t size);
+#endif
+
+
 /*************************************************************************************************/
 /* Inline functions definitions - -------------------------------------------------------------- */
 inline static bool is_AF(char c)
@@ -267,6 +551,11 @@ inline static uint8_t convert_hex(char c)
            0;
 }
 
+inline static bool LSS_result_ok(LSS_Result result)
+{
+    return result.status == LSS_CommStatus_ReadSuccess;
+}
+
 inline static bool str_to_int(char* inputstr, int32_t* intnum)
 {
     const int8_t MAX_LENGTH = 11;
@@ -344,6 +633,10 @@ inline static bool str_to_int(char* inputstr, int32_t* intnum)
 }
 
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
 /*************************************************************************************************/
 /* ----- END OF FILE ----- */
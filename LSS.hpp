@@ -0,0 +1,314 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Header-only C++17 layer over LSS.c.
+ *                  Servo IDs are template parameters, so every fixed frame (limp, hold, queries...)
+ *                  is built at compile time and value-carrying commands only encode their numbers at
+ *                  runtime, without snprintf. Queries return strongly typed results.
+ *                  Nothing is allocated on the heap.
+ *
+ *  Usage:
+ *      lss::Bus      bus{&huart1};
+ *      lss::Servo<5> elbow{bus};
+ *      elbow.move(lss::Angle{900}, 500);
+ *      if (auto position = elbow.position()) { use(position.value.tenths); }
+ */
+#ifndef LSS_HPP
+#define LSS_HPP
+
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "LSS.h"
+
+
+namespace lss
+{
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+constexpr uint8_t  broadcastId    = 254;
+constexpr uint32_t defaultTimeout = 100;    // in ms
+
+
+/*************************************************************************************************/
+/* Units --------------------------------------------------------------------------------------- */
+struct Angle            // in 1/10°
+{
+    int32_t tenths;
+
+    constexpr float degrees() const { return tenths / 10.0f; }
+    constexpr float radians() const { return tenths * (3.14159265f / 1800.0f); }
+};
+
+struct AngularSpeed     // in (1/10°)/s
+{
+    int32_t tenthsPerSecond;
+};
+
+struct Millivolts
+{
+    int32_t value;
+};
+
+struct Milliamps
+{
+    int32_t value;
+};
+
+struct Temperature      // in 1/10 °C
+{
+    int32_t tenths;
+
+    constexpr float celsius() const { return tenths / 10.0f; }
+};
+
+template<typename T>
+struct Result
+{
+    T                  value;
+    LSS_LastCommStatus status;
+    uint32_t           timestamp;  // HAL tick at which the reply started
+    uint32_t           stamp;      // LSS_timestamp() when the reply's first byte arrived
+
+    constexpr bool ok() const { return status == LSS_CommStatus_ReadSuccess; }
+    constexpr explicit operator bool() const { return ok(); }
+};
+
+
+/*************************************************************************************************/
+/* Frame building ------------------------------------------------------------------------------ */
+namespace detail
+{
+constexpr std::size_t maxFrameLength = 31;
+
+template<std::size_t N>
+struct Frame
+{
+    std::array<uint8_t, N> bytes{};
+    std::size_t            size = 0;
+
+    constexpr void push(char c) { bytes[size++] = static_cast<uint8_t>(c); }
+};
+
+// "#<id><cmd>", the common prefix of every frame sent to a servo
+template<uint8_t Id, std::size_t CmdSize>
+constexpr auto prefix(const char (&cmd)[CmdSize])
+{
+    Frame<1 + 3 + CmdSize - 1> frame{};
+    frame.push('#');
+    if (Id >= 100) { frame.push(static_cast<char>('0' + Id / 100)); }
+    if (Id >= 10)  { frame.push(static_cast<char>('0' + (Id / 10) % 10)); }
+    frame.push(static_cast<char>('0' + Id % 10));
+    for (std::size_t i = 0; i < CmdSize - 1; i++)
+    {
+        frame.push(cmd[i]);
+    }
+    return frame;
+}
+
+// "#<id><cmd>\r", a complete frame without value
+template<uint8_t Id, std::size_t CmdSize>
+constexpr auto fixed(const char (&cmd)[CmdSize])
+{
+    auto                           head = prefix<Id>(cmd);
+    Frame<1 + 3 + CmdSize - 1 + 1> frame{};
+    for (std::size_t i = 0; i < head.size; i++)
+    {
+        frame.push(static_cast<char>(head.bytes[i]));
+    }
+    frame.push('\r');
+    return frame;
+}
+
+// Append a signed integer in decimal, returns the new length
+inline std::size_t encode(uint8_t* out, std::size_t length, int32_t value)
+{
+    uint32_t magnitude = (value < 0) ? static_cast<uint32_t>(-static_cast<int64_t>(value))
+                                     : static_cast<uint32_t>(value);
+    if (value < 0)
+    {
+        out[length++] = '-';
+    }
+
+    char        reversed[10];
+    std::size_t count = 0;
+    do
+    {
+        reversed[count++] = static_cast<char>('0' + magnitude % 10);
+        magnitude        /= 10;
+    } while (magnitude != 0);
+
+    while (count > 0)
+    {
+        out[length++] = static_cast<uint8_t>(reversed[--count]);
+    }
+    return length;
+}
+
+// Copy a compile-time prefix in a runtime buffer, returns its length
+template<std::size_t N>
+inline std::size_t copy(uint8_t* out, const Frame<N>& frame)
+{
+    for (std::size_t i = 0; i < frame.size; i++)
+    {
+        out[i] = frame.bytes[i];
+    }
+    return frame.size;
+}
+}   // namespace detail
+
+
+/*************************************************************************************************/
+/* Bus ----------------------------------------------------------------------------------------- */
+class Bus
+{
+public:
+    explicit Bus(UART_HandleTypeDef* huart, uint32_t timeout = defaultTimeout)
+    : m_huart{huart}, m_timeout{timeout}
+    {
+    }
+
+    UART_HandleTypeDef* huart()   const { return m_huart; }
+    uint32_t            timeout() const { return m_timeout; }
+
+private:
+    UART_HandleTypeDef* m_huart;
+    uint32_t            m_timeout;
+};
+
+
+/*************************************************************************************************/
+/* Servo --------------------------------------------------------------------------------------- */
+template<uint8_t Id>
+class Servo
+{
+    static_assert(Id <= broadcastId, "LSS IDs go from 0 to 254 (broadcast)");
+
+public:
+    explicit Servo(const Bus& bus)
+    {
+        LSS_init_handle(&m_lss, Id, bus.huart(), bus.timeout());
+    }
+
+    // Underlying C structure, to mix with the C API (groups, profiles...)
+    LSS*       c_handle()       { return &m_lss; }
+    const LSS* c_handle() const { return &m_lss; }
+
+
+    /* ------- */
+    /* Actions */
+    bool reset() { return ::reset(&m_lss); }     // through the C API, which forgets the session's settings
+    bool hold()  { return send(s_hold); }
+
+    bool limp()
+    {
+        LSS_clear_target(&m_lss);
+        return send(s_limp);
+    }
+
+    bool move(Angle position)
+    {
+        return move_frame(s_move, position, nullptr, 0);
+    }
+
+    bool move(Angle position, int16_t timeMs)
+    {
+        return move_frame(s_move, position, "T", timeMs);
+    }
+
+    bool wheel(AngularSpeed speed)
+    {
+        uint8_t     frame[detail::maxFrameLength];
+        std::size_t length = detail::copy(frame, s_wheel);
+        length             = detail::encode(frame, length, speed.tenthsPerSecond);
+        frame[length++]    = '\r';
+
+        LSS_clear_target(&m_lss);
+        return LSS_send_frame(&m_lss, frame, static_cast<uint16_t>(length));
+    }
+
+
+    /* ------- */
+    /* Queries */
+    Result<LSS_Status> status()
+    {
+        LSS_Result raw = query("Q", s_queryStatus);
+        return {static_cast<LSS_Status>(raw.value), raw.status, raw.timestamp, raw.stamp};
+    }
+
+    Result<Angle>        position()    { return typed<Angle>       ("QD",  s_queryPosition); }
+    Result<AngularSpeed> speed()       { return typed<AngularSpeed>("QWD", s_querySpeed); }
+    Result<Millivolts>   voltage()     { return typed<Millivolts>  ("QV",  s_queryVoltage); }
+    Result<Milliamps>    current()     { return typed<Milliamps>   ("QC",  s_queryCurrent); }
+    Result<Temperature>  temperature() { return typed<Temperature> ("QT",  s_queryTemperature); }
+
+private:
+    // Fixed frames, built at compile time
+    static constexpr auto s_limp             = detail::fixed<Id>("L");
+    static constexpr auto s_hold             = detail::fixed<Id>("H");
+    static constexpr auto s_queryStatus      = detail::fixed<Id>("Q");
+    static constexpr auto s_queryPosition    = detail::fixed<Id>("QD");
+    static constexpr auto s_querySpeed       = detail::fixed<Id>("QWD");
+    static constexpr auto s_queryVoltage     = detail::fixed<Id>("QV");
+    static constexpr auto s_queryCurrent     = detail::fixed<Id>("QC");
+    static constexpr auto s_queryTemperature = detail::fixed<Id>("QT");
+
+    // Prefixes of value-carrying frames, the value is appended at runtime
+    static constexpr auto s_move  = detail::prefix<Id>("D");
+    static constexpr auto s_wheel = detail::prefix<Id>("WD");
+
+    LSS m_lss{};
+
+    template<std::size_t N>
+    bool send(const detail::Frame<N>& frame)
+    {
+        return LSS_send_frame(&m_lss, frame.bytes.data(), static_cast<uint16_t>(frame.size));
+    }
+
+    template<std::size_t N>
+    LSS_Result query(const char* cmd, const detail::Frame<N>& frame)
+    {
+        return LSS_query_frame(&m_lss, cmd, frame.bytes.data(), static_cast<uint16_t>(frame.size));
+    }
+
+    template<typename T, std::size_t N>
+    Result<T> typed(const char* cmd, const detail::Frame<N>& frame)
+    {
+        LSS_Result raw = query(cmd, frame);
+        return {T{raw.value}, raw.status, raw.timestamp, raw.stamp};
+    }
+
+    template<std::size_t N>
+    bool move_frame(const detail::Frame<N>& head, Angle position, const char* parameter, int16_t parameterValue)
+    {
+        uint8_t     frame[detail::maxFrameLength];
+        std::size_t length = detail::copy(frame, head);
+        length             = detail::encode(frame, length, position.tenths);
+        if (parameter != nullptr)
+        {
+            frame[length++] = static_cast<uint8_t>(parameter[0]);
+            length          = detail::encode(frame, length, parameterValue);
+        }
+        frame[length++] = '\r';
+
+        if (!LSS_send_frame(&m_lss, frame, static_cast<uint16_t>(length)))
+        {
+            return false;
+        }
+
+        // Keep the C bookkeeping in sync, so LSS_wait_reached works on these servos too
+        LSS_track_target(&m_lss, position.tenths,
+                         (parameter != nullptr && parameterValue > 0) ? static_cast<uint16_t>(parameterValue) : 0);
+        return true;
+    }
+};
+
+}   // namespace lss
+
+#endif
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,925 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Header-only C++20 coroutine layer over the bus.
+ *                  Queries and commands are awaitables, several queries can be awaited together with
+ *                  when_all. Every bus pipelines its requests (up to LSS_PIPELINE_DEPTH on the wire) and
+ *                  matches replies to them, a single-threaded executor drives all buses and resumes the
+ *                  coroutines. Frames come from a fixed pool of requests and coroutine frames from a fixed
+ *                  pool of blocks, nothing is allocated on the heap.
+ *                  On the Linux port, the executor sleeps in epoll until bytes arrive or a reply times out.
+ *
+ *                  A UART driven by an async Bus must not be used by the blocking API at the same time.
+ *                  The UART must be initialized before creating the Bus (LSS_init or HAL_UART_Init).
+ *
+ *  Usage:
+ *      lss::async::Executor executor;
+ *      lss::async::Bus      bus{executor, &huart1};
+ *
+ *      lss::async::Task<> poll_arm(lss::async::Bus& bus)
+ *      {
+ *          auto [shoulder, elbow] = co_await lss::async::when_all(bus.position(1), bus.position(2));
+ *          co_await bus.move(3, lss::Angle{shoulder.value.tenths + elbow.value.tenths});
+ *      }
+ *
+ *      executor.spawn(poll_arm(bus));
+ *      executor.run();
+ */
+#ifndef LSS_ASYNC_HPP
+#define LSS_ASYNC_HPP
+
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "LSS.hpp"
+
+#ifdef LSS_PLATFORM_LINUX
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#ifndef LSS_ASYNC_REQUESTS
+#define LSS_ASYNC_REQUESTS  (64)    // requests queued or in flight, over all buses
+#endif
+
+#ifndef LSS_ASYNC_TASKS
+#define LSS_ASYNC_TASKS     (16)    // coroutine frames alive at once
+#endif
+
+#ifndef LSS_ASYNC_TASK_SIZE
+#define LSS_ASYNC_TASK_SIZE (512)   // bytes per coroutine frame, keep large query arrays outside coroutines
+#endif
+
+#ifndef LSS_ASYNC_RX_SIZE
+#define LSS_ASYNC_RX_SIZE   (64)    // reception buffer per bus
+#endif
+
+
+namespace lss::async
+{
+class Executor;
+class Bus;
+
+
+/*************************************************************************************************/
+/* Internals ----------------------------------------------------------------------------------- */
+namespace detail
+{
+constexpr std::size_t maxReplyLength = 24;
+
+// Coroutine waiting for one or several requests
+struct Join
+{
+    std::coroutine_handle<> handle;
+    uint16_t                remaining;
+};
+
+enum class State : uint8_t
+{
+    Free,
+    Queued,     // waiting for its turn on the wire
+    Sending,    // command handed to the UART, done once the transmission ends
+    Waiting,    // query sent, waiting for its reply
+};
+
+// A frame and its reply, from the executor's pool
+struct Request
+{
+    uint8_t     frame[lss::detail::maxFrameLength];
+    uint8_t     length;
+    uint8_t     servoId;
+    const char* reply;      // reply identifier, nullptr for commands
+    State       state;
+    uint32_t    deadline;
+    LSS_Result* out;
+    Join*       join;
+    Request*    next;
+};
+
+// "#<id><cmd>", returns the length
+inline std::size_t header(uint8_t* out, uint8_t id, const char* cmd)
+{
+    std::size_t length = 0;
+    out[length++]      = '#';
+    length             = lss::detail::encode(out, length, id);
+    while (*cmd != '\0')
+    {
+        out[length++] = static_cast<uint8_t>(*cmd++);
+    }
+    return length;
+}
+
+template<typename T>
+constexpr T convert(int32_t value)
+{
+    if constexpr (std::is_enum_v<T>)
+    {
+        return static_cast<T>(value);
+    }
+    else
+    {
+        return T{value};
+    }
+}
+
+
+/* ---------------- */
+/* Coroutine frames */
+struct TaskBlock
+{
+    alignas(std::max_align_t) unsigned char bytes[LSS_ASYNC_TASK_SIZE];
+    bool used;
+};
+
+inline std::array<TaskBlock, LSS_ASYNC_TASKS>& task_blocks()
+{
+    static std::array<TaskBlock, LSS_ASYNC_TASKS> blocks{};
+    return blocks;
+}
+
+inline void* allocate_task(std::size_t size) noexcept
+{
+    if (size > LSS_ASYNC_TASK_SIZE)
+    {
+        return nullptr;
+    }
+    for (TaskBlock& block : task_blocks())
+    {
+        if (!block.used)
+        {
+            block.used = true;
+            return block.bytes;
+        }
+    }
+    return nullptr;
+}
+
+inline void release_task(void* pointer) noexcept
+{
+    reinterpret_cast<TaskBlock*>(pointer)->used = false;
+}
+
+
+/* -------- */
+/* Promises */
+struct PromiseBase
+{
+    std::coroutine_handle<> continuation;
+    Executor*               owner = nullptr;    // set on tasks spawned on the executor
+
+    static void* operator new(std::size_t size) noexcept { return allocate_task(size); }
+    static void  operator delete(void* pointer) noexcept { release_task(pointer); }
+
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+        void await_resume() const noexcept {}
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept;
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter        final_suspend() noexcept { return {}; }
+    void                unhandled_exception() noexcept { std::terminate(); }
+};
+
+template<typename T>
+struct ReturnValue
+{
+    T    value{};
+    void return_value(T result) { value = std::move(result); }
+};
+
+template<>
+struct ReturnValue<void>
+{
+    void return_void() {}
+};
+}   // namespace detail
+
+
+/*************************************************************************************************/
+/* Task ---------------------------------------------------------------------------------------- */
+// Lazy coroutine, started when awaited or spawned on the executor
+template<typename T = void>
+class [[nodiscard]] Task
+{
+public:
+    struct promise_type : detail::PromiseBase, detail::ReturnValue<T>
+    {
+        Task get_return_object() noexcept
+        {
+            return Task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        // The block pool is full or the coroutine frame is larger than LSS_ASYNC_TASK_SIZE
+        static Task get_return_object_on_allocation_failure() noexcept { return Task{nullptr}; }
+    };
+
+    Task(Task&& other) noexcept : m_handle{std::exchange(other.m_handle, nullptr)} {}
+    Task(const Task&)            = delete;
+    Task& operator=(const Task&) = delete;
+    Task& operator=(Task&&)      = delete;
+
+    ~Task()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+    }
+
+    bool valid() const { return static_cast<bool>(m_handle); }
+
+    bool await_ready() const noexcept { return !m_handle; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept
+    {
+        m_handle.promise().continuation = caller;
+        return m_handle;
+    }
+
+    T await_resume()
+    {
+        if constexpr (!std::is_void_v<T>)
+        {
+            return m_handle ? std::move(m_handle.promise().value) : T{};
+        }
+    }
+
+private:
+    friend class Executor;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : m_handle{handle} {}
+
+    std::coroutine_handle<promise_type> release() { return std::exchange(m_handle, nullptr); }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+
+/*************************************************************************************************/
+/* Executor ------------------------------------------------------------------------------------ */
+class Executor
+{
+public:
+    Executor()
+    {
+        for (std::size_t i = 0; i + 1 < m_requests.size(); i++)
+        {
+            m_requests[i].next = &m_requests[i + 1];
+        }
+        m_free = &m_requests[0];
+#ifdef LSS_PLATFORM_LINUX
+        m_epoll = epoll_create1(EPOLL_CLOEXEC);
+#endif
+    }
+
+    ~Executor()
+    {
+#ifdef LSS_PLATFORM_LINUX
+        close(m_epoll);
+#endif
+    }
+
+    Executor(const Executor&)            = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    // Start a task, it runs until completion on this executor. false if its frame couldn't be allocated
+    bool spawn(Task<void>&& task)
+    {
+        if (!task.valid())
+        {
+            return false;
+        }
+        auto handle            = task.release();
+        handle.promise().owner = this;
+        m_tasks++;
+        schedule(handle);
+        return true;
+    }
+
+    // Run until every spawned task finished
+    void run()
+    {
+        while (m_tasks > 0)
+        {
+            run_once(idleWait);
+        }
+    }
+
+    /* One turn of the loop: resume ready coroutines, send queued frames, match replies and timeouts.
+     * When nothing is ready, sleeps (epoll on Linux) up to maxWait ms or until the next reply deadline.
+     * On target, call it from the main loop or an RTOS task. */
+    void run_once(uint32_t maxWait);
+
+    uint32_t tasks() const { return m_tasks; }
+
+private:
+    static constexpr uint32_t idleWait = 10;     // in ms
+
+    friend class Bus;
+    friend struct detail::PromiseBase::FinalAwaiter;
+
+    void attach(Bus* bus);
+
+    detail::Request* acquire()
+    {
+        detail::Request* request = m_free;
+        if (request != nullptr)
+        {
+            m_free = request->next;
+        }
+        return request;
+    }
+
+    void release(detail::Request* request)
+    {
+        request->state = detail::State::Free;
+        request->next  = m_free;
+        m_free         = request;
+    }
+
+    void schedule(std::coroutine_handle<> handle)
+    {
+        m_ready[(m_readyHead + m_readyCount) % m_ready.size()] = handle;
+        m_readyCount++;
+    }
+
+    void finished() { m_tasks--; }
+
+    std::array<detail::Request, LSS_ASYNC_REQUESTS>       m_requests{};
+    detail::Request*                                      m_free = nullptr;
+    std::array<std::coroutine_handle<>, LSS_ASYNC_TASKS>  m_ready{};
+    std::size_t                                           m_readyHead  = 0;
+    std::size_t                                           m_readyCount = 0;
+    std::array<Bus*, LSS_MAX_BUSES>                       m_buses{};
+    uint8_t                                               m_busCount = 0;
+    uint32_t                                              m_tasks    = 0;
+#ifdef LSS_PLATFORM_LINUX
+    int m_epoll = -1;
+#endif
+};
+
+
+/*************************************************************************************************/
+/* Awaitables ---------------------------------------------------------------------------------- */
+template<typename T>
+class Query
+{
+public:
+    Query(Bus& bus, uint8_t id, const char* cmd) : m_bus{&bus}, m_id{id}, m_cmd{cmd} {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        m_join = {handle, 1};
+        start(&m_join);
+        return m_join.remaining > 0;
+    }
+
+    Result<T> await_resume() const { return result(); }
+
+    Result<T> result() const
+    {
+        return {detail::convert<T>(m_raw.value), m_raw.status, m_raw.timestamp, m_raw.stamp};
+    }
+
+    // Queue the request, join is signaled on completion (right away if the request pool is empty)
+    void start(detail::Join* join);
+
+private:
+    Bus*         m_bus;
+    uint8_t      m_id;
+    const char*  m_cmd;
+    LSS_Result   m_raw{};
+    detail::Join m_join{};
+};
+
+// Completes once the frame is on the wire, true on success
+class Command
+{
+public:
+    Command(Bus& bus, uint8_t id, const char* cmd) : m_bus{&bus}, m_id{id}, m_cmd{cmd} {}
+
+    Command(Bus& bus, uint8_t id, const char* cmd, int32_t value) : Command{bus, id, cmd}
+    {
+        m_hasValue = true;
+        m_value    = value;
+    }
+
+    Command(Bus& bus, uint8_t id, const char* cmd, int32_t value, char parameter, int32_t parameterValue)
+    : Command{bus, id, cmd, value}
+    {
+        m_parameter      = parameter;
+        m_parameterValue = parameterValue;
+    }
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle);
+    bool await_resume() const { return m_raw.status == LSS_CommStatus_WriteSuccess; }
+
+private:
+    Bus*         m_bus;
+    uint8_t      m_id;
+    const char*  m_cmd;
+    bool         m_hasValue       = false;
+    int32_t      m_value          = 0;
+    char         m_parameter      = '\0';
+    int32_t      m_parameterValue = 0;
+    LSS_Result   m_raw{};
+    detail::Join m_join{};
+};
+
+template<typename... Ts>
+class WhenAll
+{
+public:
+    explicit WhenAll(Query<Ts>... queries) : m_queries{std::move(queries)...} {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        m_join = {handle, static_cast<uint16_t>(sizeof...(Ts))};
+        std::apply([this](auto&... query) { (query.start(&m_join), ...); }, m_queries);
+        return m_join.remaining > 0;
+    }
+
+    std::tuple<Result<Ts>...> await_resume() const
+    {
+        return std::apply([](const auto&... query) { return std::tuple{query.result()...}; }, m_queries);
+    }
+
+private:
+    std::tuple<Query<Ts>...> m_queries;
+    detail::Join             m_join{};
+};
+
+// Same over an array of queries, read the results with queries[i].result()
+template<typename T>
+class WhenAllRange
+{
+public:
+    WhenAllRange(Query<T>* queries, uint16_t count) : m_queries{queries}, m_count{count} {}
+
+    bool await_ready() const noexcept { return m_count == 0; }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        m_join = {handle, m_count};
+        for (uint16_t i = 0; i < m_count; i++)
+        {
+            m_queries[i].start(&m_join);
+        }
+        return m_join.remaining > 0;
+    }
+
+    void await_resume() const {}
+
+private:
+    Query<T>*    m_queries;
+    uint16_t     m_count;
+    detail::Join m_join{};
+};
+
+template<typename... Ts>
+WhenAll<Ts...> when_all(Query<Ts>... queries)
+{
+    return WhenAll<Ts...>{std::move(queries)...};
+}
+
+template<typename T>
+WhenAllRange<T> when_all(Query<T>* queries, uint16_t count)
+{
+    return WhenAllRange<T>{queries, count};
+}
+
+
+/*************************************************************************************************/
+/* Bus ----------------------------------------------------------------------------------------- */
+class Bus
+{
+public:
+    Bus(Executor& executor, UART_HandleTypeDef* huart, uint32_t timeout = defaultTimeout)
+    : m_executor{&executor}, m_huart{huart}, m_timeout{timeout}
+    {
+        executor.attach(this);
+    }
+
+    Bus(const Bus&)            = delete;
+    Bus& operator=(const Bus&) = delete;
+
+    UART_HandleTypeDef* huart() const { return m_huart; }
+
+
+    /* ------- */
+    /* Queries */
+    Query<LSS_Status>   status     (uint8_t id) { return {*this, id, "Q"}; }
+    Query<Angle>        position   (uint8_t id) { return {*this, id, "QD"}; }
+    Query<AngularSpeed> speed      (uint8_t id) { return {*this, id, "QWD"}; }
+    Query<Millivolts>   voltage    (uint8_t id) { return {*this, id, "QV"}; }
+    Query<Milliamps>    current    (uint8_t id) { return {*this, id, "QC"}; }
+    Query<Temperature>  temperature(uint8_t id) { return {*this, id, "QT"}; }
+
+
+    /* ------- */
+    /* Actions */
+    Command limp (uint8_t id)                                { return {*this, id, "L"}; }
+    Command hold (uint8_t id)                                { return {*this, id, "H"}; }
+    Command move (uint8_t id, Angle position)                { return {*this, id, "D", position.tenths}; }
+    Command move (uint8_t id, Angle position, int16_t time)  { return {*this, id, "D", position.tenths, 'T', time}; }
+    Command wheel(uint8_t id, AngularSpeed speed)            { return {*this, id, "WD", speed.tenthsPerSecond}; }
+
+private:
+    friend class Executor;
+    template<typename T> friend class Query;
+    friend class Command;
+
+    detail::Request* acquire() { return m_executor->acquire(); }
+
+    void enqueue(detail::Request* request)
+    {
+        request->state = detail::State::Queued;
+        request->next  = nullptr;
+        if (m_tail != nullptr)
+        {
+            m_tail->next = request;
+        }
+        else
+        {
+            m_head = request;
+        }
+        m_tail = request;
+    }
+
+    void finish(detail::Request* request, LSS_LastCommStatus status, int32_t value, uint32_t timestamp,
+                uint32_t stamp = 0)
+    {
+        // Unlink
+        detail::Request* previous = nullptr;
+        for (detail::Request* it = m_head; it != request; it = it->next)
+        {
+            previous = it;
+        }
+        (previous != nullptr ? previous->next : m_head) = request->next;
+        if (m_tail == request)
+        {
+            m_tail = previous;
+        }
+        if (request->state == detail::State::Waiting)
+        {
+            m_inFlight--;
+        }
+
+        *request->out = {value, status, timestamp, stamp};
+        if (--request->join->remaining == 0)
+        {
+            m_executor->schedule(request->join->handle);
+        }
+        m_executor->release(request);
+    }
+
+    // Move received bytes to the reply matcher, re-arming reception when the buffer is full
+    void receive()
+    {
+        while (true)
+        {
+            if (!m_armed)
+            {
+                m_armed = (HAL_UART_Receive_IT(m_huart, m_rx, sizeof(m_rx)) == HAL_OK);
+                m_scan  = 0;
+                if (!m_armed)
+                {
+                    return;
+                }
+            }
+#ifdef LSS_PLATFORM_LINUX
+            LSS_linux_poll_rx(m_huart, 0);
+#endif
+            uint16_t received = m_huart->RxXferSize - m_huart->RxXferCount;
+            while (m_scan < received)
+            {
+                feed(m_rx[m_scan++]);
+            }
+            if (received < sizeof(m_rx))
+            {
+                return;
+            }
+            m_armed = false;
+        }
+    }
+
+    void feed(uint8_t c)
+    {
+        if (c == '*')
+        {
+            m_lineLength = 0;
+            m_lineTick   = HAL_GetTick();
+            m_lineStamp  = LSS_timestamp();
+            m_inLine     = true;
+        }
+        else if (!m_inLine)
+        {
+            return;
+        }
+        else if (c == '\r')
+        {
+            m_inLine = false;
+            match();
+        }
+        else if (m_lineLength < detail::maxReplyLength)
+        {
+            m_line[m_lineLength++] = static_cast<char>(c);
+        }
+        else
+        {
+            m_inLine = false;
+        }
+    }
+
+    // "<id><cmd><value>" against the oldest request waiting for this ID and command
+    void match()
+    {
+        uint8_t i  = 0;
+        int32_t id = 0;
+        while (i < m_lineLength && m_line[i] >= '0' && m_line[i] <= '9')
+        {
+            id = id * 10 + (m_line[i++] - '0');
+        }
+        uint8_t cmdStart = i;
+        while (i < m_lineLength && m_line[i] >= 'A' && m_line[i] <= 'Z')
+        {
+            i++;
+        }
+        uint8_t cmdLength = i - cmdStart;
+
+        bool negative = (i < m_lineLength && m_line[i] == '-');
+        i += negative;
+        int32_t value = 0;
+        while (i < m_lineLength && m_line[i] >= '0' && m_line[i] <= '9')
+        {
+            value = value * 10 + (m_line[i++] - '0');
+        }
+
+        for (detail::Request* request = m_head; request != nullptr; request = request->next)
+        {
+            if (request->state != detail::State::Waiting || request->servoId != id)
+            {
+                continue;
+            }
+            const char* reply = request->reply;
+            uint8_t     j     = 0;
+            while (j < cmdLength && reply[j] == m_line[cmdStart + j])
+            {
+                j++;
+            }
+            if (j == cmdLength && reply[j] == '\0')
+            {
+                finish(request, LSS_CommStatus_ReadSuccess, negative ? -value : value, m_lineTick,
+                       m_lineStamp);
+                return;
+            }
+        }
+    }
+
+    // Timeouts, completed commands and queued frames
+    void service(uint32_t now)
+    {
+        bool txReady = (m_huart->gState == HAL_UART_STATE_READY);
+
+        detail::Request* request = m_head;
+        while (request != nullptr)
+        {
+            detail::Request* next = request->next;
+            if (request->state == detail::State::Waiting && static_cast<int32_t>(now - request->deadline) >= 0)
+            {
+                finish(request, LSS_CommStatus_ReadTimeout, 0, 0);
+            }
+            else if (request->state == detail::State::Sending && txReady)
+            {
+                finish(request, LSS_CommStatus_WriteSuccess, 0, now);
+            }
+            request = next;
+        }
+
+        // Fill the pipeline, a synchronous port (Linux) sends everything queued in one pass
+        request = m_head;
+        while (request != nullptr && m_inFlight < LSS_PIPELINE_DEPTH && m_huart->gState == HAL_UART_STATE_READY)
+        {
+            detail::Request* next = request->next;
+            if (request->state != detail::State::Queued)
+            {
+                // Already on the wire
+            }
+            else if (HAL_UART_Transmit_IT(m_huart, request->frame, request->length) != HAL_OK)
+            {
+                finish(request, request->reply ? LSS_CommStatus_ReadNoBus : LSS_CommStatus_WriteNoBus, 0, 0);
+            }
+            else if (request->reply != nullptr)
+            {
+                request->state    = detail::State::Waiting;
+                request->deadline = now + m_timeout;
+                m_inFlight++;
+            }
+            else if (m_huart->gState == HAL_UART_STATE_READY)
+            {
+                finish(request, LSS_CommStatus_WriteSuccess, 0, now);
+            }
+            else
+            {
+                request->state = detail::State::Sending;
+            }
+            request = next;
+        }
+    }
+
+    // Earliest reply deadline, to bound the executor's sleep
+    bool next_deadline(uint32_t* deadline) const
+    {
+        bool found = false;
+        for (detail::Request* request = m_head; request != nullptr; request = request->next)
+        {
+            if (request->state == detail::State::Waiting &&
+                (!found || static_cast<int32_t>(request->deadline - *deadline) < 0))
+            {
+                *deadline = request->deadline;
+                found     = true;
+            }
+        }
+        return found;
+    }
+
+    bool busy() const { return m_head != nullptr; }
+
+    Executor*           m_executor;
+    UART_HandleTypeDef* m_huart;
+    uint32_t            m_timeout;
+
+    detail::Request*    m_head     = nullptr;   // requests in submission order
+    detail::Request*    m_tail     = nullptr;
+    uint8_t             m_inFlight = 0;
+
+    uint8_t             m_rx[LSS_ASYNC_RX_SIZE]{};
+    uint16_t            m_scan  = 0;
+    bool                m_armed = false;
+
+    char                m_line[detail::maxReplyLength]{};
+    uint8_t             m_lineLength = 0;
+    uint32_t            m_lineTick   = 0;
+    uint32_t            m_lineStamp  = 0;   // bytes are fed in batches, so this is when the batch was read
+    bool                m_inLine     = false;
+};
+
+
+/*************************************************************************************************/
+/* Out of line definitions --------------------------------------------------------------------- */
+template<typename Promise>
+std::coroutine_handle<> detail::PromiseBase::FinalAwaiter::await_suspend(std::coroutine_handle<Promise> handle) noexcept
+{
+    PromiseBase& promise = handle.promise();
+    if (promise.continuation)
+    {
+        return promise.continuation;
+    }
+
+    // Spawned task, nobody awaits it
+    if (promise.owner != nullptr)
+    {
+        promise.owner->finished();
+        handle.destroy();
+    }
+    return std::noop_coroutine();
+}
+
+template<typename T>
+void Query<T>::start(detail::Join* join)
+{
+    m_raw                    = {0, LSS_CommStatus_ReadTimeout, 0, 0};
+    detail::Request* request = m_bus->acquire();
+    if (request == nullptr)
+    {
+        m_raw.status = LSS_CommStatus_ReadUnknown;
+        join->remaining--;
+        return;
+    }
+
+    std::size_t length         = detail::header(request->frame, m_id, m_cmd);
+    request->frame[length++]   = '\r';
+    request->length            = static_cast<uint8_t>(length);
+    request->servoId           = m_id;
+    request->reply             = m_cmd;
+    request->out               = &m_raw;
+    request->join              = join;
+    m_bus->enqueue(request);
+}
+
+inline bool Command::await_suspend(std::coroutine_handle<> handle)
+{
+    m_raw                    = {0, LSS_CommStatus_WriteUnknown, 0, 0};
+    detail::Request* request = m_bus->acquire();
+    if (request == nullptr)
+    {
+        return false;
+    }
+
+    std::size_t length = detail::header(request->frame, m_id, m_cmd);
+    if (m_hasValue)
+    {
+        length = lss::detail::encode(request->frame, length, m_value);
+    }
+    if (m_parameter != '\0')
+    {
+        request->frame[length++] = static_cast<uint8_t>(m_parameter);
+        length                   = lss::detail::encode(request->frame, length, m_parameterValue);
+    }
+    request->frame[length++] = '\r';
+
+    m_join           = {handle, 1};
+    request->length  = static_cast<uint8_t>(length);
+    request->servoId = m_id;
+    request->reply   = nullptr;
+    request->out     = &m_raw;
+    request->join    = &m_join;
+    m_bus->enqueue(request);
+    return true;
+}
+
+inline void Executor::attach(Bus* bus)
+{
+    if (m_busCount >= m_buses.size())
+    {
+        return;
+    }
+    m_buses[m_busCount++] = bus;
+
+#ifdef LSS_PLATFORM_LINUX
+    epoll_event event{};
+    event.events   = EPOLLIN;
+    event.data.ptr = bus;
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, bus->huart()->fd, &event);
+#endif
+}
+
+inline void Executor::run_once(uint32_t maxWait)
+{
+    // Resume everything that is ready, they may queue new requests
+    while (m_readyCount > 0)
+    {
+        std::coroutine_handle<> handle = m_ready[m_readyHead];
+        m_readyHead                    = (m_readyHead + 1) % m_ready.size();
+        m_readyCount--;
+        handle.resume();
+    }
+
+    uint32_t now = HAL_GetTick();
+    for (uint8_t b = 0; b < m_busCount; b++)
+    {
+        m_buses[b]->service(now);
+    }
+
+#ifdef LSS_PLATFORM_LINUX
+    // Sleep until bytes arrive or the first reply deadline
+    uint32_t wait = maxWait;
+    for (uint8_t b = 0; b < m_busCount; b++)
+    {
+        uint32_t deadline = 0;
+        if (m_buses[b]->next_deadline(&deadline))
+        {
+            int32_t left = static_cast<int32_t>(deadline - now);
+            wait         = (left <= 0) ? 0 : (static_cast<uint32_t>(left) < wait ? left : wait);
+        }
+    }
+    std::array<epoll_event, LSS_MAX_BUSES> events{};
+    epoll_wait(m_epoll, events.data(), static_cast<int>(events.size()), static_cast<int>(wait));
+#else
+    (void)maxWait;
+#endif
+
+    now = HAL_GetTick();
+    for (uint8_t b = 0; b < m_busCount; b++)
+    {
+        m_buses[b]->receive();
+        m_buses[b]->service(now);
+    }
+}
+
+}   // namespace lss::async
+
+#endif
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,340 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Group moves kept within a supply current budget.
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS_Budget.h"
+
+#include <string.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define LSS_BUDGET_MAX_DURATION     (32767)     // ms, largest T parameter
+
+//> Per-model defaults, conservative: measured currents only ever raise them
+typedef struct {
+    uint16_t speed;     // (1/10°)/s, when the servo's max speed can't be read
+    uint16_t moving;    // mA
+    uint16_t inrush;    // mA
+} LSS_BudgetModel;
+
+static const LSS_BudgetModel budgetModels[] = {
+    [LSS_ModelHighTorque] = {1200, 700, 1800},
+    [LSS_ModelStandard]   = {3600, 500, 1500},
+    [LSS_ModelHighSpeed]  = {9000, 500, 1500},
+    [LSS_ModelUnknown]    = {1200, 700, 1800},
+};
+
+
+/*************************************************************************************************/
+/* Private functions declarations -------------------------------------------------------------- */
+static bool     plan_waves (LSS_Budget* budget, const uint8_t order[], uint8_t count, uint32_t available,
+                            uint32_t duration, uint32_t* peak);
+static void     send_wave  (LSS_Budget* budget, uint8_t wave);
+static uint32_t share      (const LSS_BudgetServo* servo, uint32_t duration);
+static uint8_t  servo_list (const LSS_Budget* budget, LSS* servos[]);
+
+
+/*************************************************************************************************/
+/* Public functions definitions ---------------------------------------------------------------- */
+
+/* Schedule the moves of servos within milliamps. Each servo's model and max speed are read to pick
+ * its starting estimates.
+ * Returns false if a servo didn't answer, its estimates are then the worst case. */
+bool LSS_budget_init(LSS_Budget* budget, LSS* servos[], uint8_t n, uint16_t milliamps)
+{
+    assert_param(n <= LSS_GROUP_MAX_SIZE);
+
+    memset(budget, 0, sizeof(*budget));
+    budget->count  = n;
+    budget->budget = milliamps;
+
+    bool success = true;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        LSS_BudgetServo* servo = &budget->servos[i];
+        servo->lss             = servos[i];
+        servo->wave            = LSS_BUDGET_IDLE;
+
+        LSS_Model model = get_model(servos[i]);
+        success        &= (servos[i]->lastCommStatus == LSS_CommStatus_ReadSuccess);
+        model           = (model > LSS_ModelUnknown) ? LSS_ModelUnknown : model;
+
+        uint16_t speed  = get_max_speed(servos[i], LSS_QuerySession);
+        success        &= (servos[i]->lastCommStatus == LSS_CommStatus_ReadSuccess);
+
+        servo->speed  = (speed > 0) ? speed : budgetModels[model].speed;
+        servo->moving = budgetModels[model].moving;
+        servo->inrush = budgetModels[model].inrush;
+    }
+
+    return success;
+}
+
+/* Start moving every servo to its position (1/10°) within the budget.
+ * Holding currents and positions are read first (one pipelined query each), then the shortest
+ * schedule keeping the estimated total under the budget is planned: the longest moves start in the
+ * first wave, each wave starts LSS_BUDGET_INRUSH_MS after the previous one, and each servo's T
+ * parameter makes it end with the others. The first wave is sent right away, call LSS_budget_update
+ * for the next ones.
+ * Returns the duration of the move in ms, 0 if the servos couldn't be read or the budget can't be
+ * held (ex: holding currents alone exceed it). */
+uint16_t LSS_budget_move(LSS_Budget* budget, const int16_t positions[])
+{
+    LSS*       servos  [LSS_GROUP_MAX_SIZE];
+    LSS_Result currents[LSS_GROUP_MAX_SIZE];
+    LSS_Result readings[LSS_GROUP_MAX_SIZE];
+    uint8_t    n = servo_list(budget, servos);
+
+    budget->duration = 0;
+    if (!LSS_query_results(servos, n, LSS_Query_Current, LSS_QuerySession, currents) ||
+        !LSS_query_results(servos, n, LSS_Query_Position, LSS_QuerySession, readings))
+    {
+        return 0;
+    }
+
+    // Moves at full speed, longest first
+    uint8_t  order[LSS_GROUP_MAX_SIZE];
+    uint8_t  count    = 0;
+    uint32_t holding  = 0;
+    uint32_t longest  = 1;
+    uint64_t workload = 0;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        LSS_BudgetServo* servo   = &budget->servos[i];
+        int32_t          travel  = positions[i] - readings[i].value;
+        travel                   = (travel < 0) ? -travel : travel;
+        servo->hold              = (uint16_t)currents[i].value;
+        servo->target            = positions[i];
+        servo->duration          = (uint16_t)((travel * 1000 + servo->speed - 1) / servo->speed);
+        servo->wave              = LSS_BUDGET_IDLE;
+        holding                 += servo->hold;
+
+        if (servo->duration == 0)
+        {
+            continue;
+        }
+        longest   = (servo->duration > longest) ? servo->duration : longest;
+        workload += (uint64_t)servo->moving * servo->duration;
+
+        uint8_t k = count++;
+        while (k > 0 && budget->servos[order[k - 1]].duration < servo->duration)
+        {
+            order[k] = order[k - 1];
+            k--;
+        }
+        order[k] = i;
+    }
+
+    if (holding >= budget->budget)
+    {
+        return 0;
+    }
+    uint32_t available = budget->budget - holding;
+
+    /* Moving current times duration is the same whatever the speed, so the budget can't be held
+     * for less than the sum of it over the budget. Search up from there, then down to the ms. */
+    uint32_t low = (uint32_t)(workload / available);
+    low          = (low > longest) ? low : longest;
+    uint32_t high = low;
+    uint32_t peak = 0;
+    while (!plan_waves(budget, order, count, available, high, &peak))
+    {
+        if (high >= LSS_BUDGET_MAX_DURATION)
+        {
+            return 0;
+        }
+        low  = high + 1;
+        high = (high * 2 > LSS_BUDGET_MAX_DURATION) ? LSS_BUDGET_MAX_DURATION : high * 2;
+    }
+    while (low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if (plan_waves(budget, order, count, available, middle, &peak))
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    plan_waves(budget, order, count, available, high, &peak);
+
+    budget->duration  = (uint16_t)high;
+    budget->waves     = (count > 0) ? (uint8_t)(budget->servos[order[count - 1]].wave + 1) : 0;
+    budget->nextWave  = 0;
+    budget->planned   = (uint16_t)(holding + peak);
+    budget->measured  = 0;
+    budget->startTick = HAL_GetTick();
+
+    send_wave(budget, budget->nextWave++);
+    return budget->duration;
+}
+
+/* Drive the move in progress, call it at least every LSS_BUDGET_INRUSH_MS: sends the waves that are
+ * due, then reads every servo's current (one pipelined query). A servo drawing more than estimated
+ * raises its estimates for the next moves, and the highest total is kept in measured.
+ * Returns true while the move is in progress. */
+bool LSS_budget_update(LSS_Budget* budget)
+{
+    if (budget->duration == 0)
+    {
+        return false;
+    }
+
+    uint32_t elapsed = HAL_GetTick() - budget->startTick;
+    while (budget->nextWave < budget->waves && elapsed >= (uint32_t)budget->nextWave * LSS_BUDGET_INRUSH_MS)
+    {
+        send_wave(budget, budget->nextWave++);
+    }
+
+    LSS*       servos  [LSS_GROUP_MAX_SIZE];
+    LSS_Result currents[LSS_GROUP_MAX_SIZE];
+    uint8_t    n = servo_list(budget, servos);
+    LSS_query_results(servos, n, LSS_Query_Current, LSS_QuerySession, currents);
+
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        LSS_BudgetServo* servo = &budget->servos[i];
+        if (currents[i].status != LSS_CommStatus_ReadSuccess)
+        {
+            total += servo->hold;
+            continue;
+        }
+        total += (uint32_t)currents[i].value;
+
+        if (servo->wave >= budget->nextWave || currents[i].value <= servo->hold)
+        {
+            continue;
+        }
+        uint32_t start = (uint32_t)servo->wave * LSS_BUDGET_INRUSH_MS;
+        uint32_t extra = (uint32_t)currents[i].value - servo->hold;
+        if (elapsed < start + LSS_BUDGET_INRUSH_MS)
+        {
+            servo->inrush = (extra > servo->inrush) ? (uint16_t)extra : servo->inrush;
+        }
+        else if (elapsed < budget->duration && extra > share(servo, budget->duration - start))
+        {
+            // Back to full speed: extra was drawn at duration / (time given) of it
+            uint32_t moving = extra * (budget->duration - start) / servo->duration;
+            servo->moving   = (moving > UINT16_MAX) ? UINT16_MAX : (uint16_t)moving;
+        }
+    }
+    budget->measured = (total > budget->measured) ? (uint16_t)total : budget->measured;
+
+    if (elapsed >= budget->duration)
+    {
+        budget->duration = 0;
+        return false;
+    }
+    return true;
+}
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+
+/* Put the servos (in order) in waves for a move lasting duration ms. A servo joins the current wave
+ * if the inrushes of that wave, on top of the servos of earlier waves now moving steadily, fit in
+ * what's available; else a new wave starts. peak receives the highest planned total (hold excluded).
+ * Returns false if the budget can't be held, or a servo can't make it in the time left. */
+static bool plan_waves(LSS_Budget* budget, const uint8_t order[], uint8_t count, uint32_t available,
+                       uint32_t duration, uint32_t* peak)
+{
+    uint32_t steady     = 0;    // earlier waves
+    uint32_t starting   = 0;    // inrushes of the current wave
+    uint32_t waveSteady = 0;    // current wave, once started
+    uint8_t  wave       = 0;
+    *peak               = 0;
+
+    for (uint8_t k = 0; k < count; k++)
+    {
+        LSS_BudgetServo* servo = &budget->servos[order[k]];
+        while (true)
+        {
+            uint32_t start = (uint32_t)wave * LSS_BUDGET_INRUSH_MS;
+            if (duration < start + servo->duration)
+            {
+                return false;
+            }
+            if (steady + starting + servo->inrush <= available)
+            {
+                starting   += servo->inrush;
+                waveSteady += share(servo, duration - start);
+                servo->wave = wave;
+                break;
+            }
+            if (starting == 0 || wave + 1 >= LSS_BUDGET_IDLE)
+            {
+                return false;
+            }
+
+            *peak       = (steady + starting > *peak) ? steady + starting : *peak;
+            steady     += waveSteady;
+            starting    = 0;
+            waveSteady  = 0;
+            wave++;
+        }
+    }
+
+    *peak   = (steady + starting > *peak) ? steady + starting : *peak;
+    steady += waveSteady;
+    *peak   = (steady > *peak) ? steady : *peak;
+    return steady <= available;
+}
+
+// Start a wave's servos, with the time left so they end with the rest of the move
+static void send_wave(LSS_Budget* budget, uint8_t wave)
+{
+    LSS*     servos   [LSS_GROUP_MAX_SIZE];
+    int16_t  positions[LSS_GROUP_MAX_SIZE];
+    uint8_t  count   = 0;
+    uint32_t longest = 0;
+
+    for (uint8_t i = 0; i < budget->count; i++)
+    {
+        LSS_BudgetServo* servo = &budget->servos[i];
+        if (servo->wave == wave)
+        {
+            servos[count]    = servo->lss;
+            positions[count] = servo->target;
+            longest          = (servo->duration > longest) ? servo->duration : longest;
+            count++;
+        }
+    }
+    if (count == 0)
+    {
+        return;
+    }
+
+    // A late wave keeps the planned end, but can't go faster than full speed
+    uint32_t elapsed = HAL_GetTick() - budget->startTick;
+    uint32_t left    = (budget->duration > elapsed) ? budget->duration - elapsed : 0;
+    left             = (left > longest) ? left : longest;
+    LSS_move_group(servos, count, positions, (int16_t)left);
+}
+
+// Current drawn on top of hold moving for time (ms) instead of its full-speed duration
+static uint32_t share(const LSS_BudgetServo* servo, uint32_t time)
+{
+    return (uint32_t)servo->moving * servo->duration / time;
+}
+
+static uint8_t servo_list(const LSS_Budget* budget, LSS* servos[])
+{
+    for (uint8_t i = 0; i < budget->count; i++)
+    {
+        servos[i] = budget->servos[i].lss;
+    }
+    return budget->count;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,90 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Group moves kept within a supply current budget.
+ *                  Every servo draws its holding current, plus a current that grows with its speed
+ *                  while it moves and a short inrush while it starts. Instead of fixed sleeps between
+ *                  moves, the scheduler plans each group move so the estimated total stays under the
+ *                  budget: starts are staggered in waves, so inrushes don't pile up, and every servo is
+ *                  given a T parameter that slows it down just enough. All the servos finish together,
+ *                  as early as the budget allows.
+ *
+ *  Current model (mA, per servo):
+ *      hold + inrush                   for LSS_BUDGET_INRUSH_MS after its move starts
+ *      hold + moving * speed / full    while it moves, speed being its average speed over the move
+ *      hold is measured (QC) before every move, moving and inrush start from per-model estimates and
+ *      are raised when the current measured during a move is higher.
+ *
+ *  Usage:
+ *      static LSS_Budget budget;
+ *      LSS_budget_init(&budget, servos, 18, 5000);        // 5 A supply
+ *      LSS_budget_move(&budget, positions);
+ *      while (LSS_budget_update(&budget)) { ... }          // starts the next waves, measures current
+ */
+#ifndef LSS_BUDGET_H
+#define LSS_BUDGET_H
+
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#ifndef LSS_BUDGET_INRUSH_MS
+#define LSS_BUDGET_INRUSH_MS    (60)    // time between waves, a started servo is past its inrush
+#endif
+
+#define LSS_BUDGET_IDLE         (0xFF)  // wave of a servo that doesn't move
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+//> Estimates and current move of one servo
+typedef struct {
+    LSS*     lss;
+    uint16_t speed;     // full speed, in (1/10°)/s
+    uint16_t moving;    // mA on top of hold, moving at full speed
+    uint16_t inrush;    // mA on top of hold, starting
+    uint16_t hold;      // mA, measured before the last move
+
+    int16_t  target;
+    uint16_t duration;  // ms, of the move at full speed
+    uint8_t  wave;
+} LSS_BudgetServo;
+
+typedef struct {
+    LSS_BudgetServo servos[LSS_GROUP_MAX_SIZE];
+    uint8_t         count;
+    uint16_t        budget;     // mA, for the whole group
+
+    // Move in progress
+    uint32_t startTick;
+    uint16_t duration;          // ms, every servo is done by then (0 when idle)
+    uint8_t  waves;
+    uint8_t  nextWave;
+
+    uint16_t planned;           // highest total planned for the last move, mA
+    uint16_t measured;          // highest total measured during the last move, mA
+} LSS_Budget;
+
+
+/*************************************************************************************************/
+/* Public functions declarations --------------------------------------------------------------- */
+bool     LSS_budget_init  (LSS_Budget* budget, LSS* servos[], uint8_t n, uint16_t milliamps);
+uint16_t LSS_budget_move  (LSS_Budget* budget, const int16_t positions[]);
+bool     LSS_budget_update(LSS_Budget* budget);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
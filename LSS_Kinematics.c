@@ -0,0 +1,512 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Kinematic chains of servos, solved in batches.
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS_Kinematics.h"
+#include "LSS_Units.h"
+
+#include <math.h>
+#include <string.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define KIN_L                       (LSS_KINEMATICS_LANES)
+#define KIN_MAX_ANGULAR_RANGE       (3600)
+
+//> Lane loops, kept as plain counted loops over whole rows so they vectorize
+#define FOR_LANES(l)                for (uint8_t l = 0; l < KIN_L; l++)
+
+_Static_assert(LSS_KINEMATICS_LANES <= 32, "converged lanes are returned as a 32-bit mask");
+_Static_assert(LSS_KINEMATICS_MAX_JOINTS * LSS_KINEMATICS_LANES <= UINT8_MAX, "servos are counted on 8 bits");
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+//> Joint frames of a solve: rotation axis and origin of each joint, and the end pose
+typedef struct {
+    LSS_Lanes axis  [LSS_KINEMATICS_MAX_JOINTS][3];
+    LSS_Lanes origin[LSS_KINEMATICS_MAX_JOINTS][3];
+    LSS_Lanes pose  [LSS_KINEMATICS_POSE_SIZE];
+} LSS_ChainFrames;
+
+
+/*************************************************************************************************/
+/* Private functions declarations -------------------------------------------------------------- */
+static void  chain_frames(const LSS_Chain* chain, const LSS_Lanes q[], LSS_ChainFrames* frames);
+static void  sin_cos     (const LSS_Lanes x, LSS_Lanes s, LSS_Lanes c);
+static void  solve_damped(uint8_t m, LSS_Lanes A[6][6], LSS_Lanes y[6]);
+static float sin_poly    (float r);
+static float cos_poly    (float r);
+
+
+/*************************************************************************************************/
+/* Public functions definitions ---------------------------------------------------------------- */
+
+/* Clear the chain: no servos, zero geometry, identity bases, joints mapped 1:1 over ±180°.
+ * IK defaults to position only, 20 iterations, 0.1 length unit. */
+void LSS_chain_init(LSS_Chain* chain, uint8_t joints, uint8_t lanes)
+{
+    assert_param(joints <= LSS_KINEMATICS_MAX_JOINTS);
+    assert_param(lanes <= LSS_KINEMATICS_LANES);
+
+    memset(chain, 0, sizeof(*chain));
+    chain->joints = joints;
+    chain->lanes  = lanes;
+
+    for (uint8_t j = 0; j < LSS_KINEMATICS_MAX_JOINTS; j++)
+    {
+        FOR_LANES(l)
+        {
+            chain->gyre[j][l]     = LSS_GyreClockwise;
+            chain->lower[j][l]    = -1800;
+            chain->upper[j][l]    = 1800;
+            chain->cosAlpha[j][l] = 1.0f;
+        }
+    }
+    FOR_LANES(l)
+    {
+        chain->base[0][l]  = 1.0f;
+        chain->base[5][l]  = 1.0f;
+        chain->base[10][l] = 1.0f;
+    }
+
+    chain->orientation    = false;
+    chain->iterations     = 20;
+    chain->damping        = 0.05f;
+    chain->tolerance      = 0.1f;
+    chain->angleTolerance = 1e-3f;
+}
+
+// Set a joint's servo (may be NULL) and DH geometry, alpha and theta in rad
+void LSS_chain_set_joint(LSS_Chain* chain, uint8_t lane, uint8_t joint, LSS* servo,
+                         float a, float alpha, float d, float theta)
+{
+    assert_param(lane < chain->lanes && joint < chain->joints);
+
+    chain->servos[joint][lane]   = servo;
+    chain->a[joint][lane]        = a;
+    chain->cosAlpha[joint][lane] = cosf(alpha);
+    chain->sinAlpha[joint][lane] = sinf(alpha);
+    chain->d[joint][lane]        = d;
+    chain->theta[joint][lane]    = theta;
+}
+
+/* Take a joint's offset, gyre and limits (origin ± half the angular range) from its servo's settings.
+ * The chain applies them from then on, so the servo's session settings are made neutral: no origin
+ * offset, clockwise gyre and an angular range wide enough for the limits.
+ * Returns false if a setting couldn't be read or written. */
+bool LSS_chain_read_joint(LSS_Chain* chain, uint8_t lane, uint8_t joint, LSS_QueryType queryType)
+{
+    assert_param(lane < chain->lanes && joint < chain->joints);
+
+    LSS* lss = chain->servos[joint][lane];
+    if (lss == NULL)
+    {
+        return false;
+    }
+
+    int16_t offset = get_origin_offset(lss, queryType);
+    if (lss->lastCommStatus != LSS_CommStatus_ReadSuccess)
+    {
+        return false;
+    }
+    uint16_t range = get_angular_range(lss, queryType);
+    if (lss->lastCommStatus != LSS_CommStatus_ReadSuccess)
+    {
+        return false;
+    }
+    LSS_ConfigGyre gyre = get_gyre(lss, queryType);
+    if (lss->lastCommStatus != LSS_CommStatus_ReadSuccess || gyre == LSS_GyreInvalid)
+    {
+        return false;
+    }
+
+    chain->offset[joint][lane] = offset;
+    chain->gyre[joint][lane]   = (int8_t)gyre;
+    chain->lower[joint][lane]  = (int16_t)(offset - range / 2);
+    chain->upper[joint][lane]  = (int16_t)(offset + range / 2);
+
+    uint32_t servoRange = range + 2u * (uint32_t)((offset < 0) ? -offset : offset);
+    servoRange          = (servoRange > KIN_MAX_ANGULAR_RANGE) ? KIN_MAX_ANGULAR_RANGE : servoRange;
+
+    return set_origin_offset(lss, 0, LSS_SetSession) &&
+           set_gyre(lss, LSS_GyreClockwise, LSS_SetSession) &&
+           set_angular_range(lss, (uint16_t)servoRange, LSS_SetSession);
+}
+
+// Pose of every lane's end effector for joint angles q (rad)
+void LSS_chain_forward(const LSS_Chain* chain, const LSS_Lanes q[], LSS_Lanes pose[])
+{
+    LSS_ChainFrames frames;
+    chain_frames(chain, q, &frames);
+    memcpy(pose, frames.pose, sizeof(frames.pose));
+}
+
+/* Solve joint angles reaching target poses, by damped least squares.
+ * q holds the starting angles (ex: the current ones) and receives the solution, kept within the joint
+ * limits. Only the position column of target is used unless chain->orientation is set.
+ * Returns a bitmask of the lanes that converged within tolerance. */
+uint32_t LSS_chain_inverse(const LSS_Chain* chain, const LSS_Lanes target[], LSS_Lanes q[])
+{
+    const uint8_t n = chain->joints;
+    const uint8_t m = chain->orientation ? 6 : 3;
+
+    // Joint limits in rad
+    LSS_Lanes qMin[LSS_KINEMATICS_MAX_JOINTS];
+    LSS_Lanes qMax[LSS_KINEMATICS_MAX_JOINTS];
+    for (uint8_t j = 0; j < n; j++)
+    {
+        FOR_LANES(l)
+        {
+            float bound1 = chain->gyre[j][l] * (chain->lower[j][l] - chain->offset[j][l]) * LSS_UNITS_RAD_PER_TENTH;
+            float bound2 = chain->gyre[j][l] * (chain->upper[j][l] - chain->offset[j][l]) * LSS_UNITS_RAD_PER_TENTH;
+            qMin[j][l]   = (bound1 < bound2) ? bound1 : bound2;
+            qMax[j][l]   = (bound1 < bound2) ? bound2 : bound1;
+        }
+    }
+
+    const float     lambda2   = chain->damping * chain->damping;
+    const float     tolerance = chain->tolerance * chain->tolerance;
+    const float     angleTol  = chain->angleTolerance * chain->angleTolerance;
+    uint32_t        converged = 0;
+    LSS_ChainFrames frames;
+
+    for (uint8_t iteration = 0; iteration <= chain->iterations; iteration++)
+    {
+        chain_frames(chain, q, &frames);
+
+        // Error: position, then orientation as half the sum of the axes' cross products
+        LSS_Lanes error[6];
+        LSS_Lanes positionError;
+        LSS_Lanes angleError;
+        FOR_LANES(l)
+        {
+            error[0][l]      = target[3][l]  - frames.pose[3][l];
+            error[1][l]      = target[7][l]  - frames.pose[7][l];
+            error[2][l]      = target[11][l] - frames.pose[11][l];
+            positionError[l] = error[0][l] * error[0][l] + error[1][l] * error[1][l] + error[2][l] * error[2][l];
+            angleError[l]    = 0.0f;
+        }
+        if (m == 6)
+        {
+            FOR_LANES(l)
+            {
+                error[3][l] = error[4][l] = error[5][l] = 0.0f;
+            }
+            for (uint8_t k = 0; k < 3; k++)
+            {
+                const float* cx = frames.pose[k];
+                const float* cy = frames.pose[4 + k];
+                const float* cz = frames.pose[8 + k];
+                FOR_LANES(l)
+                {
+                    error[3][l] += 0.5f * (cy[l] * target[8 + k][l] - cz[l] * target[4 + k][l]);
+                    error[4][l] += 0.5f * (cz[l] * target[k][l]     - cx[l] * target[8 + k][l]);
+                    error[5][l] += 0.5f * (cx[l] * target[4 + k][l] - cy[l] * target[k][l]);
+                }
+            }
+            FOR_LANES(l)
+            {
+                angleError[l] = error[3][l] * error[3][l] + error[4][l] * error[4][l] + error[5][l] * error[5][l];
+            }
+        }
+
+        converged = 0;
+        for (uint8_t l = 0; l < chain->lanes; l++)
+        {
+            converged |= (uint32_t)(positionError[l] <= tolerance && angleError[l] <= angleTol) << l;
+        }
+        if (converged == (1ull << chain->lanes) - 1 || iteration == chain->iterations)
+        {
+            break;
+        }
+
+        // Jacobian: linear part axis x (end - origin), angular part axis
+        LSS_Lanes jacobian[6][LSS_KINEMATICS_MAX_JOINTS];
+        for (uint8_t j = 0; j < n; j++)
+        {
+            const float* zx = frames.axis[j][0];
+            const float* zy = frames.axis[j][1];
+            const float* zz = frames.axis[j][2];
+            FOR_LANES(l)
+            {
+                float rx          = frames.pose[3][l]  - frames.origin[j][0][l];
+                float ry          = frames.pose[7][l]  - frames.origin[j][1][l];
+                float rz          = frames.pose[11][l] - frames.origin[j][2][l];
+                jacobian[0][j][l] = zy[l] * rz - zz[l] * ry;
+                jacobian[1][j][l] = zz[l] * rx - zx[l] * rz;
+                jacobian[2][j][l] = zx[l] * ry - zy[l] * rx;
+                jacobian[3][j][l] = zx[l];
+                jacobian[4][j][l] = zy[l];
+                jacobian[5][j][l] = zz[l];
+            }
+        }
+
+        // (J J^T + lambda^2 I) y = error, then dq = J^T y
+        LSS_Lanes A[6][6];
+        for (uint8_t r = 0; r < m; r++)
+        {
+            for (uint8_t c = 0; c <= r; c++)
+            {
+                FOR_LANES(l)
+                {
+                    A[r][c][l] = (r == c) ? lambda2 : 0.0f;
+                }
+                for (uint8_t j = 0; j < n; j++)
+                {
+                    FOR_LANES(l)
+                    {
+                        A[r][c][l] += jacobian[r][j][l] * jacobian[c][j][l];
+                    }
+                }
+            }
+        }
+        solve_damped(m, A, error);
+
+        for (uint8_t j = 0; j < n; j++)
+        {
+            LSS_Lanes step = {0};
+            for (uint8_t r = 0; r < m; r++)
+            {
+                FOR_LANES(l)
+                {
+                    step[l] += jacobian[r][j][l] * error[r][l];
+                }
+            }
+            FOR_LANES(l)
+            {
+                float angle = q[j][l] + step[l];
+                angle       = (angle < qMin[j][l]) ? qMin[j][l] : angle;
+                q[j][l]     = (angle > qMax[j][l]) ? qMax[j][l] : angle;
+            }
+        }
+    }
+
+    return converged;
+}
+
+/* Servo positions (1/10°) of joint angles q, lane by lane in joint order, skipping joints without
+ * a servo (the order LSS_chain_move uses).
+ * Returns false if a position had to be clamped to its joint's limits. */
+bool LSS_chain_positions(const LSS_Chain* chain, const LSS_Lanes q[], int16_t positions[])
+{
+    // Whole rows of lanes at once, in the same units and rounding as the rest of the library
+    int16_t tenths[LSS_KINEMATICS_MAX_JOINTS][LSS_KINEMATICS_LANES];
+    for (uint8_t j = 0; j < chain->joints; j++)
+    {
+        LSS_units_rad_to_position(q[j], chain->offset[j], chain->gyre[j], tenths[j], KIN_L);
+    }
+
+    bool    inRange = true;
+    uint8_t count   = 0;
+
+    for (uint8_t l = 0; l < chain->lanes; l++)
+    {
+        for (uint8_t j = 0; j < chain->joints; j++)
+        {
+            if (chain->servos[j][l] == NULL)
+            {
+                continue;
+            }
+
+            int16_t position = tenths[j][l];
+            if (position < chain->lower[j][l] || position > chain->upper[j][l])
+            {
+                position = (position < chain->lower[j][l]) ? chain->lower[j][l] : chain->upper[j][l];
+                inRange  = false;
+            }
+            positions[count++] = position;
+        }
+    }
+
+    return inRange;
+}
+
+/* Move every servo of the chain to joint angles q as one group move (one burst per bus), with an
+ * optional T parameter (0 for none). Positions out of the joint limits are clamped.
+ * Chains with more servos than LSS_GROUP_MAX_SIZE are sent as several group moves, back to back.
+ * Returns true if every frame was sent. */
+bool LSS_chain_move(const LSS_Chain* chain, const LSS_Lanes q[], int16_t tValue)
+{
+    LSS*    servos   [LSS_KINEMATICS_MAX_JOINTS * LSS_KINEMATICS_LANES];
+    int16_t positions[LSS_KINEMATICS_MAX_JOINTS * LSS_KINEMATICS_LANES];
+    uint8_t count = 0;
+
+    for (uint8_t l = 0; l < chain->lanes; l++)
+    {
+        for (uint8_t j = 0; j < chain->joints; j++)
+        {
+            if (chain->servos[j][l] != NULL)
+            {
+                servos[count++] = chain->servos[j][l];
+            }
+        }
+    }
+
+    LSS_chain_positions(chain, q, positions);
+
+    bool success = true;
+    for (uint16_t first = 0; first < count; first += LSS_GROUP_MAX_SIZE)
+    {
+        uint8_t n = (count - first < LSS_GROUP_MAX_SIZE) ? (uint8_t)(count - first) : LSS_GROUP_MAX_SIZE;
+        success  &= LSS_move_group(&servos[first], n, &positions[first], tValue);
+    }
+    return success;
+}
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+
+// Walk the chain from each lane's base: T = base * A_0(q_0) * ... * A_n-1(q_n-1)
+static void chain_frames(const LSS_Chain* chain, const LSS_Lanes q[], LSS_ChainFrames* frames)
+{
+    LSS_Lanes* T = frames->pose;
+    memcpy(T, chain->base, sizeof(frames->pose));
+
+    for (uint8_t j = 0; j < chain->joints; j++)
+    {
+        // The joint turns about the z axis of the previous frame
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            memcpy(frames->axis[j][i],   T[4 * i + 2], sizeof(LSS_Lanes));
+            memcpy(frames->origin[j][i], T[4 * i + 3], sizeof(LSS_Lanes));
+        }
+
+        LSS_Lanes angle, s, c;
+        FOR_LANES(l)
+        {
+            angle[l] = chain->theta[j][l] + q[j][l];
+        }
+        sin_cos(angle, s, c);
+
+        const float* a  = chain->a[j];
+        const float* d  = chain->d[j];
+        const float* ca = chain->cosAlpha[j];
+        const float* sa = chain->sinAlpha[j];
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            FOR_LANES(l)
+            {
+                float x = T[4 * i][l], y = T[4 * i + 1][l], z = T[4 * i + 2][l], p = T[4 * i + 3][l];
+                float u = x * c[l] + y * s[l];
+                float v = y * c[l] - x * s[l];
+                T[4 * i][l]     = u;
+                T[4 * i + 1][l] = v * ca[l] + z * sa[l];
+                T[4 * i + 2][l] = z * ca[l] - v * sa[l];
+                T[4 * i + 3][l] = u * a[l] + z * d[l] + p;
+            }
+        }
+    }
+}
+
+// Sine and cosine of every lane, accurate to ~1e-7 over ±1e4 rad
+static void sin_cos(const LSS_Lanes x, LSS_Lanes s, LSS_Lanes c)
+{
+    FOR_LANES(l)
+    {
+        // Reduce to r in [-pi/4, pi/4] and a quadrant, pi/2 split in three parts (Cody-Waite)
+        float   k        = x[l] * 0.636619772f;
+        int32_t quadrant = (int32_t)(k + ((k < 0.0f) ? -0.5f : 0.5f));
+        float   fq       = (float)quadrant;
+        float   r        = ((x[l] - fq * 1.5703125f) - fq * 4.837512969970703125e-4f) - fq * 7.54978995489188216e-8f;
+
+        float sr = sin_poly(r);
+        float cr = cos_poly(r);
+
+        int32_t q = quadrant & 3;
+        float   sv = (q & 1) ? cr : sr;
+        float   cv = (q & 1) ? sr : cr;
+        s[l]       = (q & 2) ? -sv : sv;
+        c[l]       = ((q + 1) & 2) ? -cv : cv;
+    }
+}
+
+// Minimax polynomials over [-pi/4, pi/4] (Cephes)
+static float sin_poly(float r)
+{
+    float r2 = r * r;
+    return r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+}
+
+static float cos_poly(float r)
+{
+    float r2 = r * r;
+    return 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+}
+
+/* Solve A y = b in place for every lane (b receives y), A symmetric positive definite (lower triangle
+ * used), by Cholesky decomposition. The damping keeps A well conditioned near singularities. */
+static void solve_damped(uint8_t m, LSS_Lanes A[6][6], LSS_Lanes y[6])
+{
+    LSS_Lanes inverseDiagonal[6];
+
+    for (uint8_t c = 0; c < m; c++)
+    {
+        for (uint8_t k = 0; k < c; k++)
+        {
+            FOR_LANES(l)
+            {
+                A[c][c][l] -= A[c][k][l] * A[c][k][l];
+            }
+        }
+        FOR_LANES(l)
+        {
+            A[c][c][l]            = sqrtf(A[c][c][l]);
+            inverseDiagonal[c][l] = 1.0f / A[c][c][l];
+        }
+        for (uint8_t r = c + 1; r < m; r++)
+        {
+            for (uint8_t k = 0; k < c; k++)
+            {
+                FOR_LANES(l)
+                {
+                    A[r][c][l] -= A[r][k][l] * A[c][k][l];
+                }
+            }
+            FOR_LANES(l)
+            {
+                A[r][c][l] *= inverseDiagonal[c][l];
+            }
+        }
+    }
+
+    // L z = b, then L^T y = z
+    for (uint8_t r = 0; r < m; r++)
+    {
+        for (uint8_t k = 0; k < r; k++)
+        {
+            FOR_LANES(l)
+            {
+                y[r][l] -= A[r][k][l] * y[k][l];
+            }
+        }
+        FOR_LANES(l)
+        {
+            y[r][l] *= inverseDiagonal[r][l];
+        }
+    }
+    for (int8_t r = (int8_t)(m - 1); r >= 0; r--)
+    {
+        for (uint8_t k = (uint8_t)(r + 1); k < m; k++)
+        {
+            FOR_LANES(l)
+            {
+                y[r][l] -= A[k][r][l] * y[k][l];
+            }
+        }
+        FOR_LANES(l)
+        {
+            y[r][l] *= inverseDiagonal[r][l];
+        }
+    }
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,108 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Kinematic chains of servos, solved in batches.
+ *                  A chain is made of up to LSS_KINEMATICS_LANES serial chains of revolute joints
+ *                  (lanes) that are solved side by side: the legs of a hexapod, or one arm solved for
+ *                  several targets at once. Joint data is stored as structure-of-arrays, lane last, so
+ *                  every loop over lanes runs on contiguous floats and is auto-vectorized (build with
+ *                  -O3, or -O2 -ftree-vectorize). Sines and cosines are computed inline for the same reason.
+ *
+ *  Conventions:
+ *      Geometry uses standard Denavit-Hartenberg parameters (a, alpha, d, theta), any length unit.
+ *      Joint angles (q) are in radians, in the chain's frame. The servo position of a joint is
+ *      offset + gyre * q (in 1/10°), kept within [lower, upper].
+ *      Poses are 3x4 row-major matrices [R | p], as 12 rows of lanes.
+ *
+ *  Needs LSS_Units.c.
+ *
+ *  Usage:
+ *      static LSS_Chain legs;
+ *      LSS_chain_init(&legs, 3, 6);
+ *      LSS_chain_set_joint(&legs, leg, joint, &servos[leg][joint], a, alpha, d, theta);
+ *      LSS_chain_read_joint(&legs, leg, joint, LSS_QueryConfig);
+ *      LSS_chain_inverse(&legs, targets, q);      // q holds the current angles, used as first guess
+ *      LSS_chain_move(&legs, q, 200);
+ */
+#ifndef LSS_KINEMATICS_H
+#define LSS_KINEMATICS_H
+
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#ifndef LSS_KINEMATICS_LANES
+#define LSS_KINEMATICS_LANES        (8)     // chains solved side by side, up to 32
+#endif
+
+#ifndef LSS_KINEMATICS_MAX_JOINTS
+#define LSS_KINEMATICS_MAX_JOINTS   (8)     // per lane
+#endif
+
+#define LSS_KINEMATICS_POSE_SIZE    (12)
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+//> One value per lane
+typedef float LSS_Lanes[LSS_KINEMATICS_LANES];
+
+typedef struct {
+    uint8_t joints;     // per lane
+    uint8_t lanes;      // lanes in use, the others are computed but ignored
+
+    // Servos, NULL for a joint that isn't driven
+    LSS* servos[LSS_KINEMATICS_MAX_JOINTS][LSS_KINEMATICS_LANES];
+
+    // Servo mapping, in 1/10°
+    int16_t offset[LSS_KINEMATICS_MAX_JOINTS][LSS_KINEMATICS_LANES];
+    int8_t  gyre  [LSS_KINEMATICS_MAX_JOINTS][LSS_KINEMATICS_LANES];
+    int16_t lower [LSS_KINEMATICS_MAX_JOINTS][LSS_KINEMATICS_LANES];
+    int16_t upper [LSS_KINEMATICS_MAX_JOINTS][LSS_KINEMATICS_LANES];
+
+    // Geometry (DH), alpha is kept as its cosine and sine
+    LSS_Lanes a       [LSS_KINEMATICS_MAX_JOINTS];
+    LSS_Lanes cosAlpha[LSS_KINEMATICS_MAX_JOINTS];
+    LSS_Lanes sinAlpha[LSS_KINEMATICS_MAX_JOINTS];
+    LSS_Lanes d       [LSS_KINEMATICS_MAX_JOINTS];
+    LSS_Lanes theta   [LSS_KINEMATICS_MAX_JOINTS];
+    LSS_Lanes base    [LSS_KINEMATICS_POSE_SIZE];  // pose of each lane's first joint frame
+
+    // Inverse kinematics (damped least squares)
+    bool    orientation;    // solve for the whole pose, else for the position only
+    uint8_t iterations;
+    float   damping;
+    float   tolerance;      // position, in length units
+    float   angleTolerance; // orientation, in rad
+} LSS_Chain;
+
+
+/*************************************************************************************************/
+/* Public functions declarations --------------------------------------------------------------- */
+void     LSS_chain_init      (LSS_Chain* chain, uint8_t joints, uint8_t lanes);
+void     LSS_chain_set_joint (LSS_Chain* chain, uint8_t lane, uint8_t joint, LSS* servo,
+                              float a, float alpha, float d, float theta);
+bool     LSS_chain_read_joint(LSS_Chain* chain, uint8_t lane, uint8_t joint, LSS_QueryType queryType);
+
+void     LSS_chain_forward   (const LSS_Chain* chain, const LSS_Lanes q[], LSS_Lanes pose[]);
+uint32_t LSS_chain_inverse   (const LSS_Chain* chain, const LSS_Lanes target[], LSS_Lanes q[]);
+
+bool     LSS_chain_positions (const LSS_Chain* chain, const LSS_Lanes q[], int16_t positions[]);
+bool     LSS_chain_move      (const LSS_Chain* chain, const LSS_Lanes q[], int16_t tValue);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,447 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Linux port of the library, termios serial backend.
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#define _DEFAULT_SOURCE     // clock_gettime, nanosleep with -std=c11
+
+#include "LSS.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// termios2 allows any baud rate (BOTHER), <termios.h> can't be included alongside it
+#include <asm/ioctls.h>
+#include <asm/termbits.h>
+#include <linux/serial.h>
+
+int ioctl(int fd, unsigned long request, ...);
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define LSS_LINUX_RX_THREAD_PERIOD  (10)    // in ms, how often the reception thread checks if it must stop
+
+
+/*************************************************************************************************/
+/* Private variables --------------------------------------------------------------------------- */
+// Reception can be served by the application thread and a reception thread at the same time
+static pthread_mutex_t rxLock  = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  rxArmed = PTHREAD_COND_INITIALIZER;
+
+// LSS_WaitCondition
+static pthread_mutex_t waitLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  waitCond = PTHREAD_COND_INITIALIZER;
+static uint32_t        notifications;
+static uint32_t        notificationsSeen;
+
+
+/*************************************************************************************************/
+/* Private functions declarations -------------------------------------------------------------- */
+static bool     configure_port(UART_HandleTypeDef* huart);
+static void     set_low_latency(int fd);
+static uint64_t monotonic_us  (void);
+static void     deadline_in   (struct timespec* deadline, uint32_t timeout);
+static void*    rx_thread     (void* argument);
+static void     condition_wait  (void* context, UART_HandleTypeDef* huart, uint32_t timeout);
+static void     condition_notify(void* context);
+
+
+/*************************************************************************************************/
+/* Public variables ---------------------------------------------------------------------------- */
+const LSS_WaitStrategy LSS_WaitCondition = {condition_wait, condition_notify, NULL};
+
+
+/*************************************************************************************************/
+/* Public functions definitions ---------------------------------------------------------------- */
+
+/* ---------- */
+/* HAL subset */
+
+// Open the port (once, several servos usually share it) and apply the baud rate
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef* huart)
+{
+    if (!huart->opened)
+    {
+        huart->fd = open(huart->device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (huart->fd < 0)
+        {
+            return HAL_ERROR;
+        }
+        huart->opened = true;
+    }
+
+    if (!configure_port(huart))
+    {
+        return HAL_ERROR;
+    }
+
+    huart->gState  = HAL_UART_STATE_READY;
+    huart->RxState = HAL_UART_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_DeInit(UART_HandleTypeDef* huart)
+{
+    if (huart->opened)
+    {
+        close(huart->fd);
+        huart->opened = false;
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size,
+                                    uint32_t timeout)
+{
+    uint32_t start   = HAL_GetTick();
+    uint16_t written = 0;
+
+    while (written < size)
+    {
+        ssize_t count = write(huart->fd, &data[written], size - written);
+        if (count > 0)
+        {
+            written += count;
+            continue;
+        }
+        if (count < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            return HAL_ERROR;
+        }
+
+        // Output buffer full, wait for room
+        uint32_t elapsed = HAL_GetTick() - start;
+        if (elapsed >= timeout)
+        {
+            return HAL_TIMEOUT;
+        }
+        struct pollfd pfd = {.fd = huart->fd, .events = POLLOUT};
+        poll(&pfd, 1, timeout - elapsed);
+    }
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size,
+                                   uint32_t timeout)
+{
+    uint32_t start = HAL_GetTick();
+    uint16_t got   = 0;
+
+    while (got < size)
+    {
+        ssize_t count = read(huart->fd, &data[got], size - got);
+        if (count > 0)
+        {
+            got += count;
+            continue;
+        }
+        if (count < 0 && errno != EAGAIN && errno != EINTR)
+        {
+            return HAL_ERROR;
+        }
+
+        uint32_t elapsed = HAL_GetTick() - start;
+        if (elapsed >= timeout)
+        {
+            return HAL_TIMEOUT;
+        }
+        struct pollfd pfd = {.fd = huart->fd, .events = POLLIN};
+        poll(&pfd, 1, timeout - elapsed);
+    }
+
+    return HAL_OK;
+}
+
+// No transmit interrupt on Linux, the kernel buffers the whole burst in one write
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size)
+{
+    return HAL_UART_Transmit(huart, data, size, 100);
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size)
+{
+    return HAL_UART_Transmit(huart, data, size, 100);
+}
+
+// Arm background reception, bytes are moved in by LSS_linux_poll_rx
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size)
+{
+    pthread_mutex_lock(&rxLock);
+    if (huart->RxState != HAL_UART_STATE_READY)
+    {
+        pthread_mutex_unlock(&rxLock);
+        return HAL_BUSY;
+    }
+
+    huart->pRxBuffPtr  = data;
+    huart->RxXferSize  = size;
+    huart->RxXferCount = size;
+    huart->RxState     = HAL_UART_STATE_BUSY_RX;
+    pthread_cond_broadcast(&rxArmed);
+    pthread_mutex_unlock(&rxLock);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive_IT(UART_HandleTypeDef* huart)
+{
+    pthread_mutex_lock(&rxLock);
+    huart->RxXferCount = 0;
+    huart->RxState     = HAL_UART_STATE_READY;
+    pthread_mutex_unlock(&rxLock);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortTransmit(UART_HandleTypeDef* huart)
+{
+    ioctl(huart->fd, TCFLSH, TCOFLUSH);
+    huart->gState = HAL_UART_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_HalfDuplex_EnableTransmitter(UART_HandleTypeDef* huart)
+{
+    (void)huart;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_HalfDuplex_EnableReceiver(UART_HandleTypeDef* huart)
+{
+    (void)huart;
+    return HAL_OK;
+}
+
+// No thread preemption point in the library otherwise, used by LSS_WaitYield
+void LSS_yield(void)
+{
+    sched_yield();
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)(monotonic_us() / 1000);
+}
+
+void HAL_Delay(uint32_t delay)
+{
+    struct timespec duration = {.tv_sec = delay / 1000, .tv_nsec = (delay % 1000) * 1000000L};
+    while (nanosleep(&duration, &duration) != 0 && errno == EINTR)
+    {
+    }
+}
+
+// Applications may provide their own
+__attribute__((weak)) void error_handler(void)
+{
+    perror("LSS serial port");
+    abort();
+}
+
+
+/* ------------ */
+/* Port helpers */
+
+/* Stand-in for the RX interrupt: move whatever arrived into the buffer armed by HAL_UART_Receive_IT.
+ * Waits up to timeout ms for the first byte. Returns the number of bytes moved. */
+uint16_t LSS_linux_poll_rx(UART_HandleTypeDef* huart, uint32_t timeout)
+{
+    if (huart->RxState != HAL_UART_STATE_BUSY_RX)
+    {
+        return 0;
+    }
+
+    struct pollfd pfd = {.fd = huart->fd, .events = POLLIN};
+    if (poll(&pfd, 1, timeout) <= 0)
+    {
+        return 0;
+    }
+
+    ssize_t count = 0;
+    pthread_mutex_lock(&rxLock);
+    if (huart->RxState == HAL_UART_STATE_BUSY_RX)
+    {
+        uint16_t offset = huart->RxXferSize - huart->RxXferCount;
+        count           = read(huart->fd, &huart->pRxBuffPtr[offset], huart->RxXferCount);
+        if (count > 0)
+        {
+            huart->RxXferCount -= count;
+            if (huart->RxXferCount == 0)
+            {
+                huart->RxState = HAL_UART_STATE_READY;
+            }
+        }
+    }
+    pthread_mutex_unlock(&rxLock);
+
+    return (count > 0) ? count : 0;
+}
+
+// LSS_WaitSleep: the kernel wakes us when bytes are readable
+void LSS_linux_sleep(UART_HandleTypeDef* huart, uint32_t timeout)
+{
+    if (huart != NULL && huart->opened)
+    {
+        struct pollfd pfd = {.fd = huart->fd, .events = POLLIN};
+        poll(&pfd, 1, timeout);
+    }
+    else
+    {
+        poll(NULL, 0, timeout);
+    }
+}
+
+bool LSS_linux_start_rx_thread(UART_HandleTypeDef* huart)
+{
+    huart->rxThreadRunning = true;
+    if (pthread_create(&huart->rxThread, NULL, rx_thread, huart) != 0)
+    {
+        huart->rxThreadRunning = false;
+        return false;
+    }
+    return true;
+}
+
+void LSS_linux_stop_rx_thread(UART_HandleTypeDef* huart)
+{
+    if (huart->rxThreadRunning)
+    {
+        huart->rxThreadRunning = false;
+        pthread_join(huart->rxThread, NULL);
+    }
+}
+
+uint32_t LSS_linux_micros(void)
+{
+    return (uint32_t)monotonic_us();
+}
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+
+// Raw 8N1 at the requested baud rate, reads never block (waiting is done with poll)
+static bool configure_port(UART_HandleTypeDef* huart)
+{
+    struct termios2 tio;
+    if (ioctl(huart->fd, TCGETS2, &tio) != 0)
+    {
+        return false;
+    }
+
+    tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF);
+    tio.c_oflag &= ~OPOST;
+    tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+    tio.c_cflag &= ~(CSIZE | PARENB | CSTOPB | CRTSCTS | CBAUD);
+    tio.c_cflag |= CS8 | CREAD | CLOCAL | BOTHER;
+    tio.c_ispeed = huart->Init.BaudRate;
+    tio.c_ospeed = huart->Init.BaudRate;
+    tio.c_cc[VMIN]  = 0;
+    tio.c_cc[VTIME] = 0;
+
+    if (ioctl(huart->fd, TCSETS2, &tio) != 0)
+    {
+        return false;
+    }
+
+    set_low_latency(huart->fd);
+    ioctl(huart->fd, TCFLSH, TCIOFLUSH);
+    return true;
+}
+
+// Ask USB-serial drivers to push bytes right away instead of batching them (ex: FTDI 16 ms latency timer)
+static void set_low_latency(int fd)
+{
+    struct serial_struct serial;
+    if (ioctl(fd, TIOCGSERIAL, &serial) == 0)
+    {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        ioctl(fd, TIOCSSERIAL, &serial);
+    }
+}
+
+// Reception thread: plays the RX interrupt, bytes go to the armed buffer and waiters are notified
+static void* rx_thread(void* argument)
+{
+    UART_HandleTypeDef* huart = argument;
+
+    while (huart->rxThreadRunning)
+    {
+        // Leave bytes in the kernel until someone receives
+        pthread_mutex_lock(&rxLock);
+        if (huart->RxState != HAL_UART_STATE_BUSY_RX)
+        {
+            struct timespec deadline;
+            deadline_in(&deadline, LSS_LINUX_RX_THREAD_PERIOD);
+            pthread_cond_timedwait(&rxArmed, &rxLock, &deadline);
+        }
+        pthread_mutex_unlock(&rxLock);
+
+        if (LSS_linux_poll_rx(huart, LSS_LINUX_RX_THREAD_PERIOD) > 0)
+        {
+            LSS_notify_from_isr();
+        }
+    }
+
+    return NULL;
+}
+
+static void condition_wait(void* context, UART_HandleTypeDef* huart, uint32_t timeout)
+{
+    (void)context;
+    (void)huart;
+
+    struct timespec deadline;
+    deadline_in(&deadline, timeout);
+
+    pthread_mutex_lock(&waitLock);
+    while (notifications == notificationsSeen &&
+           pthread_cond_timedwait(&waitCond, &waitLock, &deadline) != ETIMEDOUT)
+    {
+    }
+    notificationsSeen = notifications;
+    pthread_mutex_unlock(&waitLock);
+}
+
+static void condition_notify(void* context)
+{
+    (void)context;
+
+    pthread_mutex_lock(&waitLock);
+    notifications++;
+    pthread_cond_broadcast(&waitCond);
+    pthread_mutex_unlock(&waitLock);
+}
+
+// Absolute CLOCK_REALTIME deadline, as expected by pthread_cond_timedwait
+static void deadline_in(struct timespec* deadline, uint32_t timeout)
+{
+    clock_gettime(CLOCK_REALTIME, deadline);
+    deadline->tv_sec  += timeout / 1000;
+    deadline->tv_nsec += (timeout % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L)
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,131 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Linux port of the library.
+ *                  Provides the subset of the STM32 HAL used by LSS.c on top of a termios serial port
+ *                  (ex: USB-serial adapter), so the library builds unchanged on Linux.
+ *                  Build with LSS_PLATFORM_LINUX defined and LSS_Linux.c added to the sources.
+ *
+ *  Usage:
+ *      UART_HandleTypeDef huart = {.device = "/dev/ttyUSB0"};
+ *      LSS servo;
+ *      LSS_init(&servo, 1, &huart, 115200);
+ */
+#ifndef LSS_LINUX_H
+#define LSS_LINUX_H
+
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define HAL_UART_STATE_READY        (0x20U)
+#define HAL_UART_STATE_BUSY_RX      (0x22U)
+
+#define assert_param(expr)          ((void)0U)
+#define __weak                      __attribute__((weak))
+
+//> Hooks used by LSS.c: no RX interrupt here, bytes are fetched when the library checks for them
+#define LSS_PORT_RX_PUMP(huart)         LSS_linux_poll_rx((huart), 0)
+#define LSS_PORT_SLEEP(huart, timeout)  LSS_linux_sleep((huart), (timeout))
+#define LSS_WAIT_DEFAULT                LSS_WaitSleep
+
+//> High-resolution timestamps (reply stamps, bus tracing), in µs
+#define LSS_PORT_TIMESTAMP()        LSS_linux_micros()
+#define LSS_PORT_TIMESTAMP_INIT()   ((void)0)
+#define LSS_PORT_CLOCK              (1000000)
+
+
+/*************************************************************************************************/
+/* Enums --------------------------------------------------------------------------------------- */
+typedef enum
+{
+    HAL_OK      = 0x00U,
+    HAL_ERROR   = 0x01U,
+    HAL_BUSY    = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+typedef struct {
+    uint32_t BaudRate;      // any rate the adapter supports, not only the standard ones
+} UART_InitTypeDef;
+
+typedef struct {
+    const char*       device;       // ex: "/dev/ttyUSB0", set by the application
+    UART_InitTypeDef  Init;
+
+    int               fd;
+    bool              opened;
+
+    // Background reception (HAL_UART_Receive_IT), filled by LSS_linux_poll_rx
+    uint8_t*          pRxBuffPtr;
+    uint16_t          RxXferSize;
+    volatile uint16_t RxXferCount;
+
+    volatile uint32_t gState;
+    volatile uint32_t RxState;
+
+    // Optional reception thread, see LSS_linux_start_rx_thread
+    pthread_t         rxThread;
+    volatile bool     rxThreadRunning;
+} UART_HandleTypeDef;
+
+
+/*************************************************************************************************/
+/* Public functions declarations --------------------------------------------------------------- */
+
+/* ---------- */
+/* HAL subset */
+HAL_StatusTypeDef HAL_UART_Init           (UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_UART_DeInit         (UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_UART_Transmit       (UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size,
+                                           uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Receive        (UART_HandleTypeDef* huart, uint8_t* data, uint16_t size,
+                                           uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_IT    (UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA   (UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Receive_IT     (UART_HandleTypeDef* huart, uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_AbortReceive_IT(UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_UART_AbortTransmit  (UART_HandleTypeDef* huart);
+
+// A tty can't switch direction: single-wire adapters echo, use LSS_Duplex_Echo
+HAL_StatusTypeDef HAL_HalfDuplex_EnableTransmitter(UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_HalfDuplex_EnableReceiver   (UART_HandleTypeDef* huart);
+
+uint32_t HAL_GetTick(void);
+void     HAL_Delay  (uint32_t delay);
+
+void     error_handler(void);
+
+
+/* ------------ */
+/* Port helpers */
+uint16_t LSS_linux_poll_rx(UART_HandleTypeDef* huart, uint32_t timeout);
+void     LSS_linux_sleep  (UART_HandleTypeDef* huart, uint32_t timeout);
+uint32_t LSS_linux_micros (void);
+
+/* Receive in a background thread that calls LSS_notify_from_isr, like the RX interrupt does on target.
+ * Pairs with LSS_WaitCondition. */
+bool     LSS_linux_start_rx_thread(UART_HandleTypeDef* huart);
+void     LSS_linux_stop_rx_thread (UART_HandleTypeDef* huart);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,141 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Playback of precompiled motion scripts.
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS_Script.h"
+
+#include <string.h>
+
+
+/*************************************************************************************************/
+/* Private functions declarations -------------------------------------------------------------- */
+static uint16_t read_u16(const uint8_t* data);
+static uint32_t read_u32(const uint8_t* data);
+
+
+/*************************************************************************************************/
+/* Public functions definitions ---------------------------------------------------------------- */
+
+/* Validate the image and start the script clock.
+ * Returns false if the image is not a script this player understands, or if its keyframes don't fit in
+ * size (truncated or corrupt image). */
+bool LSS_script_start(LSS_ScriptPlayer* player, UART_HandleTypeDef* huart,
+                      const uint8_t* image, uint32_t size)
+{
+    player->running = false;
+
+    if (size < LSS_SCRIPT_HEADER_SIZE ||
+        memcmp(image, LSS_SCRIPT_MAGIC, sizeof(LSS_SCRIPT_MAGIC) - 1) != 0 ||
+        image[4] != LSS_SCRIPT_VERSION)
+    {
+        return false;
+    }
+
+    // Walk the keyframes once, so playback never reads past the image
+    uint16_t keyframeCount = read_u16(&image[6]);
+    uint32_t offset        = LSS_SCRIPT_HEADER_SIZE;
+    for (uint16_t k = 0; k < keyframeCount; k++)
+    {
+        if (offset + LSS_SCRIPT_KEYFRAME_SIZE > size)
+        {
+            return false;
+        }
+        offset += LSS_SCRIPT_KEYFRAME_SIZE + read_u16(&image[offset + 4]);
+        if (offset > size)
+        {
+            return false;
+        }
+    }
+
+    player->huart         = huart;
+    player->image         = image;
+    player->size          = size;
+    player->keyframeCount = keyframeCount;
+    player->nextKeyframe  = 0;
+    player->offset        = LSS_SCRIPT_HEADER_SIZE;
+    player->startTick     = HAL_GetTick();
+    player->running       = player->keyframeCount > 0;
+
+    return true;
+}
+
+/* Send the next keyframe if it is due. Call this often, ideally every tick (ex: from a 1 ms timer).
+ * Keyframe times are relative to the start of the script, so late calls never accumulate drift.
+ * Returns true while the script is still running. */
+bool LSS_script_update(LSS_ScriptPlayer* player)
+{
+    if (!player->running)
+    {
+        return false;
+    }
+
+    // Previous keyframe still going out
+    if (player->huart->gState != HAL_UART_STATE_READY)
+    {
+        return true;
+    }
+
+    if (player->nextKeyframe >= player->keyframeCount)
+    {
+        player->running = false;
+        return false;
+    }
+
+    if (player->offset + LSS_SCRIPT_KEYFRAME_SIZE > player->size)
+    {
+        player->running = false;
+        return false;
+    }
+
+    const uint8_t* keyframe = &player->image[player->offset];
+    uint32_t       time     = read_u32(&keyframe[0]);
+    uint16_t       length   = read_u16(&keyframe[4]);
+
+    if ((HAL_GetTick() - player->startTick) < time)
+    {
+        return true;
+    }
+
+    if (player->offset + LSS_SCRIPT_KEYFRAME_SIZE + length > player->size ||
+        HAL_UART_Transmit_DMA(player->huart, (uint8_t*)&keyframe[LSS_SCRIPT_KEYFRAME_SIZE], length) != HAL_OK)
+    {
+        player->running = false;
+        return false;
+    }
+
+    player->offset += LSS_SCRIPT_KEYFRAME_SIZE + length;
+    player->nextKeyframe++;
+    return true;
+}
+
+void LSS_script_stop(LSS_ScriptPlayer* player)
+{
+    if (player->running)
+    {
+        HAL_UART_AbortTransmit(player->huart);
+    }
+    player->running = false;
+}
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+
+// Images are byte streams, fields may not be aligned
+static uint16_t read_u16(const uint8_t* data)
+{
+    return (uint16_t)data[0] | ((uint16_t)data[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t* data)
+{
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,71 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Playback of precompiled motion scripts.
+ *                  Scripts are built offline by tools/lss_script_compile.py into an image of
+ *                  ready-to-send LSS frames grouped in timed keyframes, meant to live in flash.
+ *                  The player streams each keyframe to the bus with DMA when it is due, no
+ *                  formatting is done at runtime.
+ *
+ *  Image format (little endian):
+ *      header   : "LSSS", version (u8), reserved (u8), keyframe count (u16)
+ *      keyframe : time from start of script in ms (u32), frame bytes (u16), frames
+ */
+#ifndef LSS_SCRIPT_H
+#define LSS_SCRIPT_H
+
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef LSS_PLATFORM_LINUX
+#include "LSS_Linux.h"
+#else
+#include "usart.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define LSS_SCRIPT_MAGIC            ("LSSS")
+#define LSS_SCRIPT_VERSION          (1)
+#define LSS_SCRIPT_HEADER_SIZE      (8)
+#define LSS_SCRIPT_KEYFRAME_SIZE    (6)     // keyframe header, frames excluded
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+typedef struct {
+    UART_HandleTypeDef* huart;
+    const uint8_t*      image;
+    uint32_t            size;
+
+    uint16_t keyframeCount;
+    uint16_t nextKeyframe;
+    uint32_t offset;        // offset of the next keyframe in the image
+    uint32_t startTick;
+    bool     running;
+} LSS_ScriptPlayer;
+
+
+/*************************************************************************************************/
+/* Public functions declarations --------------------------------------------------------------- */
+bool LSS_script_start (LSS_ScriptPlayer* player, UART_HandleTypeDef* huart,
+                       const uint8_t* image, uint32_t size);
+bool LSS_script_update(LSS_ScriptPlayer* player);
+void LSS_script_stop  (LSS_ScriptPlayer* player);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,152 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Servo table shared with other processes (Linux), writer side.
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#define _DEFAULT_SOURCE     // clock_gettime, ftruncate with -std=c11
+
+#include "LSS_Shm.h"
+
+#include <sys/stat.h>
+
+
+/*************************************************************************************************/
+/* Private functions declarations -------------------------------------------------------------- */
+static LSS_ShmSlot* begin_write(LSS_Shm* shm, uint8_t servoID);
+static void         end_write  (LSS_ShmSlot* slot);
+
+
+/*************************************************************************************************/
+/* Public functions definitions ---------------------------------------------------------------- */
+
+/* Create (or take over) the shared table, every slot starts unpublished.
+ * Returns false if the segment couldn't be created or mapped. */
+bool LSS_shm_create(LSS_Shm* shm, const char* name)
+{
+    shm->table = NULL;
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (ftruncate(fd, sizeof(LSS_ShmTable)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    void* table = mmap(NULL, sizeof(LSS_ShmTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (table == MAP_FAILED)
+    {
+        return false;
+    }
+    shm->table = (LSS_ShmTable*)table;
+
+    // Readers attaching meanwhile see no magic and retry
+    __atomic_store_n(&shm->table->header.magic, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memset(shm->table->slots, 0, sizeof(shm->table->slots));
+
+    shm->table->header.version   = LSS_SHM_VERSION;
+    shm->table->header.slotSize  = sizeof(LSS_ShmSlot);
+    shm->table->header.slotCount = LSS_SHM_SLOTS;
+    shm->table->header.writerPid = (int32_t)getpid();
+    shm->table->header.started   = LSS_shm_now();
+    __atomic_store_n(&shm->table->header.magic, LSS_SHM_MAGIC, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Unmap the table, and remove it if name isn't NULL (readers keep their mapping until they detach)
+void LSS_shm_destroy(LSS_Shm* shm, const char* name)
+{
+    if (shm->table != NULL)
+    {
+        munmap(shm->table, sizeof(LSS_ShmTable));
+        shm->table = NULL;
+    }
+    if (name != NULL)
+    {
+        shm_unlink(name);
+    }
+}
+
+// Publish a servo's comm status and health, ex: after its transactions of a control cycle
+void LSS_shm_publish(LSS_Shm* shm, const LSS* lss)
+{
+    LSS_ShmSlot* slot = begin_write(shm, lss->servoID);
+
+    slot->state.commStatus = (uint8_t)lss->lastCommStatus;
+    slot->state.down       = lss->down;
+    slot->state.failures   = lss->failures;
+
+    end_write(slot);
+}
+
+// Publish the replies that carry a servo value, the others are ignored
+void LSS_shm_reply_hook(void* context, uint8_t servoID, const char* cmd, int32_t value,
+                        uint32_t timestamp)
+{
+    static const char* const commands[LSS_Shm_ValueCount] = {
+        [LSS_Shm_Position]    = "QD",
+        [LSS_Shm_Speed]       = "QWD",
+        [LSS_Shm_Current]     = "QC",
+        [LSS_Shm_Voltage]     = "QV",
+        [LSS_Shm_Temperature] = "QT",
+        [LSS_Shm_Status]      = "Q",
+    };
+    (void)timestamp;    // HAL ticks are private to this process, stamps use the shared clock
+
+    for (uint8_t v = 0; v < LSS_Shm_ValueCount; v++)
+    {
+        if (strcmp(cmd, commands[v]) == 0)
+        {
+            LSS_ShmSlot* slot = begin_write(context, servoID);
+
+            slot->state.values[v]  = value;
+            slot->state.stamps[v]  = slot->state.updated;
+            slot->state.commStatus = LSS_CommStatus_ReadSuccess;
+            slot->state.replies++;
+
+            end_write(slot);
+            return;
+        }
+    }
+}
+
+void LSS_shm_health_hook(void* context, LSS* lss, bool up)
+{
+    (void)up;
+    LSS_shm_publish(context, lss);
+}
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+
+// Make the slot odd: readers that start now wait, readers already copying it will retry
+static LSS_ShmSlot* begin_write(LSS_Shm* shm, uint8_t servoID)
+{
+    LSS_ShmSlot* slot     = &shm->table->slots[servoID];
+    uint32_t     sequence = __atomic_load_n(&slot->sequence, __ATOMIC_RELAXED);
+    uint64_t     now      = LSS_shm_now();     // outside of the write, to keep it short
+
+    __atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot->state.servoID = servoID;
+    slot->state.updated = now;
+    return slot;
+}
+
+static void end_write(LSS_ShmSlot* slot)
+{
+    __atomic_store_n(&slot->sequence, slot->sequence + 1, __ATOMIC_RELEASE);
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
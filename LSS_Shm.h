@@ -0,0 +1,56 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Servo table shared with other processes (Linux), writer side.
+ *                  Publishes the values read back by the library (through the reply hook), the comm
+ *                  status and the health of every servo into a POSIX shared-memory segment, read by
+ *                  other processes with LSS_ShmReader.h. Link with -lrt on older glibc.
+ *                  Writes come from a single thread: the one using the library.
+ *
+ *  Usage:
+ *      static LSS_Shm shm;
+ *      LSS_shm_create(&shm, LSS_SHM_DEFAULT_NAME);
+ *      LSS_add_reply_hook(LSS_shm_reply_hook, &shm);      // values
+ *      LSS_set_health_hook(LSS_shm_health_hook, &shm);    // down / up
+ *      LSS_shm_publish(&shm, &servo);                     // comm status, ex: after each control cycle
+ */
+#ifndef LSS_SHM_H
+#define LSS_SHM_H
+
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS.h"
+#include "LSS_ShmReader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+typedef struct {
+    LSS_ShmTable* table;
+} LSS_Shm;
+
+
+/*************************************************************************************************/
+/* Public functions declarations --------------------------------------------------------------- */
+bool LSS_shm_create (LSS_Shm* shm, const char* name);
+void LSS_shm_destroy(LSS_Shm* shm, const char* name);
+void LSS_shm_publish(LSS_Shm* shm, const LSS* lss);
+
+// Match LSS_ReplyHook and LSS_HealthHook, context is the LSS_Shm
+void LSS_shm_reply_hook (void* context, uint8_t servoID, const char* cmd, int32_t value,
+                         uint32_t timestamp);
+void LSS_shm_health_hook(void* context, LSS* lss, bool up);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
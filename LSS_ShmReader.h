@@ -0,0 +1,184 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Reader of the servo table shared by LSS_Shm (Linux), header-only.
+ *                  The process driving the bus publishes every servo's state in a POSIX shared-memory
+ *                  segment; any other process (planner, logger, UI) maps it read-only and reads
+ *                  consistent snapshots without a system call or an IPC hop. Each servo's slot is
+ *                  guarded by a sequence lock: the writer never waits for readers, readers retry the
+ *                  rare read that overlapped a write.
+ *                  Needs nothing else from the library, and works from C and C++ (GCC/Clang atomics).
+ *
+ *  Usage:
+ *      LSS_ShmReader reader;
+ *      LSS_ShmState  state;
+ *      LSS_shm_attach(&reader, LSS_SHM_DEFAULT_NAME);
+ *      if (LSS_shm_read(&reader, 5, &state)) { state.values[LSS_Shm_Position] ... }
+ */
+#ifndef LSS_SHM_READER_H
+#define LSS_SHM_READER_H
+
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define LSS_SHM_DEFAULT_NAME    ("/lss_servos")
+#define LSS_SHM_MAGIC           (0x4D53534CU)   // "LSSM"
+#define LSS_SHM_VERSION         (1)
+#define LSS_SHM_SLOTS           (256)           // one per servo ID
+#define LSS_SHM_READ_TRIES      (1000)          // a write takes ~50 ns, give up if the writer died in one
+
+
+/*************************************************************************************************/
+/* Enums --------------------------------------------------------------------------------------- */
+typedef enum
+{
+    LSS_Shm_Position,       // 1/10°        (QD)
+    LSS_Shm_Speed,          // (1/10°)/s    (QWD)
+    LSS_Shm_Current,        // mA           (QC)
+    LSS_Shm_Voltage,        // mV           (QV)
+    LSS_Shm_Temperature,    // 1/10 °C      (QT)
+    LSS_Shm_Status,         // LSS_Status   (Q)
+    LSS_Shm_ValueCount
+} LSS_ShmValue;
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+//> State of one servo, times are CLOCK_MONOTONIC µs (the same clock in every process)
+typedef struct {
+    int32_t  values[LSS_Shm_ValueCount];
+    uint64_t stamps[LSS_Shm_ValueCount];    // when each value was received, 0 if never
+    uint64_t updated;                       // last change of this slot
+    uint32_t replies;
+    uint8_t  commStatus;                    // LSS_LastCommStatus of the last transaction
+    uint8_t  down;                          // skipped by the library until it answers a probe
+    uint8_t  failures;                      // consecutive timeouts
+    uint8_t  servoID;
+} LSS_ShmState;
+
+//> One cache line pair per servo, so writes to a servo don't disturb readers of its neighbours
+typedef struct {
+    uint32_t     sequence;  // odd while being written, 0 if never written
+    uint32_t     reserved;
+    LSS_ShmState state;
+} __attribute__((aligned(64))) LSS_ShmSlot;
+
+typedef struct {
+    struct __attribute__((aligned(64))) {
+        uint32_t magic;     // written last, once the table is ready
+        uint16_t version;
+        uint16_t slotSize;
+        uint32_t slotCount;
+        int32_t  writerPid;
+        uint64_t started;
+    } header;
+    LSS_ShmSlot slots[LSS_SHM_SLOTS];
+} LSS_ShmTable;
+
+typedef struct {
+    const LSS_ShmTable* table;
+} LSS_ShmReader;
+
+
+/*************************************************************************************************/
+/* Public functions definitions ---------------------------------------------------------------- */
+
+// Current time on the clock of the stamps, in µs
+static inline uint64_t LSS_shm_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+/* Map the table read-only. The mapping survives the writer restarting it in place.
+ * Returns false if it doesn't exist (yet) or isn't a table of this version. */
+static inline bool LSS_shm_attach(LSS_ShmReader* reader, const char* name)
+{
+    reader->table = NULL;
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    void* table = mmap(NULL, sizeof(LSS_ShmTable), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (table == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const LSS_ShmTable* shared = (const LSS_ShmTable*)table;
+    if (__atomic_load_n(&shared->header.magic, __ATOMIC_ACQUIRE) != LSS_SHM_MAGIC ||
+        shared->header.version != LSS_SHM_VERSION || shared->header.slotSize != sizeof(LSS_ShmSlot))
+    {
+        munmap(table, sizeof(LSS_ShmTable));
+        return false;
+    }
+
+    reader->table = shared;
+    return true;
+}
+
+static inline void LSS_shm_detach(LSS_ShmReader* reader)
+{
+    if (reader->table != NULL)
+    {
+        munmap((void*)reader->table, sizeof(LSS_ShmTable));
+        reader->table = NULL;
+    }
+}
+
+// Changes every time a servo's slot is written, to poll for news without copying it
+static inline uint32_t LSS_shm_sequence(const LSS_ShmReader* reader, uint8_t servoID)
+{
+    return __atomic_load_n(&reader->table->slots[servoID].sequence, __ATOMIC_ACQUIRE);
+}
+
+/* Copy a consistent snapshot of a servo's state, retried while the writer is updating it.
+ * Returns false if the servo was never published (or the writer died while writing it). */
+static inline bool LSS_shm_read(const LSS_ShmReader* reader, uint8_t servoID, LSS_ShmState* state)
+{
+    const LSS_ShmSlot* slot = &reader->table->slots[servoID];
+
+    for (uint32_t tries = 0; tries < LSS_SHM_READ_TRIES; tries++)
+    {
+        uint32_t before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1)
+        {
+            continue;
+        }
+        memcpy(state, (const void*)&slot->state, sizeof(*state));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == before)
+        {
+            return before != 0;
+        }
+    }
+    return false;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
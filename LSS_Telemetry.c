@@ -0,0 +1,238 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Compressed telemetry log in a fixed-size ring.
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS_Telemetry.h"
+
+#include <string.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define LSS_TELEMETRY_MAX_RECORD    (10)    // two 5-byte varints
+
+
+/*************************************************************************************************/
+/* Private functions declarations -------------------------------------------------------------- */
+static LSS_TelemetryServo* find_servo (LSS_TelemetryLog* log, uint8_t servoID, uint32_t tick);
+static void                close_stale(LSS_TelemetryLog* log, uint32_t tick);
+static bool                open_block (LSS_TelemetryLog* log, LSS_TelemetryServo* servo, uint32_t tick);
+static void                close_block(LSS_TelemetryLog* log, LSS_TelemetryServo* servo);
+static uint8_t             put_varint (uint8_t* out, uint32_t value);
+
+
+/*************************************************************************************************/
+/* Public functions definitions ---------------------------------------------------------------- */
+
+/* Use storage as the ring, its size is rounded down to whole blocks.
+ * Returns false if it can't hold at least one block per servo plus one. */
+bool LSS_telemetry_init(LSS_TelemetryLog* log, uint8_t* storage, uint32_t size)
+{
+    memset(log, 0, sizeof(*log));
+    memset(storage, 0, size);
+
+    log->storage   = storage;
+    log->slotCount = size / LSS_TELEMETRY_BLOCK_SIZE;
+
+    return log->slotCount > LSS_TELEMETRY_SERVOS;
+}
+
+/* Append a sample (tick in ms). A new block (keyframe) is started when the servo's block is full or
+ * older than LSS_TELEMETRY_KEYFRAME_INTERVAL.
+ * Returns false if the sample was dropped. */
+bool LSS_telemetry_record(LSS_TelemetryLog* log, uint8_t servoID, LSS_TelemetryChannel channel,
+                          uint32_t tick, int32_t value)
+{
+    if (channel >= LSS_Telemetry_ChannelCount)
+    {
+        log->dropped++;
+        return false;
+    }
+
+    LSS_TelemetryServo* servo = find_servo(log, servoID, tick);
+    uint8_t* block = &log->storage[servo->slot * LSS_TELEMETRY_BLOCK_SIZE];
+    if (servo->open &&
+        ((tick - servo->keyframeTick) >= LSS_TELEMETRY_KEYFRAME_INTERVAL ||
+         (int32_t)(tick - servo->lastTick) < 0 ||
+         LSS_TELEMETRY_HEADER_SIZE + block[2] + LSS_TELEMETRY_MAX_RECORD > LSS_TELEMETRY_BLOCK_SIZE))
+    {
+        close_block(log, servo);
+        close_stale(log, tick);
+    }
+    if (!servo->open && !open_block(log, servo, tick))
+    {
+        log->dropped++;
+        return false;
+    }
+    block = &log->storage[servo->slot * LSS_TELEMETRY_BLOCK_SIZE];
+
+    // Zigzag keeps small negative deltas small
+    int32_t  delta  = value - servo->last[channel];
+    uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+
+    uint8_t* out = &block[LSS_TELEMETRY_HEADER_SIZE + block[2]];
+    uint8_t  length = put_varint(out, ((tick - servo->lastTick) << 2) | channel);
+    length         += put_varint(&out[length], zigzag);
+    block[2]       += length;
+
+    servo->last[channel] = value;
+    servo->lastTick      = tick;
+    log->samples++;
+    return true;
+}
+
+// Complete every open block, ex: before dumping the ring or shutting down
+void LSS_telemetry_flush(LSS_TelemetryLog* log)
+{
+    for (uint8_t i = 0; i < LSS_TELEMETRY_SERVOS; i++)
+    {
+        if (log->servos[i].open)
+        {
+            close_block(log, &log->servos[i]);
+        }
+    }
+}
+
+// Log the replies that carry telemetry, the others are ignored
+void LSS_telemetry_reply_hook(void* context, uint8_t servoID, const char* cmd, int32_t value,
+                              uint32_t timestamp)
+{
+    static const char* const commands[LSS_Telemetry_ChannelCount] = {
+        [LSS_Telemetry_Position]    = "QD",
+        [LSS_Telemetry_Current]     = "QC",
+        [LSS_Telemetry_Voltage]     = "QV",
+        [LSS_Telemetry_Temperature] = "QT",
+    };
+
+    for (uint8_t channel = 0; channel < LSS_Telemetry_ChannelCount; channel++)
+    {
+        if (strcmp(cmd, commands[channel]) == 0)
+        {
+            LSS_telemetry_record(context, servoID, channel, timestamp, value);
+            return;
+        }
+    }
+}
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+
+/* Servo's entry, claiming one for a servo that has no open block: a free one, or when every entry is in
+ * use, the one of the least recently recorded block, which is closed early. */
+static LSS_TelemetryServo* find_servo(LSS_TelemetryLog* log, uint8_t servoID, uint32_t tick)
+{
+    for (uint8_t i = 0; i < LSS_TELEMETRY_SERVOS; i++)
+    {
+        if (log->servos[i].open && log->servos[i].servoID == servoID)
+        {
+            return &log->servos[i];
+        }
+    }
+
+    close_stale(log, tick);
+
+    LSS_TelemetryServo* free   = NULL;
+    LSS_TelemetryServo* oldest = NULL;
+    for (uint8_t i = 0; i < LSS_TELEMETRY_SERVOS; i++)
+    {
+        LSS_TelemetryServo* servo = &log->servos[i];
+        if (!servo->open && (free == NULL || servo->servoID == servoID))
+        {
+            free = servo;
+        }
+        if (servo->open && (oldest == NULL || (int32_t)(servo->lastTick - oldest->lastTick) < 0))
+        {
+            oldest = servo;
+        }
+    }
+
+    if (free == NULL)
+    {
+        close_block(log, oldest);
+        free = oldest;
+    }
+    free->servoID = servoID;
+    return free;
+}
+
+/* Complete the blocks older than LSS_TELEMETRY_KEYFRAME_INTERVAL, their servos stopped reporting.
+ * Runs whenever a block is opened, so at least once per interval while any servo is logging. */
+static void close_stale(LSS_TelemetryLog* log, uint32_t tick)
+{
+    for (uint8_t i = 0; i < LSS_TELEMETRY_SERVOS; i++)
+    {
+        LSS_TelemetryServo* servo = &log->servos[i];
+        if (servo->open && (int32_t)(tick - servo->keyframeTick) >= LSS_TELEMETRY_KEYFRAME_INTERVAL)
+        {
+            close_block(log, servo);
+        }
+    }
+}
+
+// Take the oldest slot that isn't being filled by another servo and write the keyframe
+static bool open_block(LSS_TelemetryLog* log, LSS_TelemetryServo* servo, uint32_t tick)
+{
+    for (uint32_t tries = 0; tries < log->slotCount; tries++)
+    {
+        uint32_t slot = log->head;
+        log->head     = (log->head + 1) % log->slotCount;
+
+        bool busy = false;
+        for (uint8_t i = 0; i < LSS_TELEMETRY_SERVOS; i++)
+        {
+            busy |= (log->servos[i].open && log->servos[i].slot == slot);
+        }
+        if (busy)
+        {
+            continue;
+        }
+
+        uint8_t* block = &log->storage[slot * LSS_TELEMETRY_BLOCK_SIZE];
+        block[0]       = LSS_TELEMETRY_MAGIC;
+        block[1]       = servo->servoID;
+        block[3]       = LSS_TELEMETRY_BLOCK_SIZE;
+        memcpy(&block[4], &log->sequence, 4);
+        block[2]       = put_varint(&block[LSS_TELEMETRY_HEADER_SIZE], tick);
+        log->sequence++;
+
+        servo->open         = true;
+        servo->slot         = slot;
+        servo->keyframeTick = tick;
+        servo->lastTick     = tick;
+        memset(servo->last, 0, sizeof(servo->last));
+        return true;
+    }
+    return false;
+}
+
+static void close_block(LSS_TelemetryLog* log, LSS_TelemetryServo* servo)
+{
+    servo->open = false;
+    if (log->blockDone != NULL)
+    {
+        log->blockDone(log->context, &log->storage[servo->slot * LSS_TELEMETRY_BLOCK_SIZE],
+                       LSS_TELEMETRY_BLOCK_SIZE);
+    }
+}
+
+// LEB128, 7 bits per byte, returns the number of bytes written
+static uint8_t put_varint(uint8_t* out, uint32_t value)
+{
+    uint8_t length = 0;
+    while (value >= 0x80)
+    {
+        out[length++] = (uint8_t)(value | 0x80);
+        value       >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,118 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Compressed telemetry log in a fixed-size ring.
+ *                  Samples (position, current, voltage, temperature) are stored per servo in blocks of
+ *                  LSS_TELEMETRY_BLOCK_SIZE bytes. Each block starts with an absolute timestamp and holds
+ *                  delta/varint-encoded records, so any block decodes on its own (keyframe). When the ring
+ *                  is full, the oldest block is overwritten.
+ *                  Up to LSS_TELEMETRY_SERVOS servos have a block open at the same time: past that, the
+ *                  least recently recorded block is closed early for the new servo, which costs a keyframe
+ *                  and a partly empty block every time it happens. Size it to the servos being logged.
+ *                  Decode a dump of the ring, or blocks streamed through the blockDone callback, with
+ *                  tools/lss_telemetry_decode.py.
+ *
+ *  Block format (little endian):
+ *      header : 'T', servo ID (u8), payload bytes (u8), block size (u8), sequence (u32)
+ *      payload: keyframe tick (varint), then records:
+ *               (ms since previous record << 2 | channel) (varint), value - previous value of the
+ *               channel in this block (zigzag varint, the first value of a channel is absolute)
+ *
+ *  Usage:
+ *      static uint8_t         storage[16 * 1024];
+ *      static LSS_TelemetryLog log;
+ *      LSS_telemetry_init(&log, storage, sizeof(storage));
+ *      LSS_add_reply_hook(LSS_telemetry_reply_hook, &log);    // log every reply read by the library
+ */
+#ifndef LSS_TELEMETRY_H
+#define LSS_TELEMETRY_H
+
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#ifndef LSS_TELEMETRY_BLOCK_SIZE
+#define LSS_TELEMETRY_BLOCK_SIZE        (64)    // up to 255
+#endif
+
+#ifndef LSS_TELEMETRY_SERVOS
+#define LSS_TELEMETRY_SERVOS            (32)    // servos with a block open at the same time (LSS_GROUP_MAX_SIZE)
+#endif
+
+#ifndef LSS_TELEMETRY_KEYFRAME_INTERVAL
+#define LSS_TELEMETRY_KEYFRAME_INTERVAL (1000)  // in ms, longest time covered by a block
+#endif
+
+#define LSS_TELEMETRY_MAGIC             ('T')
+#define LSS_TELEMETRY_HEADER_SIZE       (8)
+
+
+/*************************************************************************************************/
+/* Enums --------------------------------------------------------------------------------------- */
+typedef enum
+{
+    LSS_Telemetry_Position,     // 1/10°
+    LSS_Telemetry_Current,      // mA
+    LSS_Telemetry_Voltage,      // mV
+    LSS_Telemetry_Temperature,  // 1/10 °C
+    LSS_Telemetry_ChannelCount
+} LSS_TelemetryChannel;
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+//> Block being filled for one servo
+typedef struct {
+    uint8_t  servoID;
+    bool     open;
+    uint32_t slot;
+    uint32_t keyframeTick;
+    uint32_t lastTick;
+    int32_t  last[LSS_Telemetry_ChannelCount];
+} LSS_TelemetryServo;
+
+typedef struct {
+    uint8_t* storage;
+    uint32_t slotCount;
+    uint32_t head;          // next slot to fill, the oldest block
+    uint32_t sequence;
+
+    LSS_TelemetryServo servos[LSS_TELEMETRY_SERVOS];
+
+    // Called with every completed block (ex: to copy it to flash or stream it out), may be NULL
+    void (*blockDone)(void* context, const uint8_t* block, uint16_t size);
+    void*   context;
+
+    uint32_t samples;
+    uint32_t dropped;       // samples refused: invalid channel, or every slot of the ring is being filled
+} LSS_TelemetryLog;
+
+
+/*************************************************************************************************/
+/* Public functions declarations --------------------------------------------------------------- */
+bool LSS_telemetry_init  (LSS_TelemetryLog* log, uint8_t* storage, uint32_t size);
+bool LSS_telemetry_record(LSS_TelemetryLog* log, uint8_t servoID, LSS_TelemetryChannel channel,
+                          uint32_t tick, int32_t value);
+void LSS_telemetry_flush (LSS_TelemetryLog* log);
+
+// Matches LSS_ReplyHook, context is the LSS_TelemetryLog
+void LSS_telemetry_reply_hook(void* context, uint8_t servoID, const char* cmd, int32_t value,
+                              uint32_t timestamp);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,182 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Unit conversions over arrays of servo values.
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS_Units.h"
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define UNITS_Q32_RAD_PER_TENTH     (7496132)       // pi / 1800 * 2^32
+#define UNITS_Q16_TENTHS_PER_RAD    (37549362)      // 1800 / pi * 2^16
+
+
+/*************************************************************************************************/
+/* Private functions declarations -------------------------------------------------------------- */
+static inline int32_t  sign_of     (const int8_t gyre[], uint16_t i);
+static inline int32_t  offset_of   (const int16_t offset[], uint16_t i);
+static inline float    round_away  (float x);
+static inline uint32_t out_of_range(float rounded, float lower, float upper);
+static inline float    clamp       (float x, float lower, float upper);
+
+
+/*************************************************************************************************/
+/* Public functions definitions ---------------------------------------------------------------- */
+
+// Take the values out of query results, ex: to convert the results of a pipelined query
+void LSS_units_values(const LSS_Result results[], int32_t values[], uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        values[i] = results[i].value;
+    }
+}
+
+void LSS_units_position_to_rad(const int32_t tenths[], const int16_t offset[], const int8_t gyre[],
+                               float rad[], uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        rad[i] = (float)(sign_of(gyre, i) * (tenths[i] - offset_of(offset, i))) * LSS_UNITS_RAD_PER_TENTH;
+    }
+}
+
+/* Returns false if a position didn't fit in an int16_t and was saturated. */
+bool LSS_units_rad_to_position(const float rad[], const int16_t offset[], const int8_t gyre[],
+                               int16_t tenths[], uint16_t n)
+{
+    uint32_t saturated = 0;     // not a bool, which has no vector type
+    for (uint16_t i = 0; i < n; i++)
+    {
+        float position = (float)offset_of(offset, i) +
+                         (float)sign_of(gyre, i) * rad[i] * LSS_UNITS_TENTHS_PER_RAD;
+        float rounded  = round_away(position);
+
+        saturated |= out_of_range(rounded, INT16_MIN, INT16_MAX);
+        tenths[i]  = (int16_t)clamp(rounded, INT16_MIN, INT16_MAX);
+    }
+    return (saturated == 0);
+}
+
+void LSS_units_position_to_fixed(const int32_t tenths[], const int16_t offset[], const int8_t gyre[],
+                                 LSS_Q16 rad[], uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        int64_t delta = sign_of(gyre, i) * (tenths[i] - offset_of(offset, i));
+        rad[i] = (LSS_Q16)((delta * UNITS_Q32_RAD_PER_TENTH + (1 << 15)) >> 16);
+    }
+}
+
+/* Returns false if a position didn't fit in an int16_t and was saturated. */
+bool LSS_units_fixed_to_position(const LSS_Q16 rad[], const int16_t offset[], const int8_t gyre[],
+                                 int16_t tenths[], uint16_t n)
+{
+    uint32_t saturated = 0;     // not a bool, which has no vector type
+    for (uint16_t i = 0; i < n; i++)
+    {
+        int32_t delta    = (int32_t)(((int64_t)rad[i] * UNITS_Q16_TENTHS_PER_RAD + (1ll << 31)) >> 32);
+        int32_t position = offset_of(offset, i) + sign_of(gyre, i) * delta;
+
+        saturated |= (uint32_t)((position < INT16_MIN) | (position > INT16_MAX));
+        position   = (position < INT16_MIN) ? INT16_MIN : position;
+        position   = (position > INT16_MAX) ? INT16_MAX : position;
+        tenths[i]  = (int16_t)position;
+    }
+    return (saturated == 0);
+}
+
+void LSS_units_speed_to_rad(const int32_t tenthsPerSecond[], const int8_t gyre[], float radPerSecond[],
+                            uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        radPerSecond[i] = (float)(sign_of(gyre, i) * tenthsPerSecond[i]) * LSS_UNITS_RAD_PER_TENTH;
+    }
+}
+
+/* Returns false if a speed didn't fit in an int16_t (the range of wheel()) and was saturated. */
+bool LSS_units_rad_to_speed(const float radPerSecond[], const int8_t gyre[], int16_t tenthsPerSecond[],
+                            uint16_t n)
+{
+    uint32_t saturated = 0;     // not a bool, which has no vector type
+    for (uint16_t i = 0; i < n; i++)
+    {
+        float rounded = round_away((float)sign_of(gyre, i) * radPerSecond[i] * LSS_UNITS_TENTHS_PER_RAD);
+
+        saturated          |= out_of_range(rounded, INT16_MIN, INT16_MAX);
+        tenthsPerSecond[i]  = (int16_t)clamp(rounded, INT16_MIN, INT16_MAX);
+    }
+    return (saturated == 0);
+}
+
+void LSS_units_rpm_to_rad(const int32_t rpm[], const int8_t gyre[], float radPerSecond[], uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        radPerSecond[i] = (float)(sign_of(gyre, i) * rpm[i]) * LSS_UNITS_RAD_PER_RPM;
+    }
+}
+
+/* Returns false if a speed didn't fit in an int8_t (the range of wheel_rpm()) and was saturated. */
+bool LSS_units_rad_to_rpm(const float radPerSecond[], const int8_t gyre[], int8_t rpm[], uint16_t n)
+{
+    uint32_t saturated = 0;     // not a bool, which has no vector type
+    for (uint16_t i = 0; i < n; i++)
+    {
+        float rounded = round_away((float)sign_of(gyre, i) * radPerSecond[i] * LSS_UNITS_RPM_PER_RAD);
+
+        saturated |= out_of_range(rounded, INT8_MIN, INT8_MAX);
+        rpm[i]     = (int8_t)clamp(rounded, INT8_MIN, INT8_MAX);
+    }
+    return (saturated == 0);
+}
+
+void LSS_units_scale(const int32_t raw[], float scale, float out[], uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        out[i] = (float)raw[i] * scale;
+    }
+}
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+
+// NULL mappings are tested once per loop: the compiler unswitches the loop on them
+static inline int32_t sign_of(const int8_t gyre[], uint16_t i)
+{
+    return (gyre != NULL) ? gyre[i] : LSS_GyreClockwise;
+}
+
+static inline int32_t offset_of(const int16_t offset[], uint16_t i)
+{
+    return (offset != NULL) ? offset[i] : 0;
+}
+
+// Rounds to nearest once truncated by the integer conversion, unlike lroundf it vectorizes
+static inline float round_away(float x)
+{
+    return x + ((x < 0.0f) ? -0.5f : 0.5f);
+}
+
+// Whether a value given by round_away truncates outside [lower, upper]
+static inline uint32_t out_of_range(float rounded, float lower, float upper)
+{
+    return (rounded <= lower - 1.0f) | (rounded >= upper + 1.0f);
+}
+
+static inline float clamp(float x, float lower, float upper)
+{
+    x = (x < lower) ? lower : x;
+    return (x > upper) ? upper : x;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,92 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Unit conversions over arrays of servo values.
+ *                  Positions, speeds and telemetry cross the API in raw LSS units (1/10°, (1/10°)/s,
+ *                  RPM, mV, mA, 1/10 °C). These kernels convert whole arrays at once, ex: the results
+ *                  of a pipelined query or the positions of a group move. Each one is a plain counted
+ *                  loop over contiguous arrays without calls or early exits, so the compiler vectorizes
+ *                  it (SSE/AVX, NEON, Helium; build with -O3, or -O2 -ftree-vectorize -funswitch-loops).
+ *
+ *  Conventions:
+ *      Angles are in the servo's frame after its mapping: raw = offset + gyre * angle, offset in 1/10°
+ *      and gyre ±1, one per servo (LSS_ConfigGyre values). Speeds only take the gyre into account.
+ *      offset and gyre can be NULL: no offset, clockwise.
+ *      Conversions back to raw units round to nearest and saturate to the range of the command
+ *      they feed (int16_t for positions and speeds, int8_t for RPM).
+ *      Fixed-point angles are Q16.16 radians (LSS_Q16), for targets without an FPU.
+ *
+ *  Usage:
+ *      LSS_query_results(servos, n, LSS_Query_Position, LSS_QuerySession, results);
+ *      LSS_units_values(results, raw, n);
+ *      LSS_units_position_to_rad(raw, offsets, gyres, q, n);
+ *      ...
+ *      LSS_units_rad_to_position(q, offsets, gyres, positions, n);
+ *      LSS_move_group(servos, n, positions, 0);
+ */
+#ifndef LSS_UNITS_H
+#define LSS_UNITS_H
+
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define LSS_UNITS_RAD_PER_TENTH     (1.74532925e-3f)    // pi / 1800
+#define LSS_UNITS_TENTHS_PER_RAD    (572.957795f)       // 1800 / pi
+#define LSS_UNITS_RAD_PER_RPM       (0.104719755f)      // 2 pi / 60
+#define LSS_UNITS_RPM_PER_RAD       (9.54929659f)       // 60 / (2 pi)
+
+#define LSS_UNITS_Q16_ONE           (65536)
+
+#define LSS_UNITS_VOLTS_PER_MV      (1.0e-3f)
+#define LSS_UNITS_AMPS_PER_MA       (1.0e-3f)
+#define LSS_UNITS_CELSIUS_PER_TENTH (0.1f)
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+//> Q16.16 fixed-point value
+typedef int32_t LSS_Q16;
+
+
+/*************************************************************************************************/
+/* Public functions declarations --------------------------------------------------------------- */
+void LSS_units_values(const LSS_Result results[], int32_t values[], uint16_t n);
+
+// Positions, 1/10° <-> rad
+void LSS_units_position_to_rad  (const int32_t tenths[], const int16_t offset[], const int8_t gyre[],
+                                 float rad[], uint16_t n);
+bool LSS_units_rad_to_position  (const float rad[], const int16_t offset[], const int8_t gyre[],
+                                 int16_t tenths[], uint16_t n);
+void LSS_units_position_to_fixed(const int32_t tenths[], const int16_t offset[], const int8_t gyre[],
+                                 LSS_Q16 rad[], uint16_t n);
+bool LSS_units_fixed_to_position(const LSS_Q16 rad[], const int16_t offset[], const int8_t gyre[],
+                                 int16_t tenths[], uint16_t n);
+
+// Speeds, (1/10°)/s or RPM <-> rad/s
+void LSS_units_speed_to_rad(const int32_t tenthsPerSecond[], const int8_t gyre[], float radPerSecond[],
+                            uint16_t n);
+bool LSS_units_rad_to_speed(const float radPerSecond[], const int8_t gyre[], int16_t tenthsPerSecond[],
+                            uint16_t n);
+void LSS_units_rpm_to_rad  (const int32_t rpm[], const int8_t gyre[], float radPerSecond[], uint16_t n);
+bool LSS_units_rad_to_rpm  (const float radPerSecond[], const int8_t gyre[], int8_t rpm[], uint16_t n);
+
+// Telemetry, ex: mV -> V with LSS_UNITS_VOLTS_PER_MV
+void LSS_units_scale(const int32_t raw[], float scale, float out[], uint16_t n);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
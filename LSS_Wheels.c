@@ -0,0 +1,181 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Velocity control of the wheels of a mobile base, kept in sync.
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS_Wheels.h"
+#include "LSS_Units.h"
+
+#include <math.h>
+#include <string.h>
+
+
+/*************************************************************************************************/
+/* Private functions declarations -------------------------------------------------------------- */
+static float clamp(float x, float limit);
+
+
+/*************************************************************************************************/
+/* Public functions definitions ---------------------------------------------------------------- */
+
+/* Start a base without wheels. halfTrack is half the distance between the left and right wheels,
+ * halfBase half the distance between the front and rear ones (mecanum only). */
+void LSS_wheels_init(LSS_Wheels* wheels, LSS_Drive drive, float radius, float halfTrack, float halfBase)
+{
+    assert_param(radius > 0.0f);
+
+    memset(wheels, 0, sizeof(*wheels));
+    wheels->drive     = drive;
+    wheels->radius    = radius;
+    wheels->halfTrack = halfTrack;
+    wheels->halfBase  = halfBase;
+    wheels->maxSpeed  = LSS_WHEELS_MAX_SPEED;
+    wheels->kp        = LSS_WHEELS_KP;
+    wheels->ki        = LSS_WHEELS_KI;
+}
+
+/* Add a wheel, the servo should already be in wheel mode.
+ * Returns false if the base is full, or if a mecanum wheel isn't placed on a corner. */
+bool LSS_wheels_add(LSS_Wheels* wheels, LSS* servo, LSS_WheelPlace place, LSS_ConfigGyre gyre)
+{
+    bool left   = (place == LSS_Wheel_Left  || place == LSS_Wheel_FrontLeft  || place == LSS_Wheel_RearLeft);
+    bool corner = (place != LSS_Wheel_Left && place != LSS_Wheel_Right);
+    if (wheels->count >= LSS_WHEELS_MAX || gyre == LSS_GyreInvalid ||
+        (wheels->drive == LSS_Drive_Mecanum && !corner))
+    {
+        return false;
+    }
+
+    uint8_t i = wheels->count++;
+    wheels->servos[i] = servo;
+    wheels->gyre[i]   = (int8_t)gyre;
+    wheels->mix[0][i] = 1.0f;
+
+    if (wheels->drive == LSS_Drive_Mecanum)
+    {
+        // Rollers push the front-left and rear-right wheels to the right when they turn forward
+        bool diagonal     = (place == LSS_Wheel_FrontLeft || place == LSS_Wheel_RearRight);
+        wheels->mix[1][i] = diagonal ? -1.0f : 1.0f;
+        wheels->mix[2][i] = (left ? -1.0f : 1.0f) * (wheels->halfTrack + wheels->halfBase);
+    }
+    else
+    {
+        wheels->mix[1][i] = 0.0f;
+        wheels->mix[2][i] = (left ? -1.0f : 1.0f) * wheels->halfTrack;
+    }
+    return true;
+}
+
+/* Set the velocity of the base, vx forward, vy to the left (mecanum) and wz counter-clockwise, in rad/s.
+ * Sent by the next update.
+ * Returns false if a wheel would have gone over maxSpeed: every wheel is then slowed down by the same
+ * ratio, so the base keeps its heading and curvature. */
+bool LSS_wheels_set_velocity(LSS_Wheels* wheels, float vx, float vy, float wz)
+{
+    float fastest = 0.0f;
+    for (uint8_t i = 0; i < wheels->count; i++)
+    {
+        float target = (wheels->mix[0][i] * vx + wheels->mix[1][i] * vy + wheels->mix[2][i] * wz) /
+                       wheels->radius;
+
+        // A wheel changing direction starts over, its trim was learned the other way
+        if (target * wheels->target[i] <= 0.0f)
+        {
+            wheels->trim[i] = 0.0f;
+        }
+        wheels->target[i] = target;
+        fastest           = fmaxf(fastest, fabsf(target));
+    }
+
+    if (fastest <= wheels->maxSpeed)
+    {
+        return true;
+    }
+    for (uint8_t i = 0; i < wheels->count; i++)
+    {
+        wheels->target[i] *= wheels->maxSpeed / fastest;
+    }
+    return false;
+}
+
+/* Run one control cycle: read every wheel speed back (one pipelined QWD sweep), correct each wheel's
+ * command from its error, then send every command in one burst per bus.
+ * A wheel whose speed wasn't read keeps its last correction. Stopped wheels get exactly 0.
+ * Returns true if every speed was read and every command sent. */
+bool LSS_wheels_update(LSS_Wheels* wheels)
+{
+    uint8_t    n = wheels->count;
+    LSS_Result results [LSS_WHEELS_MAX];
+    int32_t    raw     [LSS_WHEELS_MAX];
+    float      measured[LSS_WHEELS_MAX];
+    float      command [LSS_WHEELS_MAX];
+    int16_t    speeds  [LSS_WHEELS_MAX];
+
+    bool read = LSS_query_results(wheels->servos, n, LSS_Query_Speed, LSS_QuerySession, results);
+    LSS_units_values(results, raw, n);
+    LSS_units_speed_to_rad(raw, wheels->gyre, measured, n);
+
+    uint32_t now = LSS_timestamp();
+    float    dt  = (wheels->updates > 0) ? (float)(now - wheels->lastStamp) / (float)LSS_timestamp_clock() : 0.0f;
+    dt                = fminf(dt, LSS_WHEELS_MAX_DT);
+    wheels->lastStamp = now;
+
+    float maxTrim = LSS_WHEELS_MAX_TRIM * wheels->maxSpeed;
+    for (uint8_t i = 0; i < n; i++)
+    {
+        bool ok = LSS_result_ok(results[i]);
+        wheels->measuredMask = ok ? (wheels->measuredMask | (1u << i)) : (wheels->measuredMask & ~(1u << i));
+
+        float error = 0.0f;
+        if (ok)
+        {
+            wheels->measured[i] = measured[i];
+            error               = wheels->target[i] - measured[i];
+            wheels->trim[i]     = clamp(wheels->trim[i] + wheels->ki * error * dt, maxTrim);
+        }
+
+        command[i] = (wheels->target[i] == 0.0f) ? 0.0f
+                                                 : wheels->target[i] + wheels->kp * error + wheels->trim[i];
+    }
+
+    LSS_units_rad_to_speed(command, wheels->gyre, speeds, n);
+    bool sent = LSS_wheel_group(wheels->servos, n, speeds);
+
+    wheels->updates++;
+    wheels->failures += (read ? 0 : 1) + (sent ? 0 : 1);
+    return read && sent;
+}
+
+/* Velocity of the base (vx, vy, wz) from the wheel speeds last read back, the least-squares fit for
+ * wheels placed symmetrically. Wheels that weren't read are left out. */
+void LSS_wheels_odometry(const LSS_Wheels* wheels, float velocity[3])
+{
+    for (uint8_t k = 0; k < 3; k++)
+    {
+        float sum = 0.0f, weight = 0.0f;
+        for (uint8_t i = 0; i < wheels->count; i++)
+        {
+            if (wheels->measuredMask & (1u << i))
+            {
+                sum    += wheels->mix[k][i] * wheels->measured[i];
+                weight += wheels->mix[k][i] * wheels->mix[k][i];
+            }
+        }
+        velocity[k] = (weight > 0.0f) ? wheels->radius * sum / weight : 0.0f;
+    }
+}
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+static float clamp(float x, float limit)
+{
+    return (x < -limit) ? -limit : (x > limit) ? limit : x;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,125 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Velocity control of the wheels of a mobile base, kept in sync.
+ *                  The base's velocity (vx forward, vy to the left, wz counter-clockwise) is turned into
+ *                  a speed per wheel by differential (skid-steer) or mecanum kinematics. Every update
+ *                  reads the wheel speeds back with one pipelined QWD sweep, trims each wheel's command
+ *                  with a light PI correction, so wheels under different loads turn at the same speed,
+ *                  and sends every WD command in one burst per bus.
+ *
+ *  Conventions:
+ *      Lengths (radius, track, wheelbase) in any unit, velocities in that unit per second.
+ *      Wheel speeds in rad/s, positive when the wheel drives the base forward. gyre is the servo's
+ *      speed sign for that: LSS_GyreCounterClockwise for wheels mounted mirrored.
+ *      Mecanum wheels have their rollers in an X seen from above (O seen from below).
+ *
+ *  Update rate:
+ *      One update costs a QWD query and reply and a WD command per wheel, at most about 25 bytes, so
+ *      the wire alone allows at least 500000 / (250 * wheels) updates per second. Measured on the bus
+ *      simulator (tools/lss_wheels_bench.c), 4 wheels on one bus update at ~550 Hz at 500000 baud and
+ *      ~135 Hz at 115200: slow wheels send shorter frames, and the turnaround of the servos is hidden
+ *      by the pipelined sweep. Wheels on separate buses are served at the same time.
+ *
+ *  Needs LSS_Units.c.
+ *
+ *  Usage:
+ *      static LSS_Wheels base;
+ *      LSS_wheels_init(&base, LSS_Drive_Mecanum, 0.04f, 0.12f, 0.10f);
+ *      LSS_wheels_add(&base, &servos[0], LSS_Wheel_FrontLeft, LSS_GyreCounterClockwise);
+ *      ...
+ *      LSS_wheels_set_velocity(&base, 0.3f, 0.0f, 0.5f);
+ *      while (true) { LSS_wheels_update(&base); }
+ */
+#ifndef LSS_WHEELS_H
+#define LSS_WHEELS_H
+
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#ifndef LSS_WHEELS_MAX
+#define LSS_WHEELS_MAX          (8)
+#endif
+
+#ifndef LSS_WHEELS_MAX_SPEED
+#define LSS_WHEELS_MAX_SPEED    (6.28f)     // rad/s (60 RPM), per wheel
+#endif
+
+#define LSS_WHEELS_KP           (0.1f)      // command trim per rad/s of error
+#define LSS_WHEELS_KI           (4.0f)      // command trim per rad of accumulated error
+#define LSS_WHEELS_MAX_TRIM     (0.3f)      // accumulated trim, as a fraction of the max speed
+#define LSS_WHEELS_MAX_DT       (0.1f)      // s, longer gaps between updates count as this
+
+
+/*************************************************************************************************/
+/* Enums --------------------------------------------------------------------------------------- */
+typedef enum {
+    LSS_Drive_Differential,     // any number of wheels per side, vy is ignored
+    LSS_Drive_Mecanum           // one wheel per corner
+} LSS_Drive;
+
+typedef enum {
+    LSS_Wheel_Left,             // differential only
+    LSS_Wheel_Right,
+    LSS_Wheel_FrontLeft,
+    LSS_Wheel_FrontRight,
+    LSS_Wheel_RearLeft,
+    LSS_Wheel_RearRight
+} LSS_WheelPlace;
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+typedef struct {
+    LSS_Drive drive;
+    uint8_t   count;
+    float     radius;
+    float     halfTrack;                // half the distance between left and right wheels
+    float     halfBase;                 // half the distance between front and rear wheels (mecanum)
+
+    // Wheels, one entry per wheel
+    LSS*   servos[LSS_WHEELS_MAX];
+    int8_t gyre  [LSS_WHEELS_MAX];
+    float  mix   [3][LSS_WHEELS_MAX];   // wheel rim speed per unit of vx, vy and wz
+
+    // Control
+    float    maxSpeed;                  // rad/s, wheel targets are scaled down together to stay under it
+    float    kp;
+    float    ki;
+    float    target  [LSS_WHEELS_MAX];  // rad/s
+    float    measured[LSS_WHEELS_MAX];  // rad/s, last speed read back
+    float    trim    [LSS_WHEELS_MAX];  // rad/s, accumulated correction
+    uint32_t measuredMask;              // wheels whose last read succeeded
+    uint32_t lastStamp;                 // LSS_timestamp() of the last update
+
+    uint32_t updates;
+    uint32_t failures;                  // speeds not read back, or commands not sent
+} LSS_Wheels;
+
+
+/*************************************************************************************************/
+/* Public functions declarations --------------------------------------------------------------- */
+void LSS_wheels_init        (LSS_Wheels* wheels, LSS_Drive drive, float radius, float halfTrack,
+                             float halfBase);
+bool LSS_wheels_add         (LSS_Wheels* wheels, LSS* servo, LSS_WheelPlace place, LSS_ConfigGyre gyre);
+bool LSS_wheels_set_velocity(LSS_Wheels* wheels, float vx, float vy, float wz);
+bool LSS_wheels_update      (LSS_Wheels* wheels);
+void LSS_wheels_odometry    (const LSS_Wheels* wheels, float velocity[3]);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,123 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Error of a sweep of positions against the true positions at a single instant, read
+ *                  as is and aligned with LSS_align_results(), on the bus simulator (tools/sim).
+ *                  BENCH_SERVOS servos turn at 300 to 1000°/s. Each round reads them one after the other
+ *                  with LSS_query, BENCH_GAP_MS apart (ex: other bus traffic in between), twice, and
+ *                  compares both the last sweep and its alignment on the time of the last reply with
+ *                  where the simulator has the servos at that time. Prints the worst and mean errors.
+ *
+ *  Build (from the repository root):
+ *      cc -O2 -Itools/sim -I. tools/lss_align_bench.c tools/sim/lss_sim.c LSS.c -o lss_align_bench
+ *
+ *  Usage:
+ *      ./lss_align_bench
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "lss_sim.h"
+#include "LSS.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define BENCH_SERVOS        (8)
+#define BENCH_ROUNDS        (20)
+#define BENCH_BAUD          (115200)
+#define BENCH_GAP_MS        (3)     // between two reads of a sweep
+#define BENCH_SWEEP_MS      (50)    // between the two sweeps of a round
+#define BENCH_FRAME_SIZE    (24)
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+
+// In 1/10°/s, 300°/s for servo 1 up to 1000°/s for servo 8
+static uint64_t speed(uint8_t index)
+{
+    return 3000 + 1000 * index;
+}
+
+static void sweep(LSS servos[], LSS_Result results[])
+{
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        results[i] = LSS_query(&servos[i], LSS_Query_Position, LSS_QuerySession);
+        HAL_Delay(BENCH_GAP_MS);
+    }
+}
+
+
+/*************************************************************************************************/
+/* Main ---------------------------------------------------------------------------------------- */
+int main(void)
+{
+    UART_HandleTypeDef huart = {0};
+    LSS                servos[BENCH_SERVOS];
+    LSS_Result         previous[BENCH_SERVOS];
+    LSS_Result         current[BENCH_SERVOS];
+    int32_t            aligned[BENCH_SERVOS];
+
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        lss_sim_add_servo(&huart, i + 1);
+        LSS_init(&servos[i], i + 1, &huart, BENCH_BAUD);
+    }
+
+    // Targets far enough to keep turning for the whole bench
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        char frame[BENCH_FRAME_SIZE];
+        int  length = snprintf(frame, sizeof(frame), "#%dD100000S%lu\r", i + 1, (unsigned long)speed(i));
+        LSS_send_frame(&servos[i], (const uint8_t*)frame, (uint16_t)length);
+    }
+    HAL_Delay(5);
+
+    int32_t  worstRaw     = 0;
+    int32_t  worstAligned = 0;
+    double   sumRaw       = 0;
+    double   sumAligned   = 0;
+    uint32_t rounds       = 0;
+    for (uint32_t r = 0; r < BENCH_ROUNDS; r++)
+    {
+        sweep(servos, previous);
+        HAL_Delay(BENCH_SWEEP_MS);
+        sweep(servos, current);
+
+        uint32_t stamp = current[BENCH_SERVOS - 1].stamp;
+        if (!LSS_align_results(previous, current, BENCH_SERVOS, stamp, aligned))
+        {
+            continue;
+        }
+
+        // Where the servos were when the last reply started, from the simulator's own record
+        uint64_t late = (uint64_t)(LSS_timestamp() - stamp) * 1000000 / LSS_timestamp_clock();
+        for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+        {
+            int32_t truth = lss_sim_position(&huart, i + 1) - (int32_t)(speed(i) * late / 1000000);
+            int32_t raw   = abs(current[i].value - truth);
+            int32_t error = abs(aligned[i] - truth);
+            worstRaw      = (raw > worstRaw) ? raw : worstRaw;
+            worstAligned  = (error > worstAligned) ? error : worstAligned;
+            sumRaw       += raw;
+            sumAligned   += error;
+        }
+        rounds++;
+    }
+
+    printf("%d servos at 300 to 1000 deg/s, read %d ms apart, %lu/%d rounds aligned\n", BENCH_SERVOS,
+           BENCH_GAP_MS, (unsigned long)rounds, BENCH_ROUNDS);
+    printf("           worst (deg)   mean (deg)\n");
+    printf("raw        %11.1f %12.1f\n", worstRaw / 10.0, sumRaw / 10.0 / (rounds * BENCH_SERVOS));
+    printf("aligned    %11.1f %12.1f\n", worstAligned / 10.0, sumAligned / 10.0 / (rounds * BENCH_SERVOS));
+    return 0;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,140 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Supply current of a group move with and without a current budget (LSS_Budget.h),
+ *                  on the bus simulator (tools/sim), whose servos draw a holding current, a current
+ *                  that follows their speed and an inrush as they start (LSS_SIM_*_MA).
+ *                  BENCH_SERVOS servos move from 0 to 90, 45 or 20°, first all at once at full speed
+ *                  (LSS_move_group), then through LSS_budget_move and LSS_budget_update. Prints the
+ *                  time until every servo is at its target, the highest total current drawn (sampled
+ *                  every millisecond), and for the budget its waves and its planned and measured peaks.
+ *
+ *  Build (from the repository root):
+ *      cc -O2 -Itools/sim -I. tools/lss_budget_bench.c LSS_Budget.c tools/sim/lss_sim.c LSS.c \
+ *         -o lss_budget_bench
+ *
+ *  Usage:
+ *      ./lss_budget_bench [BUDGET_MA]
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "lss_sim.h"
+#include "LSS_Budget.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define BENCH_SERVOS        (18)
+#define BENCH_BAUD          (500000)
+#define BENCH_BUDGET_MA     (6000)
+#define BENCH_UPDATE_MS     (10)    // between two LSS_budget_update
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+typedef struct {
+    UART_HandleTypeDef huart;
+    LSS                servos[BENCH_SERVOS];
+    LSS*               group[BENCH_SERVOS];
+    int16_t            targets[BENCH_SERVOS];
+    uint32_t           peak;    // mA, whole group
+} Bench;
+
+
+/*************************************************************************************************/
+/* Private variables --------------------------------------------------------------------------- */
+static Bench      bench;
+static LSS_Budget budget;
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+static void setup(void)
+{
+    lss_sim_reset();
+    bench.peak = 0;
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        lss_sim_add_servo(&bench.huart, i + 1);
+        LSS_init(&bench.servos[i], i + 1, &bench.huart, BENCH_BAUD);
+        bench.group[i]   = &bench.servos[i];
+        bench.targets[i] = (i % 3 == 0) ? 900 : ((i % 3 == 1) ? 450 : 200);
+    }
+}
+
+static bool arrived(void)
+{
+    bool done = true;
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        done &= (lss_sim_position(&bench.huart, i + 1) == bench.targets[i]);
+    }
+    return done;
+}
+
+// Let ms of simulated time go by, sampling the total current every millisecond
+static void sample(uint32_t ms)
+{
+    for (uint32_t t = 0; t < ms; t++)
+    {
+        uint32_t total = 0;
+        for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+        {
+            total += lss_sim_current(&bench.huart, i + 1);
+        }
+        bench.peak = (total > bench.peak) ? total : bench.peak;
+        HAL_Delay(1);
+    }
+}
+
+static uint32_t settle(uint64_t start)
+{
+    while (!arrived())
+    {
+        sample(1);
+    }
+    return (uint32_t)((lss_sim_nanos() - start) / 1000000);
+}
+
+
+/*************************************************************************************************/
+/* Main ---------------------------------------------------------------------------------------- */
+int main(int argc, char* argv[])
+{
+    uint16_t milliamps = (argc > 1) ? (uint16_t)atoi(argv[1]) : BENCH_BUDGET_MA;
+
+    setup();
+    uint64_t start = lss_sim_nanos();
+    LSS_move_group(bench.group, BENCH_SERVOS, bench.targets, 0);
+    uint32_t plainMs   = settle(start);
+    uint32_t plainPeak = bench.peak;
+
+    setup();
+    if (!LSS_budget_init(&budget, bench.group, BENCH_SERVOS, milliamps))
+    {
+        printf("LSS_budget_init failed\n");
+        return 1;
+    }
+    start = lss_sim_nanos();
+    LSS_budget_move(&budget, bench.targets);
+    while (LSS_budget_update(&budget))
+    {
+        sample(BENCH_UPDATE_MS);
+    }
+    uint32_t budgetMs = settle(start);
+
+    printf("%d servos, %d baud, %u mA budget\n", BENCH_SERVOS, BENCH_BAUD, milliamps);
+    printf("move         at target (ms)   peak (mA)\n");
+    printf("all at once  %14lu %11lu\n", (unsigned long)plainMs, (unsigned long)plainPeak);
+    printf("budget       %14lu %11lu   %u waves, planned %u mA, measured %u mA\n", (unsigned long)budgetMs,
+           (unsigned long)bench.peak, budget.waves, budget.planned, budget.measured);
+    return 0;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,158 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Throughput of a full-duplex bus against a single-wire one, on the bus simulator
+ *                  (tools/sim). BENCH_SERVOS servos are read one at a time, then pipelined
+ *                  (LSS_query_results), then sent a group move, on separate TX and RX lines
+ *                  (LSS_Duplex_Full), on a single wire that echoes every byte (LSS_Duplex_Echo) and on a
+ *                  single-wire UART whose receiver is off while it transmits (LSS_Duplex_Switched).
+ *                  Prints the replies received, the time per sweep of the bus, the replies per second,
+ *                  and the bytes lost to overruns (nothing was receiving them) on each wiring, for the
+ *                  busy and sleep wait strategies.
+ *
+ *  Build (from the repository root):
+ *      cc -O2 -Itools/sim -I. tools/lss_duplex_bench.c tools/sim/lss_sim.c LSS.c -o lss_duplex_bench
+ *
+ *  Usage:
+ *      ./lss_duplex_bench [BAUD]
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "lss_sim.h"
+#include "LSS.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define BENCH_SERVOS        (6)
+#define BENCH_CYCLES        (50)
+#define BENCH_BAUD          (115200)
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+typedef struct {
+    const char*    name;
+    bool           echo;    // what the wire does
+    LSS_DuplexMode mode;    // what the library is told
+} Wiring;
+
+
+/*************************************************************************************************/
+/* Private variables --------------------------------------------------------------------------- */
+static const Wiring wirings[] = {
+    {"full duplex",           false, LSS_Duplex_Full},
+    {"single wire, Echo",     true,  LSS_Duplex_Echo},
+    {"single wire, Switched", false, LSS_Duplex_Switched},
+};
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef* huart)
+{
+    (void)huart;
+    LSS_notify_from_isr();
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef* huart)
+{
+    (void)huart;
+    LSS_notify_from_isr();
+}
+
+static void run(const Wiring* wiring, uint32_t baud)
+{
+    UART_HandleTypeDef huart = {0};
+    LSS                servos[BENCH_SERVOS];
+    LSS*               group[BENCH_SERVOS];
+    LSS_Result         results[BENCH_SERVOS];
+    int16_t            targets[BENCH_SERVOS];
+
+    lss_sim_reset();
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        lss_sim_add_servo(&huart, i + 1);
+        LSS_init(&servos[i], i + 1, &huart, baud);
+        group[i] = &servos[i];
+    }
+    lss_sim_set_echo(&huart, wiring->echo);
+    LSS_set_duplex(&huart, wiring->mode);
+
+    uint32_t single    = 0;
+    uint32_t pipelined = 0;
+    uint64_t start     = lss_sim_nanos();
+    for (uint32_t c = 0; c < BENCH_CYCLES; c++)
+    {
+        for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+        {
+            get_position(&servos[i]);
+            single += (servos[i].lastCommStatus == LSS_CommStatus_ReadSuccess) ? 1 : 0;
+        }
+    }
+    uint64_t singleNs = lss_sim_nanos() - start;
+
+    start = lss_sim_nanos();
+    for (uint32_t c = 0; c < BENCH_CYCLES; c++)
+    {
+        LSS_query_results(group, BENCH_SERVOS, LSS_Query_Position, LSS_QuerySession, results);
+        for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+        {
+            pipelined += (results[i].status == LSS_CommStatus_ReadSuccess) ? 1 : 0;
+        }
+    }
+    uint64_t pipelinedNs = lss_sim_nanos() - start;
+
+    uint32_t moved = 0;
+    start          = lss_sim_nanos();
+    for (uint32_t c = 0; c < BENCH_CYCLES; c++)
+    {
+        for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+        {
+            targets[i] = (int16_t)((c % 2 == 0) ? 100 * i : -100 * i);
+        }
+        moved += LSS_move_group(group, BENCH_SERVOS, targets, 0) ? 1 : 0;
+    }
+    uint64_t moveNs = lss_sim_nanos() - start;
+
+    LSS_SimStats stats;
+    lss_sim_stats(&huart, &stats);
+    printf("%-22s %3lu/%d %6.2f   %3lu/%d %6.2f %6.0f   %2lu/%d %5.2f   %8lu\n", wiring->name,
+           (unsigned long)single, BENCH_CYCLES * BENCH_SERVOS, singleNs / 1e6 / BENCH_CYCLES,
+           (unsigned long)pipelined, BENCH_CYCLES * BENCH_SERVOS, pipelinedNs / 1e6 / BENCH_CYCLES,
+           pipelined / (pipelinedNs / 1e9), (unsigned long)moved, BENCH_CYCLES, moveNs / 1e6 / BENCH_CYCLES,
+           (unsigned long)stats.overruns);
+}
+
+
+/*************************************************************************************************/
+/* Main ---------------------------------------------------------------------------------------- */
+int main(int argc, char* argv[])
+{
+    uint32_t baud = (argc > 1) ? (uint32_t)atoi(argv[1]) : BENCH_BAUD;
+
+    const LSS_WaitStrategy* strategies[] = {&LSS_WaitBusy, &LSS_WaitSleep};
+    const char*             names[]      = {"busy", "sleep"};
+
+    printf("%d servos, %lu baud, %d cycles, times in ms per sweep\n", BENCH_SERVOS, (unsigned long)baud,
+           BENCH_CYCLES);
+    for (uint8_t s = 0; s < 2; s++)
+    {
+        LSS_set_wait_strategy(strategies[s]);
+        printf("\n%-5s wait             single reads   pipelined reads  replies/s  group moves   overruns\n",
+               names[s]);
+        for (uint8_t w = 0; w < sizeof(wirings) / sizeof(wirings[0]); w++)
+        {
+            run(&wirings[w], baud);
+        }
+    }
+    return 0;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,195 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Wire bytes saved by the encoder (LSS_set_encoder), on the bus simulator (tools/sim).
+ *                  BENCH_SERVOS servos on one bus run BENCH_CYCLES 20 ms control cycles, each reading every
+ *                  position (pipelined) and then sending moves, with the encoder off and on:
+ *                  - jog: every servo is nudged by -1, 0 or +1 from where it was read back, with move_t
+ *                    and a T of 0, so D frames can become shorter MD frames and T is dropped;
+ *                  - mixed: group moves along a sine, single moves with and without T, and a group
+ *                    move home with T every second, which can become a broadcast.
+ *                  Prints the bytes sent per cycle (queries included), the bytes saved per cycle and the
+ *                  broadcasts from LSS_encoder_stats(), and whether the servos end up at the same
+ *                  positions with and without the encoder.
+ *
+ *  Build (from the repository root):
+ *      cc -O2 -Itools/sim -I. tools/lss_encoder_bench.c tools/sim/lss_sim.c LSS.c -lm -o lss_encoder_bench
+ *
+ *  Usage:
+ *      ./lss_encoder_bench
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "lss_sim.h"
+#include "LSS.h"
+
+#include <math.h>
+#include <stdio.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define BENCH_SERVOS        (6)
+#define BENCH_CYCLES        (200)
+#define BENCH_CYCLE_MS      (20)
+#define BENCH_BAUD          (115200)
+#define BENCH_SETTLE_MS     (2000)  // before the first cycle and after the last one
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+typedef struct {
+    double   txPerCycle;
+    double   savedPerCycle;
+    uint32_t broadcasts;
+    int32_t  final[BENCH_SERVOS];
+} Outcome;
+
+typedef void (*Step)(LSS servos[], LSS* group[], uint32_t cycle, int16_t targets[]);
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+static void jog_start(int16_t targets[])
+{
+    static const int16_t start[BENCH_SERVOS] = {1750, -1320, 1440, -900, 1655, 1800};
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        targets[i] = start[i];
+    }
+}
+
+static void jog_step(LSS servos[], LSS* group[], uint32_t cycle, int16_t targets[])
+{
+    (void)group;
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        targets[i] += (int16_t)((cycle + i) % 3) - 1;
+        move_t(&servos[i], targets[i], 0);
+    }
+}
+
+static void mixed_start(int16_t targets[])
+{
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        targets[i] = 0;
+    }
+}
+
+static void mixed_step(LSS servos[], LSS* group[], uint32_t cycle, int16_t targets[])
+{
+    if (cycle % 50 == 49)
+    {
+        mixed_start(targets);
+        LSS_move_group(group, BENCH_SERVOS, targets, 500);
+    }
+    else if (cycle % 2 == 1)
+    {
+        for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+        {
+            targets[i] = (int16_t)(1200 + i * 100 + 300 * sin(cycle / 15.0 + i));
+        }
+        LSS_move_group(group, BENCH_SERVOS, targets, 0);
+    }
+    else
+    {
+        for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+        {
+            int16_t target = (int16_t)(-1500 + i * 50 + (cycle % 10) * 3);
+            if (i % 2 == 1)
+            {
+                move_t(&servos[i], target, 0);
+            }
+            else
+            {
+                move(&servos[i], target);
+            }
+        }
+    }
+}
+
+static void run(void (*start)(int16_t targets[]), Step step, bool encoder, Outcome* outcome)
+{
+    UART_HandleTypeDef huart = {0};
+    LSS                servos[BENCH_SERVOS];
+    LSS*               group[BENCH_SERVOS];
+    int16_t            targets[BENCH_SERVOS];
+    int32_t            positions[BENCH_SERVOS];
+
+    lss_sim_reset();
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        lss_sim_add_servo(&huart, i + 1);
+        LSS_init(&servos[i], i + 1, &huart, BENCH_BAUD);
+        group[i] = &servos[i];
+    }
+    LSS_set_encoder(&huart, encoder, BENCH_SERVOS);
+
+    start(targets);
+    LSS_move_group(group, BENCH_SERVOS, targets, 0);
+    HAL_Delay(BENCH_SETTLE_MS);
+
+    LSS_SimStats     before;
+    LSS_SimStats     after;
+    LSS_EncoderStats stats;
+    LSS_encoder_stats(&stats, true);
+    lss_sim_stats(&huart, &before);
+
+    uint64_t begin = lss_sim_nanos();
+    for (uint32_t c = 0; c < BENCH_CYCLES; c++)
+    {
+        LSS_query_pipelined(group, BENCH_SERVOS, LSS_Query_Position, LSS_QuerySession, positions);
+        step(servos, group, c, targets);
+        while (lss_sim_nanos() < begin + (c + 1) * BENCH_CYCLE_MS * 1000000ULL)
+        {
+            HAL_Delay(1);
+        }
+    }
+
+    lss_sim_stats(&huart, &after);
+    LSS_encoder_stats(&stats, false);
+    HAL_Delay(BENCH_SETTLE_MS);
+
+    outcome->txPerCycle    = (double)(after.txBytes - before.txBytes) / BENCH_CYCLES;
+    outcome->savedPerCycle = (double)stats.saved / BENCH_CYCLES;
+    outcome->broadcasts    = stats.broadcasts;
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        outcome->final[i] = lss_sim_position(&huart, i + 1);
+    }
+}
+
+static void compare(const char* name, void (*start)(int16_t targets[]), Step step)
+{
+    Outcome plain;
+    Outcome encoded;
+    run(start, step, false, &plain);
+    run(start, step, true, &encoded);
+
+    bool same = true;
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        same &= (plain.final[i] == encoded.final[i]);
+    }
+    printf("%-8s %11.1f %11.1f %8.1f %10lu   %s\n", name, plain.txPerCycle, encoded.txPerCycle,
+           encoded.savedPerCycle, (unsigned long)encoded.broadcasts, same ? "same" : "DIFFERENT");
+}
+
+
+/*************************************************************************************************/
+/* Main ---------------------------------------------------------------------------------------- */
+int main(void)
+{
+    printf("%d servos, %d baud, %d cycles of %d ms, bytes sent per cycle (queries included)\n",
+           BENCH_SERVOS, BENCH_BAUD, BENCH_CYCLES, BENCH_CYCLE_MS);
+    printf("scenario  encoder off  encoder on    saved  broadcasts   final positions\n");
+    compare("jog", jog_start, jog_step);
+    compare("mixed", mixed_start, mixed_step);
+    return 0;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""
+Emulate LSS servos on a pseudo-terminal, to run the library's Linux port without hardware.
+
+The slave side of the pty is printed on stdout, give it to the application as the UART device
+(UART_HandleTypeDef huart = {.device = "/dev/pts/N"}). Moves (D, MD, with T) are interpolated at the
+servo's max speed or over T, wheel mode (WD, WR) spins at the given speed, scaled by the servo's load
+(--load ID=RATIO, ex: a wheel dragging on carpet), queries (Q, QD, QWD, QWR, QV, QC, QT, QID) reply with
+the simulated state. Every other command is accepted silently. An optional reply delay models the
+servo's turnaround time.
+With --echo, the bus is a single wire: every byte sent comes back before the replies (LSS_Duplex_Echo),
+and a reply to a frame that is followed by more bytes of the same write is lost in a collision.
+
+Usage:
+    lss_fake_servo.py 1 2 3 --delay-us 200
+    lss_fake_servo.py 1 2 3 --echo
+    lss_fake_servo.py 1 2 3 4 --load 2=0.9 --load 3=0.8
+"""
+import argparse
+import os
+import re
+import select
+import time
+import tty
+
+FRAME = re.compile(rb"#(\d+)([A-Z]+)(-?\d+)?((?:[A-Z]+-?\d+)*)\r")
+
+
+class Servo:
+    def __init__(self, servo_id, max_speed, load):
+        self.id        = servo_id
+        self.max_speed = max_speed  # (1/10°)/s
+        self.load      = load       # wheel speed reached, per unit of speed commanded
+        self.start     = 0.0
+        self.target    = 0.0
+        self.t0        = time.monotonic()
+        self.duration  = 0.0
+        self.wheel     = 0
+
+    def position(self):
+        if self.wheel:
+            return self.start + self.wheel * (time.monotonic() - self.t0)
+        if self.duration <= 0:
+            return self.target
+        ratio = min((time.monotonic() - self.t0) / self.duration, 1.0)
+        return self.start + (self.target - self.start) * ratio
+
+    def speed(self):
+        if self.wheel:
+            return self.wheel
+        moving = 0 < self.duration and time.monotonic() - self.t0 < self.duration
+        return (self.target - self.start) / self.duration if moving else 0
+
+    def move(self, target, time_ms):
+        self.start    = self.position()
+        self.target   = target
+        self.t0       = time.monotonic()
+        self.wheel    = 0
+        distance      = abs(target - self.start)
+        self.duration = time_ms / 1000.0 if time_ms else distance / self.max_speed
+
+    def spin(self, speed):
+        self.start = self.position()
+        self.t0    = time.monotonic()
+        self.wheel = speed * self.load
+
+    def handle(self, cmd, value, params):
+        if cmd == "D" and value is not None:
+            self.move(value, params.get("T", 0))
+        elif cmd == "MD" and value is not None:
+            self.move(self.position() + value, params.get("T", 0))
+        elif cmd == "WD" and value is not None:
+            self.spin(value)
+        elif cmd == "WR" and value is not None:
+            self.spin(value * 60)                   # 1 RPM = 60 (1/10°)/s
+        elif cmd in ("L", "H", "RESET"):
+            self.move(self.position(), 0)
+
+        replies = {
+            "Q":   lambda: 4 if self.speed() else 6,    # travelling / holding
+            "QD":  lambda: round(self.position()),
+            "QWD": lambda: round(self.speed()),
+            "QWR": lambda: round(self.speed() / 60),
+            "QV":  lambda: 11900,
+            "QC":  lambda: 120 if self.speed() else 20,
+            "QT":  lambda: 321,
+            "QID": lambda: self.id,
+        }
+        if cmd in replies:
+            return b"*%d%s%d\r" % (self.id, cmd.encode(), replies[cmd]())
+        return b""
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Emulate LSS servos on a pseudo-terminal")
+    parser.add_argument("ids", type=int, nargs="+")
+    parser.add_argument("--max-speed", type=float, default=1800.0, help="in (1/10 deg)/s")
+    parser.add_argument("--delay-us", type=int, default=0, help="delay before each reply")
+    parser.add_argument("--echo", action="store_true", help="single-wire bus, echo what is sent")
+    parser.add_argument("--load", action="append", default=[], metavar="ID=RATIO",
+                        help="wheel speed reached by a servo, per unit commanded (default 1)")
+    args = parser.parse_args()
+
+    loads  = {int(servo_id): float(ratio) for servo_id, ratio in (load.split("=") for load in args.load)}
+    servos = {servo_id: Servo(servo_id, args.max_speed, loads.get(servo_id, 1.0)) for servo_id in args.ids}
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    print(os.ttyname(slave), flush=True)
+
+    pending = b""
+    while True:
+        select.select([master], [], [])
+        received = os.read(master, 4096)
+        pending += received
+        if args.echo:
+            os.write(master, received)
+        while b"\r" in pending:
+            end             = pending.index(b"\r") + 1
+            frame, pending  = pending[:end], pending[end:]
+            match           = FRAME.fullmatch(frame)
+            if match is None:
+                continue
+
+            servo_id = int(match.group(1))
+            cmd      = match.group(2).decode()
+            value    = int(match.group(3)) if match.group(3) else None
+            params   = {name.decode(): int(number)
+                        for name, number in re.findall(rb"([A-Z]+)(-?\d+)", match.group(4))}
+
+            # On a single wire, a reply can't start while the master is still sending
+            collided = args.echo and len(pending) > 0
+
+            targets = servos.values() if servo_id == 254 else [servos.get(servo_id)]
+            for servo in filter(None, targets):
+                reply = servo.handle(cmd, value, params)
+                if reply and servo_id != 254 and not collided:
+                    if args.delay_us:
+                        time.sleep(args.delay_us / 1e6)
+                    os.write(master, reply)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,151 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    CPU cost of sending a command through the C API (snprintf) and through LSS.hpp
+ *                  (frames built at compile time, values encoded by hand).
+ *                  LSS.c is built for Linux, but linked against a null UART defined here instead of
+ *                  LSS_Linux.c: frames are counted and dropped, so only the library's own work is
+ *                  timed, without system calls. Prints ns (and TSC cycles on x86) per command.
+ *
+ *  Build (from the repository root):
+ *      cc -O2 -DLSS_PLATFORM_LINUX -I. -c LSS.c
+ *      c++ -O2 -std=c++17 -DLSS_PLATFORM_LINUX -I. tools/lss_frames_bench.cpp LSS.o -o lss_frames_bench
+ *
+ *  Usage:
+ *      ./lss_frames_bench [COMMANDS]
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()      (__rdtsc())
+#else
+#define BENCH_CYCLES()      (0ULL)
+#endif
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define BENCH_ID            (5)
+#define BENCH_COMMANDS      (1000000)
+
+
+/*************************************************************************************************/
+/* Private variables --------------------------------------------------------------------------- */
+static uint64_t sentBytes;
+
+
+/*************************************************************************************************/
+/* Null UART ----------------------------------------------------------------------------------- */
+extern "C"
+{
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef* huart)
+{
+    huart->gState  = HAL_UART_STATE_READY;
+    huart->RxState = HAL_UART_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef*, const uint8_t*, uint16_t size, uint32_t)
+{
+    sentBytes += size;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size)
+{
+    return HAL_UART_Transmit(huart, data, size, 0);
+}
+
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef*, uint8_t*, uint16_t, uint32_t) { return HAL_TIMEOUT; }
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef*, uint8_t*, uint16_t)        { return HAL_BUSY; }
+HAL_StatusTypeDef HAL_UART_AbortReceive_IT(UART_HandleTypeDef*)                       { return HAL_OK; }
+HAL_StatusTypeDef HAL_UART_AbortTransmit(UART_HandleTypeDef*)                         { return HAL_OK; }
+HAL_StatusTypeDef HAL_HalfDuplex_EnableTransmitter(UART_HandleTypeDef*)               { return HAL_OK; }
+HAL_StatusTypeDef HAL_HalfDuplex_EnableReceiver(UART_HandleTypeDef*)                  { return HAL_OK; }
+
+uint32_t LSS_linux_micros(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+uint32_t HAL_GetTick(void)                              { return LSS_linux_micros() / 1000; }
+uint16_t LSS_linux_poll_rx(UART_HandleTypeDef*, uint32_t) { return 0; }
+void     LSS_linux_sleep(UART_HandleTypeDef*, uint32_t)   {}
+void     error_handler(void)                            { abort(); }
+}
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+struct Cost
+{
+    double ns;
+    double cycles;
+};
+
+// Cost per command of send(i), for i in [0, count)
+template<typename Send>
+static Cost time_per_command(uint32_t count, Send send)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t cycles = BENCH_CYCLES();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        send(i);
+    }
+    cycles = BENCH_CYCLES() - cycles;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    return {ns / count, double(cycles) / count};
+}
+
+static void report(const char* name, Cost c, Cost cpp)
+{
+    printf("%-10s C %6.1f ns %6.0f cycles   C++ %6.1f ns %6.0f cycles   x%.1f\n",
+           name, c.ns, c.cycles, cpp.ns, cpp.cycles, c.ns / cpp.ns);
+}
+
+
+/*************************************************************************************************/
+/* Main ---------------------------------------------------------------------------------------- */
+int main(int argc, char* argv[])
+{
+    uint32_t count = (argc > 1) ? (uint32_t)atoi(argv[1]) : BENCH_COMMANDS;
+
+    UART_HandleTypeDef huart = {};
+    LSS                servo;
+    LSS_init(&servo, BENCH_ID, &huart, 115200);
+
+    lss::Bus             bus{&huart};
+    lss::Servo<BENCH_ID> typed{bus};
+
+    printf("%u commands each\n", count);
+    report("move + T",
+           time_per_command(count, [&](uint32_t i) { move_t(&servo, i % 1800, 500); }),
+           time_per_command(count, [&](uint32_t i) { typed.move(lss::Angle{int32_t(i % 1800)}, 500); }));
+    report("wheel",
+           time_per_command(count, [&](uint32_t i) { wheel(&servo, int16_t(i % 600) - 300); }),
+           time_per_command(count, [&](uint32_t i) { typed.wheel(lss::AngularSpeed{int32_t(i % 600) - 300}); }));
+    report("hold",
+           time_per_command(count, [&](uint32_t) { hold(&servo); }),
+           time_per_command(count, [&](uint32_t) { typed.hold(); }));
+
+    printf("%llu bytes sent\n", (unsigned long long)sentBytes);
+    return 0;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
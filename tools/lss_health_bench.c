@@ -0,0 +1,151 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Control cycle time while a servo stops answering, on the bus simulator (tools/sim).
+ *                  Each 20 ms cycle reads the position of BENCH_SERVOS servos one at a time, then all of
+ *                  them pipelined (LSS_query_pipelined) and once more through a prebuilt frame
+ *                  (LSS_query_frame). Servo 2 goes silent for BENCH_DOWN_CYCLES cycles, then answers
+ *                  again. Prints the average cycle time before, during and after the outage, with the
+ *                  cycles that waited out a timeout counted apart, and when the health hook saw the servo
+ *                  go down and come back.
+ *                  Build with -DLSS_HEALTH_THRESHOLD=0 to see the same cycles without the health check.
+ *
+ *  Build (from the repository root):
+ *      cc -O2 -Itools/sim -I. tools/lss_health_bench.c tools/sim/lss_sim.c LSS.c -o lss_health_bench
+ *
+ *  Usage:
+ *      ./lss_health_bench
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "lss_sim.h"
+#include "LSS.h"
+
+#include <stdio.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define BENCH_SERVOS        (3)
+#define BENCH_SILENT_ID     (2)
+#define BENCH_BAUD          (115200)
+#define BENCH_CYCLE_MS      (20)
+#define BENCH_UP_CYCLES     (10)    // before the outage
+#define BENCH_DOWN_CYCLES   (50)
+#define BENCH_BACK_CYCLES   (150)   // after it, longer than the slowest probe interval
+#define BENCH_SLOW_US       (50000) // a cycle longer than this waited out a timeout
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+typedef struct {
+    double   sumUs;
+    uint32_t cycles;
+    uint32_t slow;          // cycles over BENCH_SLOW_US (timeouts, failed probes), not in the average
+    uint32_t slowestUs;
+} Phase;
+
+
+/*************************************************************************************************/
+/* Private variables --------------------------------------------------------------------------- */
+static uint32_t downAt;
+static uint32_t upAt;
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+static void health_hook(void* context, LSS* lss, bool up)
+{
+    (void)context;
+    (void)lss;
+    *(up ? &upAt : &downAt) = HAL_GetTick();
+}
+
+static void cycle(LSS servos[], LSS* group[], Phase* phase)
+{
+    int32_t  values[BENCH_SERVOS];
+    uint64_t start = lss_sim_nanos();
+
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        get_position(&servos[i]);
+    }
+    LSS_query_pipelined(group, BENCH_SERVOS, LSS_Query_Position, LSS_QuerySession, values);
+    LSS_query_frame(&servos[BENCH_SILENT_ID - 1], "QD", (const uint8_t*)"#2QD\r", 5);
+
+    uint32_t elapsed = (uint32_t)((lss_sim_nanos() - start) / 1000);
+    if (elapsed > BENCH_SLOW_US)
+    {
+        phase->slow++;
+        phase->slowestUs = (elapsed > phase->slowestUs) ? elapsed : phase->slowestUs;
+    }
+    else
+    {
+        phase->sumUs += elapsed;
+        phase->cycles++;
+    }
+
+    while (lss_sim_nanos() < start + BENCH_CYCLE_MS * 1000000ULL)
+    {
+        HAL_Delay(1);
+    }
+}
+
+static void report(const char* name, const Phase* phase)
+{
+    printf("%-8s %8.0f %8lu %10lu\n", name, phase->cycles ? phase->sumUs / phase->cycles : 0.0,
+           (unsigned long)phase->slow, (unsigned long)phase->slowestUs);
+}
+
+
+/*************************************************************************************************/
+/* Main ---------------------------------------------------------------------------------------- */
+int main(void)
+{
+    UART_HandleTypeDef huart = {0};
+    LSS                servos[BENCH_SERVOS];
+    LSS*               group[BENCH_SERVOS];
+    Phase              before = {0};
+    Phase              down   = {0};
+    Phase              after  = {0};
+
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        lss_sim_add_servo(&huart, i + 1);
+        LSS_init(&servos[i], i + 1, &huart, BENCH_BAUD);
+        group[i] = &servos[i];
+    }
+    LSS_set_health_hook(health_hook, NULL);
+
+    for (uint32_t c = 0; c < BENCH_UP_CYCLES; c++)
+    {
+        cycle(servos, group, &before);
+    }
+    uint32_t silentAt = HAL_GetTick();
+    lss_sim_set_silent(&huart, BENCH_SILENT_ID, true);
+    for (uint32_t c = 0; c < BENCH_DOWN_CYCLES; c++)
+    {
+        cycle(servos, group, &down);
+    }
+    uint32_t backAt = HAL_GetTick();
+    lss_sim_set_silent(&huart, BENCH_SILENT_ID, false);
+    for (uint32_t c = 0; c < BENCH_BACK_CYCLES; c++)
+    {
+        cycle(servos, group, &after);
+    }
+
+    printf("%d servos, %d ms cycles, servo %d silent for %d cycles\n", BENCH_SERVOS, BENCH_CYCLE_MS,
+           BENCH_SILENT_ID, BENCH_DOWN_CYCLES);
+    printf("phase    avg (us)     slow   slowest (us)\n");
+    report("before", &before);
+    report("down", &down);
+    report("after", &after);
+    printf("marked down %ld ms after going silent, up %ld ms after answering again\n",
+           downAt ? (long)(downAt - silentAt) : -1L, upAt ? (long)(upAt - backAt) : -1L);
+    return 0;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,152 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Host benchmark of LSS_Kinematics: forward and inverse kinematics solves per second
+ *                  for a 6-DOF arm (full pose, one target per lane) and an 18-DOF hexapod (6 legs of
+ *                  3 joints, position only). No servo is needed.
+ *
+ *  Build (from the repository root):
+ *      cc -O3 -march=native -DLSS_PLATFORM_LINUX -I. tools/lss_kinematics_bench.c LSS_Kinematics.c \
+ *         LSS_Units.c LSS.c LSS_Linux.c -lm -lpthread -o lss_kinematics_bench
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS_Kinematics.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define BENCH_SECONDS   (1.0)
+#define PI_F            (3.14159265f)
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static float random_angle(float span)
+{
+    return ((float)rand() / RAND_MAX - 0.5f) * span;
+}
+
+// Solve random reachable targets (forward kinematics of random angles) from a nearby start
+static void bench(const char* name, const LSS_Chain* chain, float span, float perturbation)
+{
+    enum { SETS = 64 };
+    static LSS_Lanes targets[SETS][LSS_KINEMATICS_POSE_SIZE];
+    static LSS_Lanes starts [SETS][LSS_KINEMATICS_MAX_JOINTS];
+
+    for (int s = 0; s < SETS; s++)
+    {
+        LSS_Lanes q[LSS_KINEMATICS_MAX_JOINTS];
+        for (int j = 0; j < chain->joints; j++)
+        {
+            for (int l = 0; l < LSS_KINEMATICS_LANES; l++)
+            {
+                q[j][l]         = random_angle(span);
+                starts[s][j][l] = q[j][l] + random_angle(perturbation);
+            }
+        }
+        LSS_chain_forward(chain, q, targets[s]);
+    }
+
+    // Forward
+    long   count = 0;
+    double start = now();
+    while (now() - start < BENCH_SECONDS)
+    {
+        for (int s = 0; s < SETS; s++)
+        {
+            LSS_Lanes pose[LSS_KINEMATICS_POSE_SIZE];
+            LSS_chain_forward(chain, starts[s], pose);
+        }
+        count += SETS;
+    }
+    double forward = count / (now() - start);
+
+    // Inverse
+    long converged = 0;
+    count          = 0;
+    start          = now();
+    while (now() - start < BENCH_SECONDS)
+    {
+        for (int s = 0; s < SETS; s++)
+        {
+            LSS_Lanes q[LSS_KINEMATICS_MAX_JOINTS];
+            memcpy(q, starts[s], sizeof(q));
+            converged += __builtin_popcount(LSS_chain_inverse(chain, targets[s], q));
+        }
+        count += SETS;
+    }
+    double inverse = count / (now() - start);
+
+    // A call solves every lane: the whole hexapod, or as many arm targets as there are lanes
+    printf("%-26s FK %9.0f calls/s %10.0f chains/s | IK %8.0f calls/s %9.0f chains/s, %5.1f%% converged\n",
+           name, forward, forward * chain->lanes, inverse, inverse * chain->lanes,
+           100.0 * converged / ((double)count * chain->lanes));
+}
+
+
+/*************************************************************************************************/
+/* Main ---------------------------------------------------------------------------------------- */
+int main(void)
+{
+    static LSS_Chain arm;
+    static LSS_Chain hexapod;
+    srand(1);
+
+    // 6-DOF arm (PUMA 560 geometry, mm), one target pose per lane
+    static const float dh[6][4] = {
+        {0.0f,    PI_F / 2, 0.0f,   0.0f},
+        {431.8f,  0.0f,     0.0f,   0.0f},
+        {20.3f,  -PI_F / 2, 150.0f, 0.0f},
+        {0.0f,    PI_F / 2, 431.8f, 0.0f},
+        {0.0f,   -PI_F / 2, 0.0f,   0.0f},
+        {0.0f,    0.0f,     56.5f,  0.0f},
+    };
+    LSS_chain_init(&arm, 6, LSS_KINEMATICS_LANES);
+    arm.orientation = true;
+    for (uint8_t l = 0; l < LSS_KINEMATICS_LANES; l++)
+    {
+        for (uint8_t j = 0; j < 6; j++)
+        {
+            LSS_chain_set_joint(&arm, l, j, NULL, dh[j][0], dh[j][1], dh[j][2], dh[j][3]);
+        }
+    }
+
+    // Hexapod: 6 legs (coxa, femur, tibia, mm) around a round body, one leg per lane
+    LSS_chain_init(&hexapod, 3, 6);
+    for (uint8_t l = 0; l < 6; l++)
+    {
+        float yaw           = l * PI_F / 3;
+        hexapod.base[0][l]  = cosf(yaw);
+        hexapod.base[1][l]  = -sinf(yaw);
+        hexapod.base[3][l]  = 80.0f * cosf(yaw);
+        hexapod.base[4][l]  = sinf(yaw);
+        hexapod.base[5][l]  = cosf(yaw);
+        hexapod.base[7][l]  = 80.0f * sinf(yaw);
+        LSS_chain_set_joint(&hexapod, l, 0, NULL, 30.0f,  PI_F / 2, 0.0f, 0.0f);
+        LSS_chain_set_joint(&hexapod, l, 1, NULL, 80.0f,  0.0f,     0.0f, 0.0f);
+        LSS_chain_set_joint(&hexapod, l, 2, NULL, 120.0f, 0.0f,     0.0f, 0.0f);
+    }
+
+    bench("6-DOF arm, full pose",     &arm,     PI_F,     0.3f);
+    bench("18-DOF hexapod, position", &hexapod, PI_F / 2, 0.3f);
+    return 0;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
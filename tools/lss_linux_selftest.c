@@ -0,0 +1,166 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    End-to-end check of the Linux port against tools/lss_fake_servo.py (servos 1 to 3).
+ *                  Sends commands and queries through the public API, single and grouped, and checks
+ *                  the replies against the state the fake servos simulate: positions after moves, wheel
+ *                  speeds, fixed voltage and temperature, timeouts and health of a missing servo.
+ *                  Prints one line per check and exits with the number of failed checks.
+ *                  tools/lss_selftest.sh starts the fake servos and runs it on a full-duplex bus, then
+ *                  on a single-wire one.
+ *
+ *  Build (from the repository root):
+ *      cc -O2 -DLSS_PLATFORM_LINUX -I. tools/lss_linux_selftest.c LSS.c LSS_Linux.c -lm -lpthread \
+ *         -o lss_linux_selftest
+ *
+ *  Usage:
+ *      tools/lss_fake_servo.py 1 2 3 [--echo]
+ *      ./lss_linux_selftest /dev/pts/N [--echo]
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define TEST_SERVOS         (3)
+#define TEST_MISSING_ID     (9)     // not emulated
+#define TEST_BAUD           (115200)
+#define TEST_TOLERANCE      (10)    // 1°
+#define TEST_DEADLINE       (3000)  // ms, 180° at the fake servo's 180°/s, plus margin
+#define TEST_SETTLE_MS      (50)    // a move is within tolerance a little before its end
+#define TEST_FAILURES       (3)     // LSS_HEALTH_THRESHOLD
+#define TEST_VOLTAGE        (11900) // mV, replied by the fake servo
+#define TEST_TEMPERATURE    (321)   // 1/10 °C, replied by the fake servo
+
+
+/*************************************************************************************************/
+/* Private variables --------------------------------------------------------------------------- */
+static int failed;
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+static void check(bool ok, const char* name, long value)
+{
+    printf("%-4s %-40s %ld\n", ok ? "ok" : "FAIL", name, value);
+    failed += ok ? 0 : 1;
+}
+
+static bool near(int32_t value, int32_t expected)
+{
+    return abs(value - expected) <= TEST_TOLERANCE;
+}
+
+
+/*************************************************************************************************/
+/* Main ---------------------------------------------------------------------------------------- */
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s DEVICE [--echo]\n", argv[0]);
+        return 1;
+    }
+
+    UART_HandleTypeDef huart = {.device = argv[1]};
+    LSS                servos[TEST_SERVOS];
+    LSS*               group[TEST_SERVOS];
+    LSS_Result         results[TEST_SERVOS];
+    LSS_WaitResult     reached[TEST_SERVOS];
+    for (uint8_t i = 0; i < TEST_SERVOS; i++)
+    {
+        LSS_init(&servos[i], i + 1, &huart, TEST_BAUD);
+        group[i] = &servos[i];
+    }
+    if (argc > 2 && strcmp(argv[2], "--echo") == 0)
+    {
+        LSS_set_duplex(&huart, LSS_Duplex_Echo);
+    }
+
+    // Single servo: command, query, wait
+    int32_t position = get_position(&servos[0]);
+    check(servos[0].lastCommStatus == LSS_CommStatus_ReadSuccess, "position read", position);
+
+    check(move(&servos[0], 300), "move", 300);
+    LSS_wait_reached(group, 1, TEST_TOLERANCE, TEST_DEADLINE, reached);
+    position = get_position(&servos[0]);
+    check(reached[0] == LSS_Wait_Reached && near(position, 300), "move reached", position);
+
+    check(move_t(&servos[0], -300, 500), "move with T", -300);
+    LSS_Status status = get_status(&servos[0]);
+    check(status == LSS_StatusTravelling, "status while moving", status);
+    LSS_wait_reached(group, 1, TEST_TOLERANCE, TEST_DEADLINE, reached);
+    HAL_Delay(TEST_SETTLE_MS);
+    status = get_status(&servos[0]);
+    check(status == LSS_StatusHolding, "status once reached", status);
+
+    uint16_t voltage = get_voltage(&servos[1]);
+    check(voltage == TEST_VOLTAGE, "voltage", voltage);
+    uint16_t temperature = get_temperature(&servos[2]);
+    check(temperature == TEST_TEMPERATURE, "temperature", temperature);
+
+    LSS_Result result = LSS_query(&servos[1], LSS_Query_Voltage, LSS_QuerySession);
+    check(result.status == LSS_CommStatus_ReadSuccess && result.value == TEST_VOLTAGE, "LSS_query", result.value);
+
+    // Wheel mode
+    check(wheel(&servos[2], 450), "wheel", 450);
+    int16_t speed = get_speed(&servos[2]);
+    check(near(speed, 450), "wheel speed", speed);
+    check(hold(&servos[2]), "hold", 0);
+    speed = get_speed(&servos[2]);
+    check(servos[2].lastCommStatus == LSS_CommStatus_ReadSuccess && speed == 0, "speed once held", speed);
+
+    // Group: move, wait, read back
+    const int16_t targets[TEST_SERVOS] = {100, -200, 450};
+    check(LSS_move_group(group, TEST_SERVOS, targets, 800), "group move", TEST_SERVOS);
+    bool all = LSS_wait_reached(group, TEST_SERVOS, TEST_TOLERANCE, TEST_DEADLINE, reached);
+    check(all, "group reached", TEST_SERVOS);
+
+    all = LSS_query_results(group, TEST_SERVOS, LSS_Query_Position, LSS_QuerySession, results);
+    uint8_t matched = 0;
+    for (uint8_t i = 0; i < TEST_SERVOS; i++)
+    {
+        matched += (results[i].status == LSS_CommStatus_ReadSuccess && near(results[i].value, targets[i])) ? 1 : 0;
+    }
+    check(all && matched == TEST_SERVOS, "group positions", matched);
+
+    all = LSS_query_results(group, TEST_SERVOS, LSS_Query_Voltage, LSS_QuerySession, results);
+    matched = 0;
+    for (uint8_t i = 0; i < TEST_SERVOS; i++)
+    {
+        matched += (results[i].status == LSS_CommStatus_ReadSuccess && results[i].value == TEST_VOLTAGE) ? 1 : 0;
+    }
+    check(all && matched == TEST_SERVOS, "group voltages", matched);
+
+    // Missing servo: timeouts, then marked down
+    LSS missing;
+    LSS_init(&missing, TEST_MISSING_ID, &huart, TEST_BAUD);
+    uint8_t timeouts = 0;
+    for (uint8_t i = 0; i < TEST_FAILURES; i++)
+    {
+        get_position(&missing);
+        timeouts += (missing.lastCommStatus == LSS_CommStatus_ReadTimeout) ? 1 : 0;
+    }
+    check(timeouts == TEST_FAILURES, "missing servo times out", timeouts);
+    get_position(&missing);
+    check(missing.lastCommStatus == LSS_CommStatus_ServoDown, "missing servo down", missing.lastCommStatus);
+
+    // The bus is still usable afterwards
+    position = get_position(&servos[1]);
+    check(servos[1].lastCommStatus == LSS_CommStatus_ReadSuccess && near(position, targets[1]),
+          "position after timeouts", position);
+
+    printf("%d check(s) failed\n", failed);
+    return failed;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,150 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Control cycle time against the number of buses, on the bus simulator (tools/sim).
+ *                  BENCH_SERVOS servos are spread by LSS_multibus_assign over 1 to 4 buses;
+ *                  each cycle reads every position (LSS_query_results) and sends the next targets
+ *                  (LSS_move_group). Times are simulated, so they follow the baud rate and the number of
+ *                  bytes on each wire, not the host. Prints the cycle time, the cycle rate and the
+ *                  speedup over a single bus, along with the traffic of the busiest bus: bytes on its
+ *                  wires, replies that had to wait for the previous one to end (pipelined replies
+ *                  queue up in the simulator) and bytes lost.
+ *
+ *  Build (from the repository root):
+ *      cc -O2 -Itools/sim -I. tools/lss_multibus_bench.c tools/sim/lss_sim.c LSS.c -o lss_multibus_bench
+ *
+ *  Usage:
+ *      ./lss_multibus_bench [MAX_BUSES [BAUD]]
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "lss_sim.h"
+#include "LSS.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define BENCH_SERVOS        (16)
+#define BENCH_MAX_BUSES     (4)
+#define BENCH_CYCLES        (200)
+#define BENCH_BAUD          (115200)
+#define BENCH_TIMEOUT       (100)           // ms, same as LSS_init
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+
+// Simulated µs per cycle on busCount buses, -1 if a cycle failed
+static double run(uint8_t busCount, uint32_t baud, LSS_SimStats* busiest)
+{
+    UART_HandleTypeDef huarts[LSS_MAX_BUSES] = {0};
+    UART_HandleTypeDef* handles[LSS_MAX_BUSES];
+    LSS_MultiBus        bus;
+    LSS                 servos[BENCH_SERVOS];
+    LSS*                group[BENCH_SERVOS];
+    LSS_Result          results[BENCH_SERVOS];
+    int16_t             targets[BENCH_SERVOS];
+
+    lss_sim_reset();
+    for (uint8_t b = 0; b < busCount; b++)
+    {
+        handles[b] = &huarts[b];
+    }
+    LSS_multibus_init(&bus, handles, busCount);
+
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        group[i] = &servos[i];
+        LSS_init_handle(&servos[i], i + 1, NULL, BENCH_TIMEOUT);
+    }
+    LSS_multibus_assign(&bus, group, BENCH_SERVOS, NULL);
+
+    // The first servo of each bus brings its UART up
+    bool up[LSS_MAX_BUSES] = {false};
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        uint8_t b = (uint8_t)(servos[i].huart - huarts);
+        lss_sim_add_servo(servos[i].huart, servos[i].servoID);
+        if (!up[b])
+        {
+            LSS_init(&servos[i], servos[i].servoID, servos[i].huart, baud);
+            up[b] = true;
+        }
+    }
+
+    uint64_t start = lss_sim_nanos();
+    for (uint32_t cycle = 0; cycle < BENCH_CYCLES; cycle++)
+    {
+        if (!LSS_query_results(group, BENCH_SERVOS, LSS_Query_Position, LSS_QuerySession, results))
+        {
+            return -1;
+        }
+        for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+        {
+            targets[i] = (int16_t)(results[i].value + ((cycle % 2 == 0) ? 10 : -10));
+        }
+        if (!LSS_move_group(group, BENCH_SERVOS, targets, 0))
+        {
+            return -1;
+        }
+    }
+    uint64_t elapsed = lss_sim_nanos() - start;
+
+    busiest->busyNs = 0;
+    for (uint8_t b = 0; b < busCount; b++)
+    {
+        LSS_SimStats stats;
+        lss_sim_stats(&huarts[b], &stats);
+        if (stats.busyNs >= busiest->busyNs)
+        {
+            *busiest = stats;
+        }
+    }
+    return elapsed / 1000.0 / BENCH_CYCLES;
+}
+
+
+/*************************************************************************************************/
+/* Main ---------------------------------------------------------------------------------------- */
+int main(int argc, char* argv[])
+{
+    uint8_t  maxBuses = (argc > 1) ? (uint8_t)atoi(argv[1]) : BENCH_MAX_BUSES;
+    uint32_t baud     = (argc > 2) ? (uint32_t)atoi(argv[2]) : BENCH_BAUD;
+    if (maxBuses < 1 || maxBuses > LSS_MAX_BUSES || maxBuses > LSS_SIM_BUSES)
+    {
+        fprintf(stderr, "1 to %d buses\n", (LSS_MAX_BUSES < LSS_SIM_BUSES) ? LSS_MAX_BUSES : LSS_SIM_BUSES);
+        return 1;
+    }
+
+    printf("%d servos, %lu baud, query positions + move group, %d cycles\n",
+           BENCH_SERVOS, (unsigned long)baud, BENCH_CYCLES);
+    printf("buses   cycle (us)   cycles/s   speedup   bytes/cycle   waits/cycle   overruns\n");
+
+    double single = 0;
+    for (uint8_t busCount = 1; busCount <= maxBuses; busCount++)
+    {
+        LSS_SimStats busiest;
+        double       cycle = run(busCount, baud, &busiest);
+        if (cycle < 0)
+        {
+            printf("%5u   failed\n", busCount);
+            continue;
+        }
+        if (busCount == 1)
+        {
+            single = cycle;
+        }
+        printf("%5u   %10.0f   %8.0f   x%6.2f   %11.1f   %11.1f   %8lu\n", busCount, cycle, 1e6 / cycle,
+               single / cycle, (double)(busiest.txBytes + busiest.rxBytes) / BENCH_CYCLES,
+               (double)busiest.collisions / BENCH_CYCLES, (unsigned long)busiest.overruns);
+    }
+    return 0;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
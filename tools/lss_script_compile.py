@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""
+Compile a keyframe description into an LSS motion script image (see LSS_Script.h).
+
+Input is JSON:
+    {
+        "keyframes": [
+            {"time": 0,   "t": 500, "moves": {"1": 0,   "2": 450}},
+            {"time": 500, "t": 500, "moves": {"1": 900, "2": [0, 250]}}
+        ]
+    }
+"time" is in ms from the start of the script, "t" is the default T parameter of the keyframe
+(omit or 0 for none). Each move is a position in 1/10°, or [position, T] to override T.
+
+Usage:
+    lss_script_compile.py gait.json -o gait.c --name gait_script
+    lss_script_compile.py gait.json -o gait.bin --format bin
+"""
+import argparse
+import json
+import struct
+import sys
+
+MAGIC   = b"LSSS"
+VERSION = 1
+
+
+def build_frames(keyframe):
+    default_t = int(keyframe.get("t", 0))
+    frames    = bytearray()
+
+    for servo_id, move in sorted(keyframe["moves"].items(), key=lambda item: int(item[0])):
+        position, t = (move[0], move[1]) if isinstance(move, list) else (move, default_t)
+        frame = "#%d" % int(servo_id) + "D%d" % int(position)
+        if int(t) > 0:
+            frame += "T%d" % int(t)
+        frames += (frame + "\r").encode("ascii")
+
+    return frames
+
+
+def compile_script(description):
+    keyframes = sorted(description["keyframes"], key=lambda keyframe: keyframe["time"])
+    image     = bytearray(MAGIC + struct.pack("<BBH", VERSION, 0, len(keyframes)))
+
+    for keyframe in keyframes:
+        frames = build_frames(keyframe)
+        if len(frames) > 0xFFFF:
+            sys.exit("keyframe at %d ms is too large" % keyframe["time"])
+        image += struct.pack("<IH", int(keyframe["time"]), len(frames)) + frames
+
+    return bytes(image)
+
+
+def to_c_source(image, name):
+    lines = ["/* Generated by lss_script_compile.py, do not edit */",
+             "#include <stdint.h>",
+             "",
+             "const uint32_t %s_size = %d;" % (name, len(image)),
+             "const uint8_t  %s[] = {" % name]
+    for i in range(0, len(image), 16):
+        lines.append("    " + ", ".join("0x%02X" % b for b in image[i:i + 16]) + ",")
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compile LSS keyframes into a motion script image")
+    parser.add_argument("input")
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("--format", choices=("c", "bin"), default="c")
+    parser.add_argument("--name", default="lss_script")
+    args = parser.parse_args()
+
+    with open(args.input) as file:
+        image = compile_script(json.load(file))
+
+    if args.format == "bin":
+        with open(args.output, "wb") as file:
+            file.write(image)
+    else:
+        with open(args.output, "w") as file:
+            file.write(to_c_source(image, args.name))
+
+
+if __name__ == "__main__":
+    main()
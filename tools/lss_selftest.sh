@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+#  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+#  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+#
+#  Description:    Builds tools/lss_linux_selftest.c and runs it against tools/lss_fake_servo.py, on a
+#                  full-duplex bus then on a single-wire one (--echo). Exits non-zero if the build or
+#                  any check fails.
+#
+#  Usage (from the repository root):
+#      tools/lss_selftest.sh
+#
+set -u
+
+CC=${CC:-cc}
+WORK=$(mktemp -d)
+SERVO=""
+trap '[ -n "$SERVO" ] && kill "$SERVO" 2>/dev/null; rm -rf "$WORK"' EXIT
+
+$CC -O2 -DLSS_PLATFORM_LINUX -I. tools/lss_linux_selftest.c LSS.c LSS_Linux.c -lm -lpthread \
+    -o "$WORK/lss_linux_selftest" || exit 1
+
+status=0
+for mode in "" "--echo"; do
+    python3 tools/lss_fake_servo.py 1 2 3 $mode > "$WORK/pty" &
+    SERVO=$!
+    while [ ! -s "$WORK/pty" ]; do
+        kill -0 "$SERVO" 2>/dev/null || exit 1
+        sleep 0.1
+    done
+
+    echo "== fake servos on $(cat "$WORK/pty") ${mode:-(full duplex)}"
+    "$WORK/lss_linux_selftest" "$(cat "$WORK/pty")" $mode || status=1
+
+    kill "$SERVO"
+    wait "$SERVO" 2>/dev/null
+    SERVO=""
+    rm -f "$WORK/pty"
+done
+
+exit $status
@@ -0,0 +1,167 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Latency benchmark of the shared servo table (LSS_Shm / LSS_ShmReader).
+ *                  A writer process publishes positions for 18 servos through the reply hook as fast
+ *                  as it can (or every --period µs), while the reader process measures the cost of a
+ *                  snapshot, the time from a write to the reader seeing it, and checks every snapshot
+ *                  for torn reads. No servo is needed.
+ *
+ *  Build (from the repository root):
+ *      cc -O2 -DLSS_PLATFORM_LINUX -I. tools/lss_shm_bench.c LSS_Shm.c -lrt -o lss_shm_bench
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#define _GNU_SOURCE         // sched_setaffinity
+
+#include "LSS_Shm.h"
+
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define BENCH_NAME      ("/lss_shm_bench")
+#define BENCH_SERVOS    (18)
+#define BENCH_SAMPLES   (200000)
+#define BENCH_VISIBLE   (20000)
+
+
+/*************************************************************************************************/
+/* Private variables --------------------------------------------------------------------------- */
+static bool singleCore;     // writer and reader take turns, spinning would only burn the time slice
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+static uint32_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+static void pin(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+static int compare(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Positions carry the time they were written at (ns, wrapping), to measure how long they take to show
+static void writer(uint32_t period)
+{
+    static LSS_Shm shm;
+    pin(0);
+    if (!LSS_shm_create(&shm, BENCH_NAME))
+    {
+        exit(1);
+    }
+    while (true)
+    {
+        for (uint8_t id = 1; id <= BENCH_SERVOS; id++)
+        {
+            LSS_shm_reply_hook(&shm, id, "QD", (int32_t)now_ns(), 0);
+        }
+        for (uint32_t start = now_ns(); now_ns() - start < period;)
+        {
+        }
+        if (singleCore)
+        {
+            sched_yield();
+        }
+    }
+}
+
+static void report(const char* name, uint32_t samples[], uint32_t count)
+{
+    qsort(samples, count, sizeof(uint32_t), compare);
+    printf("  %-22s median %6u ns  p99 %6u ns  p99.9 %6u ns  max %7u ns\n", name, samples[count / 2],
+           samples[count * 99 / 100], samples[count * 999 / 1000], samples[count - 1]);
+}
+
+static void reader(void)
+{
+    static uint32_t readCost[BENCH_SAMPLES];
+    static uint32_t visible [BENCH_VISIBLE];
+
+    LSS_ShmReader shm;
+    LSS_ShmState  state;
+    pin(1);
+    while (!LSS_shm_attach(&shm, BENCH_NAME) || !LSS_shm_read(&shm, BENCH_SERVOS, &state))
+    {
+        sched_yield();
+    }
+
+    uint32_t torn = 0;
+    for (uint32_t i = 0; i < BENCH_SAMPLES; i++)
+    {
+        uint8_t  id    = 1 + i % BENCH_SERVOS;
+        uint32_t start = now_ns();
+        LSS_shm_read(&shm, id, &state);
+        readCost[i] = now_ns() - start;
+
+        // A snapshot is whole when the position and its stamp come from the same write
+        torn += (state.stamps[LSS_Shm_Position] != state.updated || state.servoID != id);
+    }
+
+    for (uint32_t i = 0; i < BENCH_VISIBLE; i++)
+    {
+        uint32_t sequence = LSS_shm_sequence(&shm, 1);
+        while (LSS_shm_sequence(&shm, 1) == sequence)
+        {
+            if (singleCore)
+            {
+                sched_yield();
+            }
+        }
+        LSS_shm_read(&shm, 1, &state);
+        visible[i] = now_ns() - (uint32_t)state.values[LSS_Shm_Position];
+    }
+
+    report("snapshot (18 servos)", readCost, BENCH_SAMPLES);
+    report("write to visible", visible, BENCH_VISIBLE);
+    printf("  torn snapshots: %u of %u\n", torn, BENCH_SAMPLES);
+    LSS_shm_detach(&shm);
+}
+
+
+/*************************************************************************************************/
+/* Main ---------------------------------------------------------------------------------------- */
+int main(int argc, char* argv[])
+{
+    uint32_t period = (argc > 2 && strcmp(argv[1], "--period") == 0) ? (uint32_t)atoi(argv[2]) * 1000 : 0;
+
+    singleCore = (sysconf(_SC_NPROCESSORS_ONLN) < 2);
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        writer(period);
+    }
+
+    printf("writer publishing %d servos every %u µs%s\n", BENCH_SERVOS, period / 1000,
+           singleCore ? " (single core: writer and reader take turns)" : "");
+    reader();
+
+    kill(child, SIGTERM);
+    waitpid(child, NULL, 0);
+    shm_unlink(BENCH_NAME);
+    return 0;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,184 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Host benchmark of LSS_Telemetry: compression ratio, encode cost per sample and hours
+ *                  of history per MiB of ring, for servos logging position and current at 50 Hz, voltage
+ *                  and temperature at 1 Hz. One hour of synthetic telemetry (smooth motion, noisy current,
+ *                  drifting voltage and temperature) goes through an 8 MiB ring, more than 65535 blocks,
+ *                  so it wraps. No servo is needed.
+ *                  Runs with LSS_TELEMETRY_SERVOS servos, then with BENCH_EXTRA_SERVOS more, which makes
+ *                  blocks close early. Servo 1 stops reporting halfway: its last block must still be
+ *                  completed within LSS_TELEMETRY_KEYFRAME_INTERVAL, and no other servo may lose samples.
+ *
+ *  Build (from the repository root):
+ *      cc -O2 -I. tools/lss_telemetry_bench.c LSS_Telemetry.c -lm -o lss_telemetry_bench
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS_Telemetry.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define BENCH_EXTRA_SERVOS  (8)
+#define BENCH_MAX_SERVOS    (LSS_TELEMETRY_SERVOS + BENCH_EXTRA_SERVOS)
+#define BENCH_SECONDS       (3600)
+#define BENCH_FAST_MS       (20)            // position and current, 50 Hz
+#define BENCH_SLOW_MS       (1000)          // voltage and temperature, 1 Hz
+#define BENCH_RING_SIZE     (8u << 20)
+#define BENCH_RAW_SAMPLE    (10)            // uncompressed: tick (4), servo ID (1), channel (1), value (4)
+#define PI_F                (3.14159265f)
+
+
+/*************************************************************************************************/
+/* Private variables --------------------------------------------------------------------------- */
+static uint64_t payloadBytes;
+static uint64_t blockBytes;
+static uint32_t currentTick;
+static uint32_t lastBlockTick[BENCH_MAX_SERVOS + 1];    // by servo ID
+static uint32_t recorded[BENCH_MAX_SERVOS + 1];
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void block_done(void* context, const uint8_t* block, uint16_t size)
+{
+    (void)context;
+    payloadBytes              += LSS_TELEMETRY_HEADER_SIZE + block[2];
+    blockBytes                += size;
+    lastBlockTick[block[1]]    = currentTick;
+}
+
+static int32_t noise(int32_t amplitude)
+{
+    return rand() % (2 * amplitude + 1) - amplitude;
+}
+
+
+static void record(LSS_TelemetryLog* log, uint8_t id, LSS_TelemetryChannel channel, uint32_t tick,
+                   int32_t value)
+{
+    recorded[id] += LSS_telemetry_record(log, id, channel, tick, value) ? 1 : 0;
+}
+
+// One hour of telemetry from servoCount servos, servo 1 stops halfway. Returns false on a setup error.
+static bool run(uint8_t servoCount, uint8_t* storage)
+{
+    static LSS_TelemetryLog log;
+    if (!LSS_telemetry_init(&log, storage, BENCH_RING_SIZE))
+    {
+        return false;
+    }
+    log.blockDone = block_done;
+    payloadBytes  = 0;
+    blockBytes    = 0;
+    memset(lastBlockTick, 0, sizeof(lastBlockTick));
+    memset(recorded, 0, sizeof(recorded));
+
+    // Samples are generated first, so only the encoder is timed
+    uint32_t samplesPerStep = servoCount * 2;
+    int32_t* values         = malloc(samplesPerStep * sizeof(int32_t));
+    double   encodeTime     = 0.0;
+    uint32_t stopTick       = BENCH_SECONDS * 1000u / 2;
+
+    srand(1);
+    for (uint32_t tick = 0; tick < BENCH_SECONDS * 1000u; tick += BENCH_FAST_MS)
+    {
+        float t = tick * 1e-3f;
+        for (uint8_t s = 0; s < servoCount; s++)
+        {
+            float phase   = s * 0.7f;
+            float speed   = cosf(2.0f * PI_F * t / 4.0f + phase);
+            values[2 * s]     = (int32_t)(900.0f * sinf(2.0f * PI_F * t / 4.0f + phase)) + noise(1);
+            values[2 * s + 1] = 150 + (int32_t)(120.0f * fabsf(speed)) + noise(8);
+        }
+
+        currentTick  = tick;
+        double start = now();
+        for (uint8_t s = (tick < stopTick) ? 0 : 1; s < servoCount; s++)
+        {
+            record(&log, s + 1, LSS_Telemetry_Position, tick, values[2 * s]);
+            record(&log, s + 1, LSS_Telemetry_Current, tick, values[2 * s + 1]);
+            if (tick % BENCH_SLOW_MS == 0)
+            {
+                record(&log, s + 1, LSS_Telemetry_Voltage, tick, 11900 - tick / 100000 + noise(10));
+                record(&log, s + 1, LSS_Telemetry_Temperature, tick, 300 + tick / 60000);
+            }
+        }
+        encodeTime += now() - start;
+
+    }
+
+    // Servo 1's last block must have been completed without a flush
+    bool stoppedOpen = false;
+    for (uint8_t i = 0; i < LSS_TELEMETRY_SERVOS; i++)
+    {
+        stoppedOpen |= (log.servos[i].open && log.servos[i].servoID == 1);
+    }
+    LSS_telemetry_flush(&log);
+
+    uint32_t fewest = UINT32_MAX;
+    for (uint8_t id = 2; id <= servoCount; id++)
+    {
+        fewest = (recorded[id] < fewest) ? recorded[id] : fewest;
+    }
+
+    double bytesPerSample = (double)blockBytes / log.samples;
+    double bytesPerHour   = (double)blockBytes * 3600.0 / BENCH_SECONDS;
+    printf("%u servos (LSS_TELEMETRY_SERVOS = %u): %u samples in %u s, %u dropped\n", servoCount,
+           LSS_TELEMETRY_SERVOS, log.samples, BENCH_SECONDS, log.dropped);
+    printf("  samples per servo  %u at least (servo 1 stopped at %u s)\n", fewest, stopTick / 1000);
+    if (!stoppedOpen)
+    {
+        printf("  stopped servo      last block completed %u ms after its last sample\n",
+               lastBlockTick[1] - (stopTick - BENCH_FAST_MS));
+    }
+    else
+    {
+        printf("  stopped servo      last block still open at the end\n");
+    }
+    printf("  payload            %.2f bytes/sample\n", (double)payloadBytes / log.samples);
+    printf("  ring space         %.2f bytes/sample (x%.1f against %d-byte raw samples)\n",
+           bytesPerSample, BENCH_RAW_SAMPLE / bytesPerSample, BENCH_RAW_SAMPLE);
+    printf("  encode             %.1f ns/sample\n", encodeTime * 1e9 / log.samples);
+    printf("  history            %.2f h per MiB, %.1f h in this ring\n", (1u << 20) / bytesPerHour,
+           BENCH_RING_SIZE / bytesPerHour);
+
+    free(values);
+    return true;
+}
+
+
+/*************************************************************************************************/
+/* Main ---------------------------------------------------------------------------------------- */
+int main(void)
+{
+    uint8_t* storage = malloc(BENCH_RING_SIZE);
+    printf("ring %u MiB, blocks of %u bytes\n", BENCH_RING_SIZE >> 20, LSS_TELEMETRY_BLOCK_SIZE);
+    if (storage == NULL || !run(LSS_TELEMETRY_SERVOS, storage) || !run(BENCH_MAX_SERVOS, storage))
+    {
+        fprintf(stderr, "ring setup failed\n");
+        return 1;
+    }
+
+    free(storage);
+    return 0;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""
+Decode telemetry blocks written by LSS_Telemetry.c into CSV (tick, servo, channel, value).
+
+The input is either a dump of the whole ring (blocks in slot order, the oldest one anywhere) or a stream of
+blocks as given to the blockDone callback (ex: from a serial port or a file it's appended to). Blocks are
+read as they arrive and sorted by sequence number over a small window, so a stream decodes while it's being
+written. Empty slots and corrupted blocks are skipped.
+
+Usage:
+    lss_telemetry_decode.py ring.bin > telemetry.csv
+    cat /dev/ttyACM0 | lss_telemetry_decode.py - --servo 5 --channel position
+"""
+import argparse
+import heapq
+import struct
+import sys
+
+MAGIC       = ord("T")
+HEADER_SIZE = 8
+CHANNELS    = ("position", "current", "voltage", "temperature")
+
+
+def varint(data, i):
+    value = shift = 0
+    while True:
+        if i >= len(data) or shift > 28:
+            raise ValueError("truncated varint")
+        byte   = data[i]
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        i     += 1
+        if byte < 0x80:
+            return value, i
+
+
+def decode_block(block):
+    """Yield (tick, servo, channel, value) for every record of one block."""
+    servo, payload = block[1], block[2]
+    data           = block[HEADER_SIZE:HEADER_SIZE + payload]
+    tick, i        = varint(data, 0)
+    last           = [0] * len(CHANNELS)
+    while i < len(data):
+        key, i     = varint(data, i)
+        zigzag, i  = varint(data, i)
+        tick      += key >> 2
+        channel    = key & 3
+        last[channel] += (zigzag >> 1) ^ -(zigzag & 1)
+        yield tick & 0xFFFFFFFF, servo, CHANNELS[channel], last[channel]
+
+
+def read_blocks(stream):
+    """Yield (sequence, block) for every valid block, resynchronizing on the magic byte."""
+    pending = b""
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            return
+        pending += chunk
+        while len(pending) >= HEADER_SIZE:
+            size = pending[3]
+            if pending[0] != MAGIC or size <= HEADER_SIZE or pending[2] > size - HEADER_SIZE:
+                pending = pending[1:]
+                continue
+            if len(pending) < size:
+                break
+            block, pending = pending[:size], pending[size:]
+            yield struct.unpack_from("<I", block, 4)[0], block
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode LSS telemetry blocks into CSV")
+    parser.add_argument("input", help="ring dump or block stream, - for stdin")
+    parser.add_argument("--servo",   type=int, help="only this servo")
+    parser.add_argument("--channel", choices=CHANNELS, help="only this channel")
+    parser.add_argument("--window",  type=int, default=64,
+                        help="blocks held back to put a stream in order (a ring dump is read whole)")
+    args = parser.parse_args()
+
+    stream = sys.stdin.buffer if args.input == "-" else open(args.input, "rb")
+    window = args.window if args.input == "-" else sys.maxsize
+    heap   = []
+    print("tick,servo,channel,value")
+
+    def emit(block):
+        try:
+            for tick, servo, channel, value in decode_block(block):
+                if args.servo in (None, servo) and args.channel in (None, channel):
+                    print("%d,%d,%s,%d" % (tick, servo, channel, value))
+        except ValueError:
+            pass    # partly overwritten or corrupted block
+
+    for sequence, block in read_blocks(stream):
+        heapq.heappush(heap, (sequence, block))
+        if len(heap) > window:
+            emit(heapq.heappop(heap)[1])
+    while heap:
+        emit(heapq.heappop(heap)[1])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""
+Convert a bus trace exported with LSS_trace_export() into Chrome trace JSON (chrome://tracing, Perfetto).
+
+Tx, turnaround and Rx phases are drawn on one track per bus, transactions on one track per servo.
+Commands sent without a query (actions, settings) show up as a Tx phase only.
+When the application marks control cycles with LSS_trace_cycle(), bus utilization and dead time
+(time with no byte on any wire) are reported per cycle on stderr.
+
+Usage:
+    lss_trace_to_chrome.py trace.bin -o trace.json
+"""
+import argparse
+import json
+import struct
+import sys
+
+MAGIC        = b"LSST"
+HEADER_SIZE  = 16
+EVENT_SIZE   = {1: 12, 2: 13}   # version 1 has no bus byte
+GROUP_ID     = 255
+BUS_TRACK    = 1000             # + bus index
+
+PHASES = {0: "transaction", 1: "tx", 2: "turnaround", 3: "rx", 4: "cycle"}
+
+
+def read_events(data):
+    if data[:4] != MAGIC:
+        sys.exit("not an LSS trace")
+    version      = data[4]
+    clock, count = struct.unpack_from("<II", data, 8)
+    if version not in EVENT_SIZE:
+        sys.exit("unsupported trace version %d" % version)
+    size = EVENT_SIZE[version]
+
+    events = []
+    offset = 0
+    last   = None
+    for i in range(count):
+        start = HEADER_SIZE + i * size
+        timestamp, servo_id, kind = struct.unpack_from("<IBB", data, start)
+        bus = data[start + 6] if version >= 2 else 0
+        tag = data[start + size - 6:start + size]
+
+        # Unwrap the 32 bits cycle counter
+        if last is not None and timestamp < last:
+            offset += 1 << 32
+        last = timestamp
+
+        events.append({
+            "time":  (timestamp + offset) * 1e6 / clock,   # in us
+            "id":    servo_id,
+            "bus":   bus,
+            "phase": PHASES.get(kind & 0x7F, "unknown"),
+            "begin": not (kind & 0x80),
+            "tag":   tag.split(b"\0")[0].decode("ascii", "replace"),
+        })
+    return events
+
+
+def pair_spans(events):
+    """Match begin/end events into spans, unmatched begins are closed by the next transaction end.
+    Spans are matched per bus: a group transmission opens one Tx span on every bus before closing any."""
+    spans  = []
+    open_  = {}
+    cycles = []
+
+    for event in events:
+        key = (event["bus"], event["id"], event["phase"])
+        if event["phase"] == "cycle":
+            cycles.append(event["time"])
+        elif event["begin"]:
+            open_[key] = event
+        elif key in open_:
+            begin = open_.pop(key)
+            spans.append((begin["time"], event["time"], event["bus"], event["id"], event["phase"], event["tag"]))
+        elif event["phase"] == "rx":
+            # Replies collected by pipelined queries only record their end
+            spans.append((event["time"], event["time"], event["bus"], event["id"], "rx", event["tag"]))
+
+        if event["phase"] == "transaction" and not event["begin"]:
+            for phase in ("turnaround", "rx"):
+                begin = open_.pop((event["bus"], event["id"], phase), None)
+                if begin is not None:
+                    spans.append((begin["time"], event["time"], event["bus"], event["id"], phase,
+                                  begin["tag"] + " (failed)"))
+
+    return spans, cycles
+
+
+def to_chrome(spans, cycles):
+    trace = [
+        {"ph": "M", "name": "thread_name", "pid": 1, "tid": BUS_TRACK + bus, "args": {"name": "bus %d" % bus}}
+        for bus in sorted({span[2] for span in spans if span[4] in ("tx", "turnaround", "rx")})
+    ]
+    for begin, end, bus, servo_id, phase, tag in spans:
+        on_bus = phase in ("tx", "turnaround", "rx")
+        trace.append({
+            "ph":   "X",
+            "name": "%s %s" % (phase, tag) if on_bus else tag,
+            "cat":  phase,
+            "pid":  1,
+            "tid":  BUS_TRACK + bus if on_bus else servo_id,
+            "ts":   begin,
+            "dur":  max(end - begin, 0.1),
+            "args": {"servo": "group" if servo_id == GROUP_ID else servo_id},
+        })
+    for time in cycles:
+        trace.append({"ph": "i", "name": "cycle", "s": "g", "pid": 1, "tid": BUS_TRACK, "ts": time})
+    return {"traceEvents": trace, "displayTimeUnit": "ms"}
+
+
+def busy_time(spans, start, end):
+    """Time with bytes on the wire (tx or rx) between start and end, overlaps counted once."""
+    intervals = sorted((max(b, start), min(e, end)) for b, e, _, _, phase, _ in spans
+                       if phase in ("tx", "rx") and e > start and b < end)
+    busy, cursor = 0.0, start
+    for b, e in intervals:
+        b = max(b, cursor)
+        if e > b:
+            busy  += e - b
+            cursor = e
+    return busy
+
+
+def report_cycles(spans, cycles):
+    if len(cycles) < 2:
+        return
+    print("cycle  length(us)  busy(us)  util(%)  dead(us)", file=sys.stderr)
+    for i in range(len(cycles) - 1):
+        length = cycles[i + 1] - cycles[i]
+        busy   = busy_time(spans, cycles[i], cycles[i + 1])
+        print("%5d  %10.1f  %8.1f  %7.1f  %8.1f" % (i, length, busy, 100.0 * busy / length, length - busy),
+              file=sys.stderr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert an LSS bus trace to Chrome trace JSON")
+    parser.add_argument("input")
+    parser.add_argument("-o", "--output", required=True)
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as file:
+        events = read_events(file.read())
+
+    spans, cycles = pair_spans(events)
+    with open(args.output, "w") as file:
+        json.dump(to_chrome(spans, cycles), file)
+    report_cycles(spans, cycles)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,227 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Host benchmark of LSS_Units: conversions per second of the array kernels against the
+ *                  element-by-element loops they replace (kept scalar), for an 18-servo robot and for a
+ *                  long array, and the largest difference between the two. No servo is needed.
+ *
+ *  Build (from the repository root):
+ *      cc -O3 -march=native -DLSS_PLATFORM_LINUX -I. tools/lss_units_bench.c LSS_Units.c \
+ *         -lm -o lss_units_bench
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS_Units.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define BENCH_SECONDS   (0.5)
+#define BENCH_MAX       (4096)
+
+#define SCALAR          __attribute__((noinline, optimize("no-tree-vectorize")))
+
+
+/*************************************************************************************************/
+/* Private variables --------------------------------------------------------------------------- */
+static int32_t raw      [BENCH_MAX];
+static int16_t offsets  [BENCH_MAX];
+static int8_t  gyres    [BENCH_MAX];
+static float   rad      [BENCH_MAX];
+static float   radRef   [BENCH_MAX];
+static LSS_Q16 fixed    [BENCH_MAX];
+static int16_t tenths   [BENCH_MAX];
+static int16_t tenthsRef[BENCH_MAX];
+static int8_t  rpm      [BENCH_MAX];
+static int8_t  rpmRef   [BENCH_MAX];
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// The loops the kernels replace, one servo at a time
+SCALAR static void scalar_position_to_rad(uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        radRef[i] = gyres[i] * (raw[i] - offsets[i]) * (3.14159265f / 1800.0f);
+    }
+}
+
+SCALAR static void scalar_rad_to_position(uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        tenthsRef[i] = (int16_t)(offsets[i] + lroundf(gyres[i] * rad[i] * (1800.0f / 3.14159265f)));
+    }
+}
+
+SCALAR static void scalar_speed_to_rad(uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        radRef[i] = gyres[i] * raw[i] * (3.14159265f / 1800.0f);
+    }
+}
+
+SCALAR static void scalar_rad_to_rpm(uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        rpmRef[i] = (int8_t)lroundf(gyres[i] * rad[i] * (60.0f / (2.0f * 3.14159265f)));
+    }
+}
+
+SCALAR static void scalar_scale(uint16_t n)
+{
+    for (uint16_t i = 0; i < n; i++)
+    {
+        radRef[i] = raw[i] / 1000.0f;
+    }
+}
+
+static void kernel_position_to_rad(uint16_t n)
+{
+    LSS_units_position_to_rad(raw, offsets, gyres, rad, n);
+}
+
+static void kernel_rad_to_position(uint16_t n)
+{
+    LSS_units_rad_to_position(rad, offsets, gyres, tenths, n);
+}
+
+static void kernel_position_to_fixed(uint16_t n)
+{
+    LSS_units_position_to_fixed(raw, offsets, gyres, fixed, n);
+}
+
+static void kernel_fixed_to_position(uint16_t n)
+{
+    LSS_units_fixed_to_position(fixed, offsets, gyres, tenths, n);
+}
+
+static void kernel_speed_to_rad(uint16_t n)
+{
+    LSS_units_speed_to_rad(raw, gyres, rad, n);
+}
+
+static void kernel_rad_to_rpm(uint16_t n)
+{
+    LSS_units_rad_to_rpm(rad, gyres, rpm, n);
+}
+
+static void kernel_scale(uint16_t n)
+{
+    LSS_units_scale(raw, LSS_UNITS_VOLTS_PER_MV, rad, n);
+}
+
+// Millions of values converted per second
+static double rate(void (*convert)(uint16_t), uint16_t n)
+{
+    uint32_t calls = 0;
+    double   start = now(), elapsed;
+    do
+    {
+        for (uint32_t i = 0; i < 1000; i++)
+        {
+            convert(n);
+            __asm__ volatile("" ::: "memory");
+        }
+        calls  += 1000;
+        elapsed = now() - start;
+    } while (elapsed < BENCH_SECONDS);
+
+    return (double)calls * n / elapsed * 1e-6;
+}
+
+static void compare(const char* name, void (*scalar)(uint16_t), void (*kernel)(uint16_t))
+{
+    static const uint16_t sizes[] = {18, BENCH_MAX};
+
+    printf("  %-20s", name);
+    for (uint8_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        uint16_t n = sizes[i];
+        double   s = rate(scalar, n), k = rate(kernel, n);
+        printf("   n=%-4u %7.0f -> %7.0f M/s (x%.1f)", n, s, k, k / s);
+    }
+    printf("\n");
+}
+
+static float max_difference_rad(uint16_t n)
+{
+    float worst = 0.0f;
+    for (uint16_t i = 0; i < n; i++)
+    {
+        worst = fmaxf(worst, fabsf(rad[i] - radRef[i]));
+    }
+    return worst;
+}
+
+static int max_difference_tenths(uint16_t n)
+{
+    int worst = 0;
+    for (uint16_t i = 0; i < n; i++)
+    {
+        worst = abs(tenths[i] - tenthsRef[i]) > worst ? abs(tenths[i] - tenthsRef[i]) : worst;
+    }
+    return worst;
+}
+
+
+/*************************************************************************************************/
+/* Main ---------------------------------------------------------------------------------------- */
+int main(void)
+{
+    srand(1);
+    for (uint16_t i = 0; i < BENCH_MAX; i++)
+    {
+        raw[i]     = rand() % 3601 - 1800;
+        offsets[i] = (int16_t)(rand() % 201 - 100);
+        gyres[i]   = (rand() & 1) ? LSS_GyreClockwise : LSS_GyreCounterClockwise;
+        rad[i]     = (rand() / (float)RAND_MAX - 0.5f) * 6.0f;
+    }
+
+    // Same results as the scalar loops, up to float rounding
+    scalar_position_to_rad(BENCH_MAX);
+    kernel_position_to_rad(BENCH_MAX);
+    printf("position -> rad        max difference %.2e rad\n", max_difference_rad(BENCH_MAX));
+    scalar_rad_to_position(BENCH_MAX);
+    kernel_rad_to_position(BENCH_MAX);
+    printf("rad -> position        max difference %d (1/10°)\n", max_difference_tenths(BENCH_MAX));
+    kernel_position_to_fixed(BENCH_MAX);
+    kernel_fixed_to_position(BENCH_MAX);
+    for (uint16_t i = 0; i < BENCH_MAX; i++)
+    {
+        tenthsRef[i] = (int16_t)raw[i];
+    }
+    printf("position -> Q16 -> position round trip  max difference %d (1/10°)\n\n",
+           max_difference_tenths(BENCH_MAX));
+
+    printf("scalar -> kernel, millions of values per second\n");
+    compare("position -> rad", scalar_position_to_rad, kernel_position_to_rad);
+    compare("rad -> position", scalar_rad_to_position, kernel_rad_to_position);
+    compare("position -> Q16 *", scalar_position_to_rad, kernel_position_to_fixed);
+    compare("Q16 -> position *", scalar_rad_to_position, kernel_fixed_to_position);
+    compare("speed -> rad/s", scalar_speed_to_rad, kernel_speed_to_rad);
+    compare("rad/s -> RPM", scalar_rad_to_rpm, kernel_rad_to_rpm);
+    compare("mV -> V", scalar_scale, kernel_scale);
+    printf("  * against the float loop\n");
+    return 0;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
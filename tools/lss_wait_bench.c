@@ -0,0 +1,156 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    CPU time spent per query under each wait strategy (LSS_WaitBusy, LSS_WaitYield,
+ *                  LSS_WaitSleep and LSS_WaitCondition with its reception thread), on the Linux port.
+ *                  Reads the position of servos 1 to BENCH_SERVOS one at a time, then all of them with
+ *                  a pipelined LSS_query_results, and prints the wall time and the CPU time of the
+ *                  process (reception thread included) per reply, and their ratio: the share of a core
+ *                  the library keeps while it waits. Runs against real servos or
+ *                  tools/lss_fake_servo.py, whose --delay-us option stretches the wait for each reply.
+ *
+ *  Build (from the repository root):
+ *      cc -O2 -DLSS_PLATFORM_LINUX -I. tools/lss_wait_bench.c LSS.c LSS_Linux.c -lm -lpthread \
+ *         -o lss_wait_bench
+ *
+ *  Usage:
+ *      tools/lss_fake_servo.py 1 2 3 4 --delay-us 1000
+ *      ./lss_wait_bench /dev/pts/N [QUERIES]
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "LSS.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define BENCH_SERVOS        (4)
+#define BENCH_QUERIES       (500)   // replies per strategy and mode
+#define BENCH_BAUD          (115200)
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+typedef struct {
+    const char*             name;
+    const LSS_WaitStrategy* strategy;
+    bool                    rxThread;
+} Strategy;
+
+typedef struct {
+    double   wallUs;        // per reply
+    double   cpuUs;         // per reply
+    uint32_t failures;
+} Cost;
+
+
+/*************************************************************************************************/
+/* Private variables --------------------------------------------------------------------------- */
+static const Strategy strategies[] = {
+    {"busy",      &LSS_WaitBusy,      false},
+    {"yield",     &LSS_WaitYield,     false},
+    {"sleep",     &LSS_WaitSleep,     false},
+    {"condition", &LSS_WaitCondition, true},
+};
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+static double seconds(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Position of every servo, one query at a time (pipelined = false) or pipelined
+static Cost run(LSS* group[], uint32_t queries, bool pipelined)
+{
+    LSS_Result results[BENCH_SERVOS];
+    Cost       cost    = {0};
+    uint32_t   replies = 0;
+
+    double wall = seconds(CLOCK_MONOTONIC);
+    double cpu  = seconds(CLOCK_PROCESS_CPUTIME_ID);
+    while (replies < queries)
+    {
+        if (pipelined)
+        {
+            LSS_query_results(group, BENCH_SERVOS, LSS_Query_Position, LSS_QuerySession, results);
+            for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+            {
+                cost.failures += (results[i].status == LSS_CommStatus_ReadSuccess) ? 0 : 1;
+            }
+            replies += BENCH_SERVOS;
+        }
+        else
+        {
+            LSS* servo = group[replies % BENCH_SERVOS];
+            get_position(servo);
+            cost.failures += (servo->lastCommStatus == LSS_CommStatus_ReadSuccess) ? 0 : 1;
+            replies++;
+        }
+    }
+    cost.cpuUs  = (seconds(CLOCK_PROCESS_CPUTIME_ID) - cpu) * 1e6 / replies;
+    cost.wallUs = (seconds(CLOCK_MONOTONIC) - wall) * 1e6 / replies;
+    return cost;
+}
+
+static void report(const char* name, const char* mode, Cost cost)
+{
+    printf("%-10s %-10s %10.1f %10.1f %6.1f%% %9lu\n", name, mode, cost.wallUs, cost.cpuUs,
+           100.0 * cost.cpuUs / cost.wallUs, (unsigned long)cost.failures);
+}
+
+
+/*************************************************************************************************/
+/* Main ---------------------------------------------------------------------------------------- */
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s DEVICE [QUERIES]\n", argv[0]);
+        return 1;
+    }
+    uint32_t queries = (argc > 2) ? (uint32_t)atoi(argv[2]) : BENCH_QUERIES;
+
+    UART_HandleTypeDef huart = {.device = argv[1]};
+    LSS                servos[BENCH_SERVOS];
+    LSS*               group[BENCH_SERVOS];
+    for (uint8_t i = 0; i < BENCH_SERVOS; i++)
+    {
+        LSS_init(&servos[i], i + 1, &huart, BENCH_BAUD);
+        group[i] = &servos[i];
+    }
+
+    printf("%d servos, %lu replies per line\n", BENCH_SERVOS, (unsigned long)queries);
+    printf("strategy   mode        wall (us)   cpu (us)    cpu  failures\n");
+    for (uint8_t s = 0; s < sizeof(strategies) / sizeof(strategies[0]); s++)
+    {
+        if (strategies[s].rxThread && !LSS_linux_start_rx_thread(&huart))
+        {
+            printf("%-10s no reception thread\n", strategies[s].name);
+            continue;
+        }
+        LSS_set_wait_strategy(strategies[s].strategy);
+        run(group, BENCH_SERVOS, false);    // warm up
+
+        report(strategies[s].name, "single", run(group, queries, false));
+        report(strategies[s].name, "pipelined", run(group, queries, true));
+
+        if (strategies[s].rxThread)
+        {
+            LSS_linux_stop_rx_thread(&huart);
+        }
+    }
+    return 0;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
@@ -0,0 +1,99 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Update rate and tracking of LSS_Wheels on a 4-wheel mecanum base (servos 1 to 4),
+ *                  on the bus simulator (tools/sim), at the given baud rate. Drives the base through a
+ *                  few velocities, and prints the updates per second, the worst wheel speed error once
+ *                  settled and the odometry, next to the rate the wire time alone would allow.
+ *                  The simulated wheels carry no load: tools/lss_fake_servo.py and its --load option
+ *                  remain the way to see wheels lag behind.
+ *
+ *  Build (from the repository root):
+ *      cc -O2 -Itools/sim -I. tools/lss_wheels_bench.c LSS_Wheels.c LSS_Units.c tools/sim/lss_sim.c \
+ *         LSS.c -lm -o lss_wheels_bench
+ *
+ *  Usage:
+ *      ./lss_wheels_bench [BAUD]
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "lss_sim.h"
+#include "LSS_Wheels.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define BENCH_WHEELS        (4)
+#define BENCH_BAUD          (500000)
+#define BENCH_STEP_MS       (1500)
+#define BENCH_SETTLE_MS     (1000)  // errors are measured over the rest of each step
+#define BENCH_FRAME_BYTES   (25)    // per wheel and update: #1QWD\r, *1QWD-123\r, #1WD-123\r
+
+
+/*************************************************************************************************/
+/* Main ---------------------------------------------------------------------------------------- */
+int main(int argc, char* argv[])
+{
+    uint32_t baud = (argc > 1) ? (uint32_t)atoi(argv[1]) : BENCH_BAUD;
+
+    static const LSS_WheelPlace places[BENCH_WHEELS] = {LSS_Wheel_FrontLeft, LSS_Wheel_FrontRight,
+                                                        LSS_Wheel_RearLeft, LSS_Wheel_RearRight};
+    static const float velocities[][3] = {
+        {0.20f, 0.00f, 0.0f},   // forward
+        {0.00f, 0.15f, 0.0f},   // sideways
+        {0.10f, 0.00f, 1.0f},   // curve
+    };
+
+    UART_HandleTypeDef huart = {0};
+    static LSS         servos[BENCH_WHEELS];
+    static LSS_Wheels  base;
+
+    LSS_wheels_init(&base, LSS_Drive_Mecanum, 0.04f, 0.12f, 0.10f);
+    for (uint8_t i = 0; i < BENCH_WHEELS; i++)
+    {
+        lss_sim_add_servo(&huart, i + 1);
+        LSS_init(&servos[i], i + 1, &huart, baud);
+        LSS_wheels_add(&base, &servos[i], places[i],
+                       (i % 2 == 0) ? LSS_GyreCounterClockwise : LSS_GyreClockwise);
+    }
+
+    printf("%u wheels, %u baud: wire time alone allows %.0f updates/s\n", BENCH_WHEELS, baud,
+           baud / (10.0 * BENCH_FRAME_BYTES * BENCH_WHEELS));
+
+    for (uint8_t v = 0; v < sizeof(velocities) / sizeof(velocities[0]); v++)
+    {
+        LSS_wheels_set_velocity(&base, velocities[v][0], velocities[v][1], velocities[v][2]);
+
+        uint32_t start = lss_sim_micros(), updates = 0, failures = base.failures;
+        float    worst = 0.0f;
+        while (lss_sim_micros() - start < BENCH_STEP_MS * 1000u)
+        {
+            LSS_wheels_update(&base);
+            updates++;
+            for (uint8_t i = 0; lss_sim_micros() - start > BENCH_SETTLE_MS * 1000u && i < BENCH_WHEELS; i++)
+            {
+                worst = fmaxf(worst, fabsf(base.measured[i] - base.target[i]) / fabsf(base.target[i]));
+            }
+        }
+
+        float odometry[3];
+        LSS_wheels_odometry(&base, odometry);
+        printf("v = (%.2f, %.2f, %.2f): %.0f updates/s, %u failed, settled error %.1f %%, "
+               "odometry (%.3f, %.3f, %.3f)\n",
+               velocities[v][0], velocities[v][1], velocities[v][2], updates * 1000.0 / BENCH_STEP_MS,
+               base.failures - failures, 100.0f * worst, odometry[0], odometry[1], odometry[2]);
+    }
+
+    LSS_wheels_set_velocity(&base, 0.0f, 0.0f, 0.0f);
+    LSS_wheels_update(&base);
+    return 0;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
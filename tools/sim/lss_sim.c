@@ -0,0 +1,819 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Virtual-time simulation of LSS buses, see lss_sim.h.
+ */
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "lss_sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define SIM_LINE_BYTES          (4096)  // bytes in flight on a line
+#define SIM_FRAME_LENGTH        (64)
+#define SIM_DEFAULT_BAUD        (115200)
+#define SIM_DEFAULT_SPEED       (1800)  // (1/10°)/s
+#define SIM_MODEL               ("LSS-ST1")
+#define SIM_NEVER               (UINT64_MAX)
+
+#define NS_PER_US               (1000ULL)
+#define NS_PER_MS               (1000000ULL)
+#define NS_PER_S                (1000000000ULL)
+
+// Same values as LSS_Status
+#define SIM_STATUS_LIMP         (1)
+#define SIM_STATUS_TRAVELLING   (4)
+#define SIM_STATUS_HOLDING      (6)
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+typedef struct {
+    uint64_t at;            // time the byte is completely on the line
+    uint8_t  byte;
+} SimByte;
+
+//> One direction of a bus, bytes are kept in the order they arrive
+typedef struct {
+    SimByte  bytes[SIM_LINE_BYTES];
+    uint16_t head;
+    uint16_t count;
+    uint64_t freeAt;        // end of the last byte scheduled
+} SimLine;
+
+typedef struct {
+    UART_HandleTypeDef* huart;
+    bool                echo;           // TX and RX on the same wire
+    bool                receiverOff;    // single-wire UART transmitting
+    SimLine             tx;
+    SimLine             rx;
+    uint64_t            txDoneAt;       // end of the interrupt-mode transmission in progress
+    bool                rdrFull;        // data register holding a byte nobody took yet
+    uint8_t             rdr;
+    char                frame[SIM_FRAME_LENGTH];   // what the servos are parsing
+    uint8_t             frameLength;
+    bool                inFrame;
+    LSS_SimStats        stats;
+} SimBus;
+
+typedef struct {
+    SimBus*  bus;
+    uint8_t  id;
+    bool     silent;
+    bool     limp;
+    uint64_t bootUntil;
+    int32_t  maxSpeed;      // (1/10°)/s
+    int32_t  from;          // 1/10°
+    int32_t  to;
+    uint64_t moveStart;
+    uint64_t moveEnd;
+    bool     wheeling;
+    int32_t  wheelSpeed;    // (1/10°)/s
+} SimServo;
+
+
+/*************************************************************************************************/
+/* Private variables --------------------------------------------------------------------------- */
+static uint64_t now;
+static SimBus   buses[LSS_SIM_BUSES];
+static uint8_t  busCount;
+static SimServo servos[LSS_SIM_SERVOS];
+static uint8_t  servoCount;
+
+
+/*************************************************************************************************/
+/* Private functions declarations -------------------------------------------------------------- */
+static SimBus*   find_bus    (UART_HandleTypeDef* huart, bool create);
+static SimServo* find_servo  (UART_HandleTypeDef* huart, uint8_t id);
+static uint64_t  byte_time   (const SimBus* bus);
+static bool      line_push   (SimLine* line, uint64_t at, uint8_t byte, uint64_t byteTime);
+static void      schedule_tx (SimBus* bus, const uint8_t* data, uint16_t size);
+static uint64_t  next_event  (void);
+static void      advance     (void);
+static void      run_until   (uint64_t time);
+static void      uart_receive(SimBus* bus, uint8_t byte);
+static void      servo_byte  (SimBus* bus, uint8_t byte, uint64_t at);
+static void      dispatch    (SimBus* bus, uint64_t at);
+static void      execute     (SimServo* servo, const char* cmd, bool hasValue, int32_t value,
+                              const char* parameter, int32_t parameterValue, bool broadcast, uint64_t at);
+static int32_t   position_at (const SimServo* servo, uint64_t time);
+static int32_t   speed_at    (const SimServo* servo, uint64_t time);
+static uint32_t  current_at  (const SimServo* servo, uint64_t time);
+static void      reply       (SimServo* servo, const char* cmd, int32_t value, uint64_t at);
+static void      reply_text  (SimServo* servo, const char* cmd, const char* value, uint64_t at);
+
+
+/*************************************************************************************************/
+/* Public functions definitions ---------------------------------------------------------------- */
+
+/* --------- */
+/* Simulator */
+
+// Forget every bus and servo, time keeps going
+void lss_sim_reset(void)
+{
+    memset(buses, 0, sizeof(buses));
+    memset(servos, 0, sizeof(servos));
+    busCount   = 0;
+    servoCount = 0;
+}
+
+// Put a servo on the bus of huart, at position 0. Returns false if there is no room left.
+bool lss_sim_add_servo(UART_HandleTypeDef* huart, uint8_t id)
+{
+    SimBus* bus = find_bus(huart, true);
+    if (bus == NULL || servoCount == LSS_SIM_SERVOS)
+    {
+        return false;
+    }
+
+    SimServo* servo = &servos[servoCount++];
+    memset(servo, 0, sizeof(*servo));
+    servo->bus      = bus;
+    servo->id       = id;
+    servo->maxSpeed = SIM_DEFAULT_SPEED;
+    return true;
+}
+
+// Wire TX and RX together: every byte sent comes back on RX, and shares the wire with the replies
+void lss_sim_set_echo(UART_HandleTypeDef* huart, bool echo)
+{
+    SimBus* bus = find_bus(huart, true);
+    if (bus != NULL)
+    {
+        bus->echo = echo;
+    }
+}
+
+// A silent servo ignores everything, ex: unplugged
+void lss_sim_set_silent(UART_HandleTypeDef* huart, uint8_t id, bool silent)
+{
+    SimServo* servo = find_servo(huart, id);
+    if (servo != NULL)
+    {
+        servo->silent = silent;
+    }
+}
+
+int32_t lss_sim_position(UART_HandleTypeDef* huart, uint8_t id)
+{
+    const SimServo* servo = find_servo(huart, id);
+    return (servo != NULL) ? position_at(servo, now) : 0;
+}
+
+uint32_t lss_sim_current(UART_HandleTypeDef* huart, uint8_t id)
+{
+    const SimServo* servo = find_servo(huart, id);
+    return (servo != NULL) ? current_at(servo, now) : 0;
+}
+
+void lss_sim_stats(UART_HandleTypeDef* huart, LSS_SimStats* stats)
+{
+    const SimBus* bus = find_bus(huart, false);
+    if (bus != NULL)
+    {
+        *stats = bus->stats;
+    }
+    else
+    {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+uint64_t lss_sim_nanos(void)
+{
+    return now;
+}
+
+uint32_t lss_sim_micros(void)
+{
+    return (uint32_t)(now / NS_PER_US);
+}
+
+// Sleep until the next byte, end of transmission or tick interrupt
+void lss_sim_idle(void)
+{
+    uint64_t tick = (now / NS_PER_MS + 1) * NS_PER_MS;
+    uint64_t next = next_event();
+    run_until((next < tick) ? next : tick);
+}
+
+void lss_sim_assert_failed(const char* file, int line)
+{
+    fprintf(stderr, "assert_param failed at %s:%d\n", file, line);
+    abort();
+}
+
+
+/* ---------- */
+/* HAL subset */
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef* huart)
+{
+    if (find_bus(huart, true) == NULL)
+    {
+        return HAL_ERROR;
+    }
+    huart->gState  = HAL_UART_STATE_READY;
+    huart->RxState = HAL_UART_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_DeInit(UART_HandleTypeDef* huart)
+{
+    (void)huart;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_HalfDuplex_Init(UART_HandleTypeDef* huart)
+{
+    return HAL_UART_Init(huart);
+}
+
+// Blocking: returns once the last byte is out
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size,
+                                    uint32_t timeout)
+{
+    (void)timeout;
+    SimBus* bus = find_bus(huart, false);
+    now += LSS_SIM_CALL_NS;
+    if (bus == NULL || huart->gState != HAL_UART_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+
+    schedule_tx(bus, data, size);
+    run_until(bus->tx.freeAt);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size)
+{
+    SimBus* bus = find_bus(huart, false);
+    now += LSS_SIM_CALL_NS;
+    if (bus == NULL || huart->gState != HAL_UART_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+
+    schedule_tx(bus, data, size);
+    bus->txDoneAt = bus->tx.freeAt;
+    huart->gState = HAL_UART_STATE_BUSY_TX;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size)
+{
+    return HAL_UART_Transmit_IT(huart, data, size);
+}
+
+// Blocking (polling) reception, bytes are taken from the data register as they come
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size,
+                                   uint32_t timeout)
+{
+    SimBus* bus = find_bus(huart, false);
+    now += LSS_SIM_CALL_NS;
+    advance();
+    if (bus == NULL || huart->RxState != HAL_UART_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+
+    uint64_t deadline = now + timeout * NS_PER_MS;
+    for (uint16_t i = 0; i < size; i++)
+    {
+        while (!bus->rdrFull)
+        {
+            if (now >= deadline)
+            {
+                return HAL_TIMEOUT;
+            }
+            uint64_t next = next_event();
+            run_until((next < deadline) ? next : deadline);
+        }
+        data[i]      = bus->rdr;
+        bus->rdrFull = false;
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size)
+{
+    SimBus* bus = find_bus(huart, false);
+    now += LSS_SIM_CALL_NS;
+    advance();
+    if (bus == NULL || huart->RxState != HAL_UART_STATE_READY || size == 0)
+    {
+        return HAL_BUSY;
+    }
+
+    huart->pRxBuffPtr  = data;
+    huart->RxXferSize  = size;
+    huart->RxXferCount = size;
+    huart->RxState     = HAL_UART_STATE_BUSY_RX;
+
+    // The receive interrupt fires right away for a byte already waiting in the data register
+    if (bus->rdrFull)
+    {
+        bus->rdrFull = false;
+        uart_receive(bus, bus->rdr);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortReceive_IT(UART_HandleTypeDef* huart)
+{
+    now += LSS_SIM_CALL_NS;
+    huart->RxXferCount = 0;
+    huart->RxState     = HAL_UART_STATE_READY;
+    return HAL_OK;
+}
+
+// Bytes not completely sent yet never make it to the wire
+HAL_StatusTypeDef HAL_UART_AbortTransmit(UART_HandleTypeDef* huart)
+{
+    SimBus* bus = find_bus(huart, false);
+    now += LSS_SIM_CALL_NS;
+    advance();
+    if (bus != NULL)
+    {
+        bus->tx.count  = 0;
+        bus->tx.freeAt = now;
+    }
+    huart->gState = HAL_UART_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_HalfDuplex_EnableTransmitter(UART_HandleTypeDef* huart)
+{
+    SimBus* bus = find_bus(huart, false);
+    if (bus != NULL)
+    {
+        bus->receiverOff = true;
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_HalfDuplex_EnableReceiver(UART_HandleTypeDef* huart)
+{
+    SimBus* bus = find_bus(huart, false);
+    if (bus != NULL)
+    {
+        bus->receiverOff = false;
+    }
+    return HAL_OK;
+}
+
+__weak void HAL_UART_TxCpltCallback(UART_HandleTypeDef* huart)
+{
+    (void)huart;
+}
+
+__weak void HAL_UART_RxCpltCallback(UART_HandleTypeDef* huart)
+{
+    (void)huart;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    now += LSS_SIM_CALL_NS;
+    advance();
+    return (uint32_t)(now / NS_PER_MS);
+}
+
+void HAL_Delay(uint32_t delay)
+{
+    run_until(now + delay * NS_PER_MS);
+}
+
+__weak void error_handler(void)
+{
+    fprintf(stderr, "error_handler called\n");
+    abort();
+}
+
+
+/*************************************************************************************************/
+/* Private functions definitions --------------------------------------------------------------- */
+static SimBus* find_bus(UART_HandleTypeDef* huart, bool create)
+{
+    for (uint8_t b = 0; b < busCount; b++)
+    {
+        if (buses[b].huart == huart)
+        {
+            return &buses[b];
+        }
+    }
+    if (!create || busCount == LSS_SIM_BUSES)
+    {
+        return NULL;
+    }
+
+    SimBus* bus = &buses[busCount++];
+    memset(bus, 0, sizeof(*bus));
+    bus->huart = huart;
+    return bus;
+}
+
+static SimServo* find_servo(UART_HandleTypeDef* huart, uint8_t id)
+{
+    for (uint8_t s = 0; s < servoCount; s++)
+    {
+        if (servos[s].bus->huart == huart && servos[s].id == id)
+        {
+            return &servos[s];
+        }
+    }
+    return NULL;
+}
+
+// Start bit, 8 data bits, stop bit
+static uint64_t byte_time(const SimBus* bus)
+{
+    uint32_t baud = bus->huart->Init.BaudRate;
+    return 10 * NS_PER_S / ((baud > 0) ? baud : SIM_DEFAULT_BAUD);
+}
+
+/* Queue a byte on a line, no earlier than at and after the bytes already there.
+ * Returns true if it had to wait for the line. */
+static bool line_push(SimLine* line, uint64_t at, uint8_t byte, uint64_t byteTime)
+{
+    bool waited = (at < line->freeAt + byteTime);
+    if (waited)
+    {
+        at = line->freeAt + byteTime;
+    }
+    if (line->count == SIM_LINE_BYTES)
+    {
+        lss_sim_assert_failed(__FILE__, __LINE__);
+    }
+
+    line->bytes[(line->head + line->count++) % SIM_LINE_BYTES] = (SimByte){at, byte};
+    line->freeAt                                              = at;
+    return waited;
+}
+
+static void schedule_tx(SimBus* bus, const uint8_t* data, uint16_t size)
+{
+    uint64_t byteTime = byte_time(bus);
+    uint64_t start    = (bus->tx.freeAt > now) ? bus->tx.freeAt : now;
+    for (uint16_t i = 0; i < size; i++)
+    {
+        line_push(&bus->tx, start + (i + 1) * byteTime, data[i], byteTime);
+    }
+    bus->stats.txBytes += size;
+    bus->stats.busyNs  += size * byteTime;
+}
+
+static uint64_t next_event(void)
+{
+    uint64_t next = SIM_NEVER;
+    for (uint8_t b = 0; b < busCount; b++)
+    {
+        const SimBus* bus = &buses[b];
+        if (bus->tx.count > 0 && bus->tx.bytes[bus->tx.head].at < next)
+        {
+            next = bus->tx.bytes[bus->tx.head].at;
+        }
+        if (bus->rx.count > 0 && bus->rx.bytes[bus->rx.head].at < next)
+        {
+            next = bus->rx.bytes[bus->rx.head].at;
+        }
+        if (bus->huart->gState == HAL_UART_STATE_BUSY_TX && bus->txDoneAt < next)
+        {
+            next = bus->txDoneAt;
+        }
+    }
+    return next;
+}
+
+// Deliver everything that happened up to now
+static void advance(void)
+{
+    for (uint8_t b = 0; b < busCount; b++)
+    {
+        SimBus* bus = &buses[b];
+
+        // Bytes sent reach the servos, and come back on an echoing bus
+        while (bus->tx.count > 0 && bus->tx.bytes[bus->tx.head].at <= now)
+        {
+            SimByte sent = bus->tx.bytes[bus->tx.head];
+            bus->tx.head = (bus->tx.head + 1) % SIM_LINE_BYTES;
+            bus->tx.count--;
+
+            if (bus->echo && line_push(&bus->rx, sent.at, sent.byte, byte_time(bus)))
+            {
+                bus->stats.collisions++;
+            }
+            servo_byte(bus, sent.byte, sent.at);
+        }
+
+        if (bus->huart->gState == HAL_UART_STATE_BUSY_TX && bus->txDoneAt <= now)
+        {
+            bus->huart->gState = HAL_UART_STATE_READY;
+            HAL_UART_TxCpltCallback(bus->huart);
+        }
+
+        while (bus->rx.count > 0 && bus->rx.bytes[bus->rx.head].at <= now)
+        {
+            uint8_t byte = bus->rx.bytes[bus->rx.head].byte;
+            bus->rx.head = (bus->rx.head + 1) % SIM_LINE_BYTES;
+            bus->rx.count--;
+            uart_receive(bus, byte);
+        }
+    }
+}
+
+static void run_until(uint64_t time)
+{
+    uint64_t next;
+    while ((next = next_event()) <= time)
+    {
+        if (next > now)
+        {
+            now = next;
+        }
+        advance();
+    }
+    if (time > now)
+    {
+        now = time;
+    }
+    advance();
+}
+
+// A byte reaching the UART: into the armed reception, else the data register, else lost
+static void uart_receive(SimBus* bus, uint8_t byte)
+{
+    UART_HandleTypeDef* huart = bus->huart;
+    bus->stats.rxBytes++;
+    if (bus->receiverOff)
+    {
+        return;
+    }
+
+    if (huart->RxState == HAL_UART_STATE_BUSY_RX && huart->RxXferCount > 0)
+    {
+        huart->pRxBuffPtr[huart->RxXferSize - huart->RxXferCount] = byte;
+        huart->RxXferCount--;
+        if (huart->RxXferCount == 0)
+        {
+            huart->RxState = HAL_UART_STATE_READY;
+            HAL_UART_RxCpltCallback(huart);
+        }
+    }
+    else if (bus->rdrFull)
+    {
+        bus->stats.overruns++;
+    }
+    else
+    {
+        bus->rdr     = byte;
+        bus->rdrFull = true;
+    }
+}
+
+// Every servo of the bus reads the same frames
+static void servo_byte(SimBus* bus, uint8_t byte, uint64_t at)
+{
+    if (byte == '#')
+    {
+        bus->inFrame     = true;
+        bus->frameLength = 0;
+    }
+    else if (byte == '\r' && bus->inFrame)
+    {
+        bus->frame[bus->frameLength] = '\0';
+        bus->inFrame                 = false;
+        bus->stats.frames++;
+        dispatch(bus, at);
+    }
+    else if (bus->inFrame && bus->frameLength < SIM_FRAME_LENGTH - 1)
+    {
+        bus->frame[bus->frameLength++] = (char)byte;
+    }
+}
+
+// Frame: ID, command letters, optional value, optional parameter letters and value
+static void dispatch(SimBus* bus, uint64_t at)
+{
+    const char* c  = bus->frame;
+    uint32_t    id = 0;
+    if (*c < '0' || *c > '9')
+    {
+        return;
+    }
+    while (*c >= '0' && *c <= '9')
+    {
+        id = id * 10 + (*c++ - '0');
+    }
+
+    char    cmd[8] = {0};
+    uint8_t length = 0;
+    while (*c >= 'A' && *c <= 'Z' && length < sizeof(cmd) - 1)
+    {
+        cmd[length++] = *c++;
+    }
+
+    char*   end      = NULL;
+    int32_t value    = (int32_t)strtol(c, &end, 10);
+    bool    hasValue = (end != c);
+    c                = end;
+
+    char parameter[4] = {0};
+    length            = 0;
+    while (*c >= 'A' && *c <= 'Z' && length < sizeof(parameter) - 1)
+    {
+        parameter[length++] = *c++;
+    }
+    int32_t parameterValue = (int32_t)strtol(c, NULL, 10);
+
+    bool broadcast = (id == 254);
+    for (uint8_t s = 0; s < servoCount; s++)
+    {
+        SimServo* servo = &servos[s];
+        if (servo->bus == bus && (broadcast || servo->id == id) && !servo->silent && at >= servo->bootUntil)
+        {
+            execute(servo, cmd, hasValue, value, parameter, parameterValue, broadcast, at);
+        }
+    }
+}
+
+static void execute(SimServo* servo, const char* cmd, bool hasValue, int32_t value,
+                    const char* parameter, int32_t parameterValue, bool broadcast, uint64_t at)
+{
+    int32_t position = position_at(servo, at);
+
+    if ((strcmp(cmd, "D") == 0 || strcmp(cmd, "MD") == 0) && hasValue)
+    {
+        int32_t target   = (cmd[0] == 'M') ? servo->to + value : value;
+        int32_t distance = abs(target - position);
+        int32_t speed    = (strcmp(parameter, "S") == 0 && parameterValue > 0) ? parameterValue : servo->maxSpeed;
+
+        servo->from      = position;
+        servo->to        = target;
+        servo->moveStart = at;
+        servo->moveEnd   = at + ((strcmp(parameter, "T") == 0 && parameterValue > 0)
+                                 ? parameterValue * NS_PER_MS
+                                 : (uint64_t)distance * NS_PER_S / speed);
+        servo->wheeling  = false;
+        servo->limp      = false;
+    }
+    else if ((strcmp(cmd, "WD") == 0 || strcmp(cmd, "WR") == 0) && hasValue)
+    {
+        servo->from       = position;
+        servo->moveStart  = at;
+        servo->wheeling   = true;
+        servo->wheelSpeed = (cmd[1] == 'R') ? value * 60 : value;     // 1 RPM = 6 °/s
+        servo->limp       = false;
+    }
+    else if (strcmp(cmd, "L") == 0 || strcmp(cmd, "H") == 0)
+    {
+        servo->from     = position;
+        servo->to       = position;
+        servo->moveEnd  = at;
+        servo->wheeling = false;
+        servo->limp     = (cmd[0] == 'L');
+    }
+    else if ((strcmp(cmd, "SD") == 0 || strcmp(cmd, "CSD") == 0) && hasValue && value > 0)
+    {
+        servo->maxSpeed = value;
+    }
+    else if (strcmp(cmd, "RESET") == 0)
+    {
+        servo->from      = position;
+        servo->to        = position;
+        servo->moveEnd   = at;
+        servo->wheeling  = false;
+        servo->limp      = true;
+        servo->maxSpeed  = SIM_DEFAULT_SPEED;
+        servo->bootUntil = at + (LSS_SIM_BOOT_MS + 10 * servo->id) * NS_PER_MS;
+    }
+    else if (!broadcast && cmd[0] == 'Q')
+    {
+        int32_t speed = speed_at(servo, at);
+        if (strcmp(cmd, "Q") == 0)
+        {
+            reply(servo, cmd, servo->limp ? SIM_STATUS_LIMP : (speed != 0) ? SIM_STATUS_TRAVELLING
+                                                                           : SIM_STATUS_HOLDING, at);
+        }
+        else if (strcmp(cmd, "QD") == 0)
+        {
+            reply(servo, cmd, position, at);
+        }
+        else if (strcmp(cmd, "QDT") == 0)
+        {
+            reply(servo, cmd, servo->wheeling ? position : servo->to, at);
+        }
+        else if (strcmp(cmd, "QWD") == 0)
+        {
+            reply(servo, cmd, speed, at);
+        }
+        else if (strcmp(cmd, "QWR") == 0)
+        {
+            reply(servo, cmd, speed / 60, at);
+        }
+        else if (strcmp(cmd, "QC") == 0)
+        {
+            reply(servo, cmd, (int32_t)current_at(servo, at), at);
+        }
+        else if (strcmp(cmd, "QV") == 0)
+        {
+            reply(servo, cmd, 11900, at);
+        }
+        else if (strcmp(cmd, "QT") == 0)
+        {
+            reply(servo, cmd, 330, at);
+        }
+        else if (strcmp(cmd, "QSD") == 0)
+        {
+            reply(servo, cmd, servo->maxSpeed, at);
+        }
+        else if (strcmp(cmd, "QMS") == 0)
+        {
+            reply_text(servo, cmd, SIM_MODEL, at);
+        }
+    }
+}
+
+static int32_t position_at(const SimServo* servo, uint64_t time)
+{
+    if (servo->wheeling)
+    {
+        return servo->from + (int32_t)((int64_t)servo->wheelSpeed * (int64_t)(time - servo->moveStart) /
+                                       (int64_t)NS_PER_S);
+    }
+    if (time >= servo->moveEnd)
+    {
+        return servo->to;
+    }
+    return servo->from + (int32_t)((int64_t)(servo->to - servo->from) * (int64_t)(time - servo->moveStart) /
+                                   (int64_t)(servo->moveEnd - servo->moveStart));
+}
+
+static int32_t speed_at(const SimServo* servo, uint64_t time)
+{
+    if (servo->wheeling)
+    {
+        return servo->wheelSpeed;
+    }
+    if (time >= servo->moveEnd)
+    {
+        return 0;
+    }
+    return (int32_t)((int64_t)(servo->to - servo->from) * (int64_t)NS_PER_S /
+                     (int64_t)(servo->moveEnd - servo->moveStart));
+}
+
+// Holding current, plus a share of the moving current that follows the speed, plus the inrush of a start
+static uint32_t current_at(const SimServo* servo, uint64_t time)
+{
+    if (servo->limp)
+    {
+        return 0;
+    }
+
+    int32_t  speed   = abs(speed_at(servo, time));
+    uint32_t current = LSS_SIM_HOLD_MA + (uint32_t)((int64_t)LSS_SIM_MOVING_MA * speed / servo->maxSpeed);
+    if (speed != 0 && time >= servo->moveStart && time - servo->moveStart < LSS_SIM_INRUSH_MS * NS_PER_MS)
+    {
+        current += LSS_SIM_INRUSH_MA;
+    }
+    return current;
+}
+
+static void reply(SimServo* servo, const char* cmd, int32_t value, uint64_t at)
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%ld", (long)value);
+    reply_text(servo, cmd, text, at);
+}
+
+// The reply starts after the turnaround, or once the line is free (it would overlap without arbitration)
+static void reply_text(SimServo* servo, const char* cmd, const char* value, uint64_t at)
+{
+    SimBus*  bus      = servo->bus;
+    uint64_t byteTime = byte_time(bus);
+    char     text[SIM_FRAME_LENGTH];
+    int      length   = snprintf(text, sizeof(text), "*%u%s%s\r", servo->id, cmd, value);
+
+    uint64_t start = at + LSS_SIM_TURNAROUND_US * NS_PER_US;
+    if (line_push(&bus->rx, start + byteTime, (uint8_t)text[0], byteTime))
+    {
+        bus->stats.collisions++;
+    }
+    for (int i = 1; i < length; i++)
+    {
+        line_push(&bus->rx, 0, (uint8_t)text[i], byteTime);
+    }
+    bus->stats.busyNs += length * byteTime;
+}
+
+
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
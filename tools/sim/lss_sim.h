@@ -0,0 +1,91 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Virtual-time simulation of LSS buses, to run the library and its benchmarks on a host
+ *                  with timings that follow the wire instead of the host's speed.
+ *                  Each UART is a bus with its own TX and RX lines: every byte takes 10 bit times at the
+ *                  UART's baud rate, servos reply LSS_SIM_TURNAROUND_US after the end of a query, and a
+ *                  byte arriving while no reception is armed and the data register is still full is lost
+ *                  (overrun), like on the STM32. Simulated time only moves forward through the HAL: each
+ *                  call costs LSS_SIM_CALL_NS of CPU time, blocking calls and __WFI() skip to the next
+ *                  event, HAL_Delay() to its end.
+ *                  The servos move at their max speed (or in the T time given), turn as wheels, go
+ *                  limp, hold, reset (silent while they boot), and answer Q, QD, QDT, QWD, QWR, QC, QV,
+ *                  QT, QSD and QMS (LSS-ST1). Other commands are accepted without effect. Their current
+ *                  follows their speed, with an inrush at the start of each move (LSS_SIM_*_MA).
+ *
+ *  Build (from the repository root):
+ *      cc -O2 -Itools/sim -I. app.c tools/sim/lss_sim.c LSS.c -o app
+ *
+ *  Usage:
+ *      UART_HandleTypeDef huart = {0};
+ *      lss_sim_add_servo(&huart, 1);
+ *      LSS_init(&servo, 1, &huart, 115200);
+ *      ...
+ *      printf("%u µs\n", lss_sim_micros());
+ */
+#ifndef LSS_SIM_H
+#define LSS_SIM_H
+
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include "usart.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#ifndef LSS_SIM_BUSES
+#define LSS_SIM_BUSES           (8)
+#endif
+
+#ifndef LSS_SIM_SERVOS
+#define LSS_SIM_SERVOS          (64)    // over every bus
+#endif
+
+#define LSS_SIM_CALL_NS         (1000)  // CPU time of a HAL call, so busy loops make progress
+#define LSS_SIM_TURNAROUND_US   (100)   // from the end of a query to the start of its reply
+#define LSS_SIM_BOOT_MS         (1100)  // silence after a RESET, plus 10 ms per ID
+
+//> Current drawn by a servo that isn't limp (QC, lss_sim_current)
+#define LSS_SIM_HOLD_MA         (120)
+#define LSS_SIM_MOVING_MA       (500)   // on top of hold at max speed, in proportion below and above it
+#define LSS_SIM_INRUSH_MA       (1000)  // on top of that while a move starts
+#define LSS_SIM_INRUSH_MS       (40)
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+typedef struct {
+    uint32_t txBytes;
+    uint32_t rxBytes;       // bytes that reached the UART, received or not
+    uint32_t frames;        // frames parsed by the servos
+    uint32_t overruns;      // bytes lost because nothing was receiving them
+    uint32_t collisions;    // replies or echoes that waited for the wire, they'd overlap without arbitration
+    uint64_t busyNs;        // time with a byte on the TX or RX line, overlaps counted twice
+} LSS_SimStats;
+
+
+/*************************************************************************************************/
+/* Public functions declarations --------------------------------------------------------------- */
+void     lss_sim_reset     (void);
+bool     lss_sim_add_servo (UART_HandleTypeDef* huart, uint8_t id);
+void     lss_sim_set_echo  (UART_HandleTypeDef* huart, bool echo);
+void     lss_sim_set_silent(UART_HandleTypeDef* huart, uint8_t id, bool silent);
+int32_t  lss_sim_position  (UART_HandleTypeDef* huart, uint8_t id);
+uint32_t lss_sim_current   (UART_HandleTypeDef* huart, uint8_t id);    // mA
+void     lss_sim_stats     (UART_HandleTypeDef* huart, LSS_SimStats* stats);
+uint64_t lss_sim_nanos     (void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */
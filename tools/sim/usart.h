@@ -0,0 +1,110 @@
+/**
+ *  Author:         Pascal-Emmanuel Lachance (raesangur.com)
+ *  Licence:        LGPL-3.0 (GNU Lesser General Public License version 3)
+ *
+ *  Description:    Stand-in for the STM32 HAL headers (usart.h and what it pulls in), to build the library
+ *                  on a host against the bus simulator (lss_sim.c). Only the subset used by the library
+ *                  is provided. Replies are stamped with the simulated time, in µs.
+ */
+#ifndef USART_H
+#define USART_H
+
+/*************************************************************************************************/
+/* File includes ------------------------------------------------------------------------------- */
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*************************************************************************************************/
+/* Constants ----------------------------------------------------------------------------------- */
+#define HAL_UART_STATE_READY        (0x20U)
+#define HAL_UART_STATE_BUSY_TX      (0x21U)
+#define HAL_UART_STATE_BUSY_RX      (0x22U)
+
+#define assert_param(expr)          ((expr) ? (void)0U : lss_sim_assert_failed(__FILE__, __LINE__))
+#define __weak                      __attribute__((weak))
+#define __WFI()                     lss_sim_idle()
+
+//> Timestamps (reply stamps, bus tracing) in simulated µs
+#define LSS_PORT_TIMESTAMP()        lss_sim_micros()
+#define LSS_PORT_TIMESTAMP_INIT()   ((void)0)
+#define LSS_PORT_CLOCK              (1000000)
+
+
+/*************************************************************************************************/
+/* Enums --------------------------------------------------------------------------------------- */
+typedef enum
+{
+    HAL_OK      = 0x00U,
+    HAL_ERROR   = 0x01U,
+    HAL_BUSY    = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+
+/*************************************************************************************************/
+/* Struct -------------------------------------------------------------------------------------- */
+typedef struct {
+    uint32_t BaudRate;
+} UART_InitTypeDef;
+
+typedef struct {
+    UART_InitTypeDef  Init;
+
+    uint8_t*          pRxBuffPtr;
+    uint16_t          RxXferSize;
+    volatile uint16_t RxXferCount;
+
+    volatile uint32_t gState;
+    volatile uint32_t RxState;
+} UART_HandleTypeDef;
+
+
+/*************************************************************************************************/
+/* Public functions declarations --------------------------------------------------------------- */
+
+/* ---------- */
+/* HAL subset */
+HAL_StatusTypeDef HAL_UART_Init           (UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_UART_DeInit         (UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_UART_Transmit       (UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size,
+                                           uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Receive        (UART_HandleTypeDef* huart, uint8_t* data, uint16_t size,
+                                           uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_IT    (UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA   (UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Receive_IT     (UART_HandleTypeDef* huart, uint8_t* data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_AbortReceive_IT(UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_UART_AbortTransmit  (UART_HandleTypeDef* huart);
+
+HAL_StatusTypeDef HAL_HalfDuplex_Init             (UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_HalfDuplex_EnableTransmitter(UART_HandleTypeDef* huart);
+HAL_StatusTypeDef HAL_HalfDuplex_EnableReceiver   (UART_HandleTypeDef* huart);
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef* huart);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef* huart);
+
+uint32_t HAL_GetTick(void);
+void     HAL_Delay  (uint32_t delay);
+
+void     error_handler(void);
+
+
+/* --------- */
+/* Simulator */
+uint32_t lss_sim_micros       (void);
+void     lss_sim_idle         (void);
+void     lss_sim_assert_failed(const char* file, int line);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/*************************************************************************************************/
+/* ----- END OF FILE ----- */